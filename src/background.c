@@ -18,6 +18,10 @@
 #include "image.h"
 #include "gradient.h"
 #include "hint.h"
+#include "decode.h"
+#include "settings.h"
+#include "compose.h"
+#include "screen.h"
 
 /** Enumeration of background types. */
 typedef unsigned char BackgroundType;
@@ -27,13 +31,22 @@ typedef unsigned char BackgroundType;
 #define BACKGROUND_STRETCH    3  /**< Stretched image. */
 #define BACKGROUND_TILE       4  /**< Tiled image. */
 #define BACKGROUND_SCALE      5  /**< Scaled image. */
+#define BACKGROUND_FILL       6  /**< Scaled and cropped image. */
+#define BACKGROUND_CENTER     7  /**< Centered image. */
 
-/** Structure to represent a background for one or more desktops. */
+/** Structure to represent a background for one or more desktops.
+ * Backgrounds with the same type and value share the pixmap of the
+ * first such node, which is created the first time it is shown.
+ */
 typedef struct BackgroundNode {
    int desktop;                  /**< The desktop. */
    BackgroundType type;          /**< The type of background. */
    char *value;
    Pixmap pixmap;
+   unsigned long bytes;          /**< Server memory used by the pixmap. */
+   unsigned long lastUsed;       /**< Sequence number of the last use. */
+   char missing;                 /**< Set if the image could not be found. */
+   struct BackgroundNode *shared;   /**< Node owning the pixmap. */
    struct BackgroundNode *next;  /**< Next background in the list. */
 } BackgroundNode;
 
@@ -46,8 +59,22 @@ static BackgroundNode *defaultBackground;
 /** The last background loaded. */
 static BackgroundNode *lastBackground;
 
+/** Server memory used by background pixmaps. */
+static unsigned long backgroundBytes;
+
+/** Sequence number for background use. */
+static unsigned long backgroundSequence;
+
+static void CreateBackgroundPixmap(BackgroundNode *bp);
+static void ReleaseBackgroundPixmap(BackgroundNode *bp);
+static void EvictBackgrounds(const BackgroundNode *keep);
+static unsigned long GetPixmapBytes(unsigned width, unsigned height);
 static void LoadGradientBackground(BackgroundNode *bp);
 static void LoadImageBackground(BackgroundNode *bp);
+static void HandleBackgroundImage(void *data, int rwidth, int rheight,
+                                  ImageNode *image);
+static void DrawBackgroundImage(BackgroundNode *bp, ImageNode *image);
+static char IsServerTiled(const BackgroundNode *bp);
 
 /** Initialize any data needed for background support. */
 void InitializeBackgrounds(void)
@@ -55,33 +82,35 @@ void InitializeBackgrounds(void)
    backgrounds = NULL;
    defaultBackground = NULL;
    lastBackground = NULL;
+   backgroundBytes = 0;
+   backgroundSequence = 0;
 }
 
-/** Startup background support. */
+/** Startup background support.
+ * Pixmaps are not created until a background is shown.
+ */
 void StartupBackgrounds(void)
 {
 
    BackgroundNode *bp;
+   BackgroundNode *op;
 
    for(bp = backgrounds; bp; bp = bp->next) {
 
-      /* Load background data. */
-      switch(bp->type) {
-      case BACKGROUND_SOLID:
-      case BACKGROUND_GRADIENT:
-         LoadGradientBackground(bp);
-         break;
-      case BACKGROUND_COMMAND:
-         /* Nothing to do. */
-         break;
-      case BACKGROUND_STRETCH:
-      case BACKGROUND_TILE:
-      case BACKGROUND_SCALE:
-         LoadImageBackground(bp);
-         break;
-      default:
-         Debug("invalid background type in LoadBackground: %d", bp->type);
-         break;
+      if(bp->type != BACKGROUND_SOLID
+         && bp->type != BACKGROUND_GRADIENT
+         && bp->type != BACKGROUND_COMMAND) {
+         ExpandPath(&bp->value);
+      }
+
+      /* Share the pixmap of an identical background. */
+      bp->shared = bp;
+      for(op = backgrounds; op != bp; op = op->next) {
+         if(op->shared == op && op->type == bp->type
+            && !strcmp(op->value, bp->value)) {
+            bp->shared = op;
+            break;
+         }
       }
 
       if(bp->desktop == -1) {
@@ -97,11 +126,9 @@ void ShutdownBackgrounds(void)
 {
    BackgroundNode *bp;
    for(bp = backgrounds; bp; bp = bp->next) {
-      if(bp->pixmap != None) {
-         JXFreePixmap(display, bp->pixmap);
-         bp->pixmap = None;
-      }
+      ReleaseBackgroundPixmap(bp);
    }
+   lastBackground = NULL;
 }
 
 /** Release any data needed for background support. */
@@ -120,7 +147,9 @@ void DestroyBackgrounds(void)
 void SetBackground(int desktop, const char *type, const char *value)
 {
    static const StringMappingType mapping[] = {
+      { "center",    BACKGROUND_CENTER    },
       { "command",   BACKGROUND_COMMAND   },
+      { "fill",      BACKGROUND_FILL      },
       { "gradient",  BACKGROUND_GRADIENT  },
       { "image",     BACKGROUND_STRETCH   },
       { "scale",     BACKGROUND_SCALE     },
@@ -173,6 +202,10 @@ void SetBackground(int desktop, const char *type, const char *value)
    bp->type = bgType;
    bp->value = CopyString(value);
    bp->pixmap = None;
+   bp->bytes = 0;
+   bp->lastUsed = 0;
+   bp->missing = 0;
+   bp->shared = bp;
 
    /* Insert the node into the list. */
    bp->next = backgrounds;
@@ -204,9 +237,8 @@ void LoadBackground(int desktop)
    }
 
    /* If the background isn't changing, don't do anything. */
-   if(   lastBackground
-      && bp->type == lastBackground->type
-      && !strcmp(bp->value, lastBackground->value)) {
+   bp = bp->shared;
+   if(bp == lastBackground) {
       return;
    }
    lastBackground = bp;
@@ -217,6 +249,14 @@ void LoadBackground(int desktop)
       return;
    }
 
+   /* Create the pixmap if this background has not been shown yet
+    * or if it was released to save memory. */
+   backgroundSequence += 1;
+   bp->lastUsed = backgroundSequence;
+   if(bp->pixmap == None) {
+      CreateBackgroundPixmap(bp);
+   }
+
    attrValues = CWBackPixmap;
    attr.background_pixmap = bp->pixmap;
    JXChangeWindowAttributes(display, rootWindow, attrValues, &attr);
@@ -225,6 +265,82 @@ void LoadBackground(int desktop)
 
 }
 
+/** Create the pixmap for a background. */
+void CreateBackgroundPixmap(BackgroundNode *bp)
+{
+   switch(bp->type) {
+   case BACKGROUND_SOLID:
+   case BACKGROUND_GRADIENT:
+      LoadGradientBackground(bp);
+      break;
+   case BACKGROUND_STRETCH:
+   case BACKGROUND_TILE:
+   case BACKGROUND_SCALE:
+   case BACKGROUND_FILL:
+   case BACKGROUND_CENTER:
+      if(!bp->missing) {
+         LoadImageBackground(bp);
+      }
+      break;
+   default:
+      Debug("invalid background type in LoadBackground: %d", bp->type);
+      break;
+   }
+
+   if(bp->pixmap == None) {
+      return;
+   }
+
+   /* Account for the pixmap and release others if needed. */
+   backgroundBytes += bp->bytes;
+   EvictBackgrounds(bp);
+}
+
+/** Get the server memory used by a root depth pixmap. */
+unsigned long GetPixmapBytes(unsigned width, unsigned height)
+{
+   const unsigned pixelBytes = rootDepth > 16 ? 4 : (rootDepth > 8 ? 2 : 1);
+   return (unsigned long)width * height * pixelBytes;
+}
+
+/** Release the pixmap for a background. */
+void ReleaseBackgroundPixmap(BackgroundNode *bp)
+{
+   CancelImageRequests(HandleBackgroundImage, bp);
+   if(bp->pixmap != None) {
+      JXFreePixmap(display, bp->pixmap);
+      bp->pixmap = None;
+      backgroundBytes -= bp->bytes;
+      bp->bytes = 0;
+   }
+}
+
+/** Release least recently used backgrounds to stay within the budget.
+ * @param keep The background being shown, which is never released.
+ */
+void EvictBackgrounds(const BackgroundNode *keep)
+{
+   const unsigned long budget
+      = (unsigned long)settings.backgroundCacheSize * 1024;
+   while(backgroundBytes > budget) {
+      BackgroundNode *oldest = NULL;
+      BackgroundNode *bp;
+      for(bp = backgrounds; bp; bp = bp->next) {
+         if(bp != keep && bp->pixmap != None) {
+            if(!oldest || bp->lastUsed < oldest->lastUsed) {
+               oldest = bp;
+            }
+         }
+      }
+      if(!oldest) {
+         break;
+      }
+      Debug("releasing background \"%s\" (%lu bytes)",
+            oldest->value, oldest->bytes);
+      ReleaseBackgroundPixmap(oldest);
+   }
+}
+
 /** Load a gradient background. */
 void LoadGradientBackground(BackgroundNode *bp)
 {
@@ -282,10 +398,12 @@ void LoadGradientBackground(BackgroundNode *bp)
    if(color1.pixel == color2.pixel) {
       bp->pixmap = JXCreatePixmap(display, rootWindow, 1, 1,
                                   rootDepth);
+      bp->bytes = GetPixmapBytes(1, 1);
       JXSetForeground(display, rootGC, color1.pixel);
       JXDrawPoint(display, bp->pixmap, rootGC, 0, 0);
    } else {
       bp->pixmap = JXCreatePixmap(display, rootWindow, w, h, rootDepth);
+      bp->bytes = GetPixmapBytes(w, h);
       DrawGradient(bp->pixmap, rootGC, color1.pixel, color2.pixel, 0, 0, w, h, bg);
    }
 
@@ -296,37 +414,124 @@ void LoadImageBackground(BackgroundNode *bp)
 {
 
    IconNode *ip;
+   ImageNode *image;
    int width, height;
+   int rwidth, rheight;
+   int i;
 
    /* Load the icon. */
-   ExpandPath(&bp->value);
-   ip = LoadNamedIcon(bp->value, 0, bp->type == BACKGROUND_SCALE);
+   ip = LoadNamedIcon(bp->value, 0, bp->type != BACKGROUND_STRETCH);
    if(JUNLIKELY(!ip || ip->width == 0)) {
       bp->pixmap = None;
+      bp->missing = 1;
       Warning(_("background image not found: \"%s\""), bp->value);
       return;
    }
 
-   /* Determine the size of the background pixmap. */
-   if(bp->type == BACKGROUND_TILE) {
+   /* Determine the size of the background pixmap and the size
+    * at which to load the image (this matters only for SVG). */
+   if(IsServerTiled(bp)) {
       width = ip->width;
       height = ip->height;
+      rwidth = width;
+      rheight = height;
    } else {
       width = rootWidth;
       height = rootHeight;
+      rwidth = 0;
+      rheight = 0;
+      if(bp->type != BACKGROUND_TILE && bp->type != BACKGROUND_CENTER) {
+         for(i = 0; i < GetScreenCount(); i++) {
+            const ScreenType *sp = GetScreen(i);
+            rwidth = Max(rwidth, sp->width);
+            rheight = Max(rheight, sp->height);
+         }
+      }
    }
 
    /* Create the pixmap. */
    bp->pixmap = JXCreatePixmap(display, rootWindow, width, height, rootDepth);
+   bp->bytes = GetPixmapBytes(width, height);
 
    /* Clear the pixmap in case it is too small. */
    JXSetForeground(display, rootGC, 0);
    JXFillRectangle(display, bp->pixmap, rootGC, 0, 0, width, height);
 
-   /* Draw the icon on the background pixmap. */
-   PutIcon(ip, bp->pixmap, 0, 0, 0, width, height);
+   /* Decode the image in the background if possible.
+    * The pixmap is filled in when the image is available. */
+   if(!RequestImage(ip->name, rwidth, rheight, ip->preserveAspect,
+                    HandleBackgroundImage, bp)) {
+      image = LoadImage(ip->name, rwidth, rheight, ip->preserveAspect);
+      if(JLIKELY(image)) {
+         DrawBackgroundImage(bp, image);
+      }
+   }
 
    /* We don't need the icon anymore. */
    DestroyIcon(ip);
 
 }
+
+/** Draw a decoded background image. */
+void HandleBackgroundImage(void *data, int rwidth, int rheight,
+                           ImageNode *image)
+{
+   BackgroundNode *bp = (BackgroundNode*)data;
+
+   if(JUNLIKELY(!image)) {
+      bp->missing = 1;
+      Warning(_("background image not found: \"%s\""), bp->value);
+      return;
+   }
+
+   DrawBackgroundImage(bp, image);
+
+   /* Show the new image if this background is visible. */
+   if(bp == lastBackground) {
+      JXClearWindow(display, rootWindow);
+   }
+}
+
+/** Draw an image on the background pixmap.
+ * This takes ownership of the image.
+ */
+void DrawBackgroundImage(BackgroundNode *bp, ImageNode *image)
+{
+   ComposeMode mode;
+
+   if(IsServerTiled(bp)) {
+      IconNode *ip = CreateIconFromImage(image, 0);
+      PutIcon(ip, bp->pixmap, 0, 0, 0, image->width, image->height);
+      DestroyIcon(ip);
+      return;
+   }
+
+   switch(bp->type) {
+   case BACKGROUND_TILE:
+      mode = COMPOSE_TILE;
+      break;
+   case BACKGROUND_SCALE:
+      mode = COMPOSE_SCALE;
+      break;
+   case BACKGROUND_FILL:
+      mode = COMPOSE_FILL;
+      break;
+   case BACKGROUND_CENTER:
+      mode = COMPOSE_CENTER;
+      break;
+   default:
+      mode = COMPOSE_STRETCH;
+      break;
+   }
+   ComposeBackground(bp->pixmap, image, mode);
+   DestroyImage(image);
+}
+
+/** Determine if a background is a single tile repeated by the server.
+ * This is the case for tiled images unless there are multiple screens,
+ * which are tiled from their own origins.
+ */
+char IsServerTiled(const BackgroundNode *bp)
+{
+   return bp->type == BACKGROUND_TILE && GetScreenCount() == 1;
+}
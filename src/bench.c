@@ -0,0 +1,592 @@
+/**
+ * @file bench.c
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Image pipeline benchmark.
+ *
+ * This program is built by "make bench-images" and is not installed.
+ * It decodes the images given on the command line (directories are
+ * searched for images); "make bench-images" passes the PNG, JPEG, and
+ * XPM images in bench/ along with the ggwm icons.  Each image is
+ * labeled with its file name, converted to the ARGB data used for
+ * render pictures, uploaded, and drawn as a new icon the same way ggwm
+ * does.  The results are written to standard output as JSON.
+ *
+ * The results can be compared against a baseline written by an
+ * earlier run, in which case the program fails if any measurement is
+ * slower than the baseline by more than the tolerance.
+ * "make bench-baseline" writes bench-baseline.txt, which is not
+ * tracked since the timings only hold for the machine they were taken
+ * on, and "make bench-images" compares against it if it exists.
+ *
+ * Options: -n iterations, -w file to write a baseline, -b file to
+ * compare against a baseline, and -t tolerance in percent.
+ *
+ * Without an X display only the decoders that do not need the X
+ * connection are measured.
+ *
+ */
+
+#include "ggwm.h"
+#include "main.h"
+#include "image.h"
+#include "icon.h"
+#include "color.h"
+#include "settings.h"
+#include "upload.h"
+#include "render.h"
+#include "drawpool.h"
+#include "misc.h"
+
+#include <dirent.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/** Size at which SVG images are also rasterized. */
+#define LARGE_SVG_SIZE     1024
+
+/** Size of the icons drawn. */
+#define ICON_SIZE          48
+
+/** Default tolerance for regressions in percent. */
+#define DEFAULT_TOLERANCE  50.0
+
+/** Smallest slowdown reported as a regression in milliseconds.
+ * This keeps timer noise on very fast steps from failing the run.
+ */
+#define MIN_REGRESSION_MS  0.05
+
+/** Times an image is measured before a slowdown is reported. */
+#define BENCH_ATTEMPTS     3
+
+/** A measurement read from a baseline file. */
+typedef struct BaselineNode {
+   char *key;                 /**< Image name and size. */
+   char *metric;              /**< Name of the measurement. */
+   double value;              /**< Time in milliseconds. */
+   struct BaselineNode *next;
+} BaselineNode;
+
+static unsigned iterations = 10;
+static char firstResult = 1;
+static BaselineNode *baseline = NULL;
+static FILE *baselineOut = NULL;
+static double tolerance = DEFAULT_TOLERANCE;
+static unsigned regressionCount = 0;
+static char **regressions = NULL;
+
+static double GetSeconds(void);
+static void OpenBenchDisplay(void);
+static void BenchFile(const char *fileName, const char *label);
+static void BenchPath(const char *path);
+static void BenchImage(const char *fileName, const char *label,
+                       const char *format, int rwidth, int rheight);
+static void Report(const char *key, const char *metric, double ms);
+static char IsSlower(const char *key, const char *metric, double ms);
+static const BaselineNode *FindBaseline(const char *key,
+                                        const char *metric);
+static char ReadBaseline(const char *fileName);
+static void DestroyBaseline(void);
+static void PrintString(const char *str);
+static int CompareNames(const void *a, const void *b);
+
+/** Run the benchmark. */
+int main(int argc, char *argv[])
+{
+   const char *baselineIn = NULL;
+   const char *baselineName = NULL;
+   unsigned i;
+   int x;
+
+   for(x = 1; x < argc; x++) {
+      if(!strcmp(argv[x], "-n") && x + 1 < argc) {
+         const int n = atoi(argv[++x]);
+         iterations = Max(1, n);
+      } else if(!strcmp(argv[x], "-b") && x + 1 < argc) {
+         baselineIn = argv[++x];
+      } else if(!strcmp(argv[x], "-w") && x + 1 < argc) {
+         baselineName = argv[++x];
+      } else if(!strcmp(argv[x], "-t") && x + 1 < argc) {
+         tolerance = atof(argv[++x]);
+      }
+   }
+
+   if(baselineIn && !ReadBaseline(baselineIn)) {
+      fprintf(stderr, "ggwm-bench: could not read baseline: %s\n",
+              baselineIn);
+      return 2;
+   }
+   if(baselineName) {
+      baselineOut = fopen(baselineName, "w");
+      if(!baselineOut) {
+         fprintf(stderr, "ggwm-bench: could not write baseline: %s\n",
+                 baselineName);
+         return 2;
+      }
+      fprintf(baselineOut,
+              "# ggwm-bench baseline: image size metric milliseconds\n");
+   }
+
+   OpenBenchDisplay();
+
+   printf("{\n");
+   printf("  \"display\": %s,\n", display ? "true" : "false");
+#ifdef USE_XRENDER
+   printf("  \"render\": %s,\n", haveRender ? "true" : "false");
+#else
+   printf("  \"render\": false,\n");
+#endif
+   printf("  \"iterations\": %u,\n", iterations);
+   printf("  \"icon_size\": %d,\n", ICON_SIZE);
+   printf("  \"images\": [");
+
+   for(x = 1; x < argc; x++) {
+      if(argv[x][0] == '-' && x + 1 < argc) {
+         x += 1;
+      } else {
+         BenchPath(argv[x]);
+      }
+   }
+   printf("\n  ]");
+
+   if(baseline) {
+      printf(",\n  \"baseline\": ");
+      PrintString(baselineIn);
+      printf(",\n  \"tolerance\": %.1f", tolerance);
+      printf(",\n  \"regressions\": [");
+      for(i = 0; i < regressionCount; i++) {
+         printf("%s\n    ", i > 0 ? "," : "");
+         PrintString(regressions[i]);
+         fprintf(stderr, "ggwm-bench: regression: %s\n", regressions[i]);
+         Release(regressions[i]);
+      }
+      printf("%s]", regressionCount > 0 ? "\n  " : "");
+      if(regressions) {
+         Release(regressions);
+      }
+   }
+   printf("\n}\n");
+
+   if(baselineOut) {
+      fclose(baselineOut);
+   }
+   DestroyBaseline();
+
+   if(display) {
+      ShutdownIcons();
+      ShutdownDrawPool();
+      ShutdownUpload();
+      ShutdownColors();
+      JXCloseDisplay(display);
+   }
+   return regressionCount > 0 ? 1 : 0;
+}
+
+/** Get the current time in seconds. */
+double GetSeconds(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** Open the display and start the modules needed to draw icons. */
+void OpenBenchDisplay(void)
+{
+#ifdef USE_XRENDER
+   int renderEvent, renderError;
+#endif
+
+   InitializeSettings();
+   InitializeIcons();
+   StartupSettings();
+
+   display = JXOpenDisplay(NULL);
+   if(!display) {
+#ifdef USE_XRENDER
+      haveRender = 0;
+#endif
+      return;
+   }
+
+   rootScreen = DefaultScreen(display);
+   rootWindow = RootWindow(display, rootScreen);
+   rootWidth = DisplayWidth(display, rootScreen);
+   rootHeight = DisplayHeight(display, rootScreen);
+   rootDepth = DefaultDepth(display, rootScreen);
+   rootVisual = DefaultVisual(display, rootScreen);
+   rootColormap = DefaultColormap(display, rootScreen);
+   rootGC = DefaultGC(display, rootScreen);
+   colormapCount = MaxCmapsOfScreen(ScreenOfDisplay(display, rootScreen));
+   XSetGraphicsExposures(display, rootGC, False);
+
+#ifdef USE_XRENDER
+   haveRender = JXRenderQueryExtension(display, &renderEvent, &renderError);
+#endif
+
+   StartupColors();
+   StartupUpload();
+   StartupIcons();
+}
+
+/** Benchmark a file or the images in a directory. */
+void BenchPath(const char *path)
+{
+   struct stat st;
+   struct dirent *entry;
+   DIR *dir;
+   char **names = NULL;
+   const size_t pathLen = strlen(path) + 1;
+   unsigned count = 0;
+   unsigned i;
+
+   if(stat(path, &st) < 0) {
+      return;
+   }
+   if(!S_ISDIR(st.st_mode)) {
+      const char *name = strrchr(path, '/');
+      BenchFile(path, name ? name + 1 : path);
+      return;
+   }
+
+   /* Read the directory and sort the names for a stable order. */
+   dir = opendir(path);
+   if(!dir) {
+      return;
+   }
+   while((entry = readdir(dir)) != NULL) {
+      if(entry->d_name[0] != '.') {
+         const size_t len = pathLen + strlen(entry->d_name) + 1;
+         if(names) {
+            names = Reallocate(names, sizeof(char*) * (count + 1));
+         } else {
+            names = Allocate(sizeof(char*));
+         }
+         names[count] = Allocate(len);
+         snprintf(names[count], len, "%s/%s", path, entry->d_name);
+         count += 1;
+      }
+   }
+   closedir(dir);
+
+   qsort(names, count, sizeof(char*), CompareNames);
+   for(i = 0; i < count; i++) {
+      BenchFile(names[i], &names[i][pathLen]);
+      Release(names[i]);
+   }
+   if(names) {
+      Release(names);
+   }
+}
+
+/** Compare file names for qsort. */
+int CompareNames(const void *a, const void *b)
+{
+   return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/** Benchmark an image file. */
+void BenchFile(const char *fileName, const char *label)
+{
+   static const char *const FORMATS[][2] = {
+      { ".png",   "png"    },
+      { ".jpg",   "jpeg"   },
+      { ".jpeg",  "jpeg"   },
+      { ".svg",   "svg"    },
+      { ".xpm",   "xpm"    },
+      { ".xbm",   "xbm"    }
+   };
+   const size_t len = strlen(fileName);
+   unsigned i;
+
+   for(i = 0; i < ARRAY_LENGTH(FORMATS); i++) {
+      const size_t extLen = strlen(FORMATS[i][0]);
+      if(len > extLen && !StrCmpNoCase(&fileName[len - extLen],
+                                       FORMATS[i][0])) {
+         break;
+      }
+   }
+   if(i == ARRAY_LENGTH(FORMATS)) {
+      return;
+   }
+
+   /* XPM and XBM images need the X connection to decode. */
+   if(!display && !CanLoadImageAsync(fileName)) {
+      return;
+   }
+
+   BenchImage(fileName, label, FORMATS[i][1], 0, 0);
+   if(!strcmp(FORMATS[i][1], "svg")) {
+      BenchImage(fileName, label, FORMATS[i][1],
+                 LARGE_SVG_SIZE, LARGE_SVG_SIZE);
+   }
+}
+
+/** Measure decoding, conversion, uploading, and drawing of an image.
+ * Conversion and upload are measured at the size of the decoded image
+ * as for backgrounds; drawing creates a new icon, which scales,
+ * converts, and uploads the image at the icon size.
+ * The fastest of the iterations is reported for each step since it is
+ * the least affected by other load on the machine.  If that is still
+ * slower than the baseline, the image is measured again before the
+ * slowdown is reported.
+ */
+void BenchImage(const char *fileName, const char *label,
+                const char *format, int rwidth, int rheight)
+{
+   ImageNode *image;
+   Pixmap pmap = None;
+   char key[512];
+   double decodeTime = HUGE_VAL;
+   double convertTime = HUGE_VAL;
+   double uploadTime = HUGE_VAL;
+   double drawTime = HUGE_VAL;
+   double start, elapsed;
+   unsigned long bytes = 0;
+   char render = 0;
+   int width = 0, height = 0;
+   unsigned attempt;
+   unsigned i = 0;
+
+#ifdef USE_XRENDER
+   render = display && haveRender;
+#endif
+   if(display) {
+      pmap = JXCreatePixmap(display, rootWindow, ICON_SIZE, ICON_SIZE,
+                            rootDepth);
+   }
+
+   for(attempt = 0; attempt < BENCH_ATTEMPTS; attempt++) {
+      for(i = 0; i < iterations; i++) {
+
+         start = GetSeconds();
+         image = LoadImage(fileName, rwidth, rheight, 1);
+         elapsed = GetSeconds() - start;
+         decodeTime = Min(decodeTime, elapsed);
+         if(JUNLIKELY(!image)) {
+            break;
+         }
+         width = image->width;
+         height = image->height;
+
+         if(render) {
+            XImage *data;
+            Pixmap argb;
+            GC gc;
+
+            start = GetSeconds();
+            data = CreateRenderImage(image, 0, width, height);
+            elapsed = GetSeconds() - start;
+            convertTime = Min(convertTime, elapsed);
+            bytes = (unsigned long)data->bytes_per_line * data->height;
+
+            argb = JXCreatePixmap(display, rootWindow, width, height, 32);
+            gc = GetPoolGC(argb, 32);
+            JXSync(display, False);
+            start = GetSeconds();
+            UploadImage(argb, gc, data);
+            JXSync(display, False);
+            elapsed = GetSeconds() - start;
+            uploadTime = Min(uploadTime, elapsed);
+            ReleasePoolGC(gc);
+            JXFreePixmap(display, argb);
+            DestroyUploadImage(data);
+         }
+
+         if(display) {
+            IconNode *icon = CreateIconFromImage(image, 1);
+            start = GetSeconds();
+            PutIcon(icon, pmap, 0, 0, 0, ICON_SIZE, ICON_SIZE);
+            JXSync(display, False);
+            elapsed = GetSeconds() - start;
+            drawTime = Min(drawTime, elapsed);
+            DestroyIcon(icon);
+         } else {
+            DestroyImage(image);
+         }
+
+      }
+      if(i < iterations) {
+         break;
+      }
+
+      /* Stop unless a step is slower than the baseline. */
+      snprintf(key, sizeof(key), "%s %dx%d", label, width, height);
+      if(!IsSlower(key, "decode_ms", decodeTime * 1000.0)
+         && !(render && IsSlower(key, "convert_ms", convertTime * 1000.0))
+         && !(render && IsSlower(key, "upload_ms", uploadTime * 1000.0))
+         && !(display && IsSlower(key, "icon_ms", drawTime * 1000.0))) {
+         break;
+      }
+   }
+
+   if(pmap != None) {
+      JXFreePixmap(display, pmap);
+   }
+   if(i < iterations) {
+      return;
+   }
+
+   decodeTime *= 1000.0;
+   convertTime *= 1000.0;
+   uploadTime *= 1000.0;
+   drawTime *= 1000.0;
+
+   printf("%s\n    {\"file\": ", firstResult ? "" : ",");
+   PrintString(label);
+   printf(", \"format\": \"%s\", ", format);
+   printf("\"width\": %d, \"height\": %d, ", width, height);
+   printf("\"decode_ms\": %.3f, ", decodeTime);
+   printf("\"decode_mpix_s\": %.2f",
+          (double)width * height / 1e3 / Max(decodeTime, 1e-6));
+   if(render) {
+      printf(", \"convert_ms\": %.3f", convertTime);
+      printf(", \"convert_mpix_s\": %.2f",
+             (double)width * height / 1e3 / Max(convertTime, 1e-6));
+      printf(", \"upload_ms\": %.3f", uploadTime);
+      printf(", \"upload_mb_s\": %.2f",
+             (double)bytes / 1e3 / Max(uploadTime, 1e-6));
+   }
+   if(display) {
+      printf(", \"icon_ms\": %.3f", drawTime);
+   }
+   printf("}");
+   firstResult = 0;
+
+   Report(key, "decode_ms", decodeTime);
+   if(render) {
+      Report(key, "convert_ms", convertTime);
+      Report(key, "upload_ms", uploadTime);
+   }
+   if(display) {
+      Report(key, "icon_ms", drawTime);
+   }
+}
+
+/** Record a measurement and compare it to the baseline. */
+void Report(const char *key, const char *metric, double ms)
+{
+   if(baselineOut) {
+      fprintf(baselineOut, "%s %s %.3f\n", key, metric, ms);
+   }
+
+   if(IsSlower(key, metric, ms)) {
+      const BaselineNode *bp = FindBaseline(key, metric);
+      char buffer[640];
+      snprintf(buffer, sizeof(buffer), "%s %s: %.3f ms, baseline %.3f ms",
+               key, metric, ms, bp->value);
+      if(regressions) {
+         regressions = Reallocate(regressions,
+                                  sizeof(char*) * (regressionCount + 1));
+      } else {
+         regressions = Allocate(sizeof(char*));
+      }
+      regressions[regressionCount] = CopyString(buffer);
+      regressionCount += 1;
+   }
+}
+
+/** Determine if a measurement is slower than the baseline allows. */
+char IsSlower(const char *key, const char *metric, double ms)
+{
+   const BaselineNode *bp = FindBaseline(key, metric);
+   if(bp) {
+      const double limit = bp->value * (1.0 + tolerance / 100.0);
+      return ms > limit && ms - bp->value >= MIN_REGRESSION_MS;
+   }
+   return 0;
+}
+
+/** Find the baseline for a measurement. */
+const BaselineNode *FindBaseline(const char *key, const char *metric)
+{
+   const BaselineNode *bp;
+   for(bp = baseline; bp; bp = bp->next) {
+      if(!strcmp(bp->key, key) && !strcmp(bp->metric, metric)) {
+         return bp;
+      }
+   }
+   return NULL;
+}
+
+/** Read a baseline written with -w.
+ * Each line holds an image name, its size, a metric, and a time in
+ * milliseconds.  The name is everything before the size.
+ */
+char ReadBaseline(const char *fileName)
+{
+   char line[640];
+   FILE *fd = fopen(fileName, "r");
+   if(!fd) {
+      return 0;
+   }
+   while(fgets(line, sizeof(line), fd)) {
+      BaselineNode *bp;
+      char *value;
+      char *metric;
+      char *end;
+
+      if(line[0] == '#') {
+         continue;
+      }
+      end = line + strlen(line);
+      while(end > line && isspace((unsigned char)end[-1])) {
+         end -= 1;
+      }
+      *end = 0;
+      value = strrchr(line, ' ');
+      if(!value) {
+         continue;
+      }
+      *value++ = 0;
+      metric = strrchr(line, ' ');
+      if(!metric) {
+         continue;
+      }
+      *metric++ = 0;
+
+      bp = Allocate(sizeof(BaselineNode));
+      bp->key = CopyString(line);
+      bp->metric = CopyString(metric);
+      bp->value = atof(value);
+      bp->next = baseline;
+      baseline = bp;
+   }
+   fclose(fd);
+   return 1;
+}
+
+/** Release the baseline. */
+void DestroyBaseline(void)
+{
+   while(baseline) {
+      BaselineNode *next = baseline->next;
+      Release(baseline->key);
+      Release(baseline->metric);
+      Release(baseline);
+      baseline = next;
+   }
+}
+
+/** Print a JSON string. */
+void PrintString(const char *str)
+{
+   putchar('"');
+   for(; *str; str++) {
+      const unsigned char c = (unsigned char)*str;
+      if(c == '"' || c == '\\') {
+         printf("\\%c", c);
+      } else if(c == '\n') {
+         printf("\\n");
+      } else if(c == '\t') {
+         printf("\\t");
+      } else if(c < 0x20) {
+         printf("\\u%04x", c);
+      } else {
+         putchar(c);
+      }
+   }
+   putchar('"');
+}
@@ -16,13 +16,30 @@
 #include "font.h"
 #include "misc.h"
 #include "settings.h"
-#include "grab.h"
+
+/** Frame appearance flags stored with the canvas. */
+#define LOOK_HIGHLIGHT  1  /**< Active or flashing colors. */
+#define LOOK_FOCUS      2  /**< Active buttons. */
 
 static char *buttonNames[BI_COUNT];
 static IconNode *buttonIcons[BI_COUNT];
+static GC borderGC;
+
+/** Incremented when icon images change; canvases drawn with an older
+ * generation are rendered again. */
+static unsigned iconGeneration = 0;
 
 static char IsContextEnabled(MouseContextType context, const ClientNode *np);
-static void DrawBorderHelper(const ClientNode *np);
+static void DrawBorderHelper(ClientNode *np);
+static char *GetBorderTitle(const ClientNode *np);
+static void GetBorderColors(const ClientNode *np, long *color1, long *color2,
+                            GradientDirection *gradient);
+static char HasTitleBar(const ClientNode *np);
+static unsigned GetGradientHeight(void);
+static void RenderBorderCanvas(ClientNode *np);
+static void RenderBorderTitle(ClientNode *np);
+static void DrawBorderTitle(const ClientNode *np);
+static void CopyBorderCanvas(const ClientNode *np);
 static void DrawBorderHandles(const ClientNode *np,
                               Pixmap canvas, GC gc);
 static void DrawBorderButton(const ClientNode *np, MouseContextType context,
@@ -74,6 +91,14 @@ void StartupBorders(void)
    if(buttonIcons[BI_MENU] == NULL) {
       buttonIcons[BI_MENU] = GetDefaultIcon();
    }
+
+   borderGC = JXCreateGC(display, rootWindow, 0, NULL);
+}
+
+/** Release server resources. */
+void ShutdownBorders(void)
+{
+   JXFreeGC(display, borderGC);
 }
 
 /** Destroy structures. */
@@ -255,8 +280,6 @@ void ResetBorder(const ClientNode *np)
       return;
    }
 
-   GrabServer();
-
    /* Determine the size of the window. */
    GetBorderSize(&np->state, &north, &south, &east, &west);
    width = np->width + east + west;
@@ -274,8 +297,6 @@ void ResetBorder(const ClientNode *np)
    JXMoveResizeWindow(display, np->parent, np->x - west, np->y - north,
                       width, height);
 
-   UngrabServer();
-
 }
 
 /** Draw a client border. */
@@ -312,126 +333,302 @@ void DrawBorder(ClientNode *np)
 
 }
 
-/** Helper method for drawing borders. */
-void DrawBorderHelper(const ClientNode *np)
+/** Invalidate the cached drawing of a frame. */
+void InvalidateBorder(ClientNode *np)
 {
-   ColorType borderTextColor;
+   FrameCanvas *cp = &np->canvas;
+   if(cp->pixmap != None) {
+      JXFreePixmap(display, cp->pixmap);
+      cp->pixmap = None;
+   }
+   if(cp->title) {
+      Release(cp->title);
+      cp->title = NULL;
+   }
+}
 
-   long titleColor1, titleColor2;
-   long outlineColor;
-   GradientDirection gradient;
+/** Redraw the icons on all borders. */
+void UpdateBorderIcons(void)
+{
+   iconGeneration += 1;
+   ExposeCurrentDesktop();
+}
 
+/** Helper method for drawing borders. */
+void DrawBorderHelper(ClientNode *np)
+{
+   FrameCanvas *cp = &np->canvas;
+   unsigned char look;
    int north, south, east, west;
-   unsigned int width, height;
-   const int titleHeight = GetTitleHeight();
-
-   Pixmap canvas;
-   GC gc;
+   int width;
+   char *title;
 
    Assert(np);
 
    GetBorderSize(&np->state, &north, &south, &east, &west);
    width = np->width + east + west;
-   height = np->height + north + south;
 
-   /* Determine the colors and gradients to use. */
+   /* Determine how the frame should look. */
+   look = 0;
    if(np->state.status & (STAT_ACTIVE | STAT_FLASH)) {
-      borderTextColor = COLOR_TITLE_ACTIVE_FG;
-      titleColor1 = colors[COLOR_TITLE_ACTIVE_BG1];
-      titleColor2 = colors[COLOR_TITLE_ACTIVE_BG2];
-      outlineColor = colors[COLOR_TITLE_ACTIVE_DOWN];
-      gradient = gradients[COLOR_TITLE_ACTIVE_BG1];
+      look |= LOOK_HIGHLIGHT;
+   }
+   if((np->state.status & STAT_ACTIVE) && IsClientOnCurrentDesktop(np)) {
+      look |= LOOK_FOCUS;
+   }
+   title = GetBorderTitle(np);
+
+   if(cp->pixmap == None || cp->width != width || cp->north != north
+      || cp->look != look || cp->icon != np->icon
+      || cp->iconGeneration != iconGeneration
+      || cp->border != np->state.border
+      || cp->maxFlags != np->state.maxFlags) {
+
+      /* Something other than the title changed, render everything. */
+      if(cp->pixmap != None && (cp->width != width || cp->north != north)) {
+         JXFreePixmap(display, cp->pixmap);
+         cp->pixmap = None;
+      }
+      if(cp->pixmap == None) {
+         cp->pixmap = JXCreatePixmap(display, np->parent, width, north,
+                                     rootDepth);
+      }
+      cp->width = width;
+      cp->north = north;
+      cp->look = look;
+      cp->icon = np->icon;
+      cp->iconGeneration = iconGeneration;
+      cp->border = np->state.border;
+      cp->maxFlags = np->state.maxFlags;
+      if(cp->title) {
+         Release(cp->title);
+      }
+      cp->title = title;
+      RenderBorderCanvas(np);
+      CopyBorderCanvas(np);
+
+   } else if(strcmp(cp->title ? cp->title : "", title ? title : "")) {
+
+      /* Only the title changed. */
+      if(cp->title) {
+         Release(cp->title);
+      }
+      cp->title = title;
+      RenderBorderTitle(np);
+
    } else {
-      borderTextColor = COLOR_TITLE_FG;
-      titleColor1 = colors[COLOR_TITLE_BG1];
-      titleColor2 = colors[COLOR_TITLE_BG2];
-      outlineColor = colors[COLOR_TITLE_DOWN];
-      gradient = gradients[COLOR_TITLE_BG1];
+
+      /* Nothing changed, copy the cached canvas. */
+      if(title) {
+         Release(title);
+      }
+      CopyBorderCanvas(np);
+
    }
+}
+
+/** Get the title to show on a frame (NULL for none). */
+char *GetBorderTitle(const ClientNode *np)
+{
+   char *title;
+   if(!np->name || !np->name[0]) {
+      return NULL;
+   }
+   if(settings.showClientName && np->clientName && np->clientName[0]) {
+      /* Space for 2 delimiters, space, terminator, and strings */
+      const size_t buffSize = strlen(np->name) + strlen(np->clientName) + 4;
+      title = Allocate(buffSize);
+      sprintf(title, "%s %c%s%c", np->name,
+              settings.clientNameDelimiters[0], np->clientName,
+              settings.clientNameDelimiters[1]);
+   } else {
+      title = CopyString(np->name);
+   }
+   return title;
+}
+
+/** Get the title bar colors for a frame. */
+void GetBorderColors(const ClientNode *np, long *color1, long *color2,
+                     GradientDirection *gradient)
+{
+   if(np->canvas.look & LOOK_HIGHLIGHT) {
+      *color1 = colors[COLOR_TITLE_ACTIVE_BG1];
+      *color2 = colors[COLOR_TITLE_ACTIVE_BG2];
+      *gradient = gradients[COLOR_TITLE_ACTIVE_BG1];
+   } else {
+      *color1 = colors[COLOR_TITLE_BG1];
+      *color2 = colors[COLOR_TITLE_BG2];
+      *gradient = gradients[COLOR_TITLE_BG1];
+   }
+}
+
+/** Determine if a frame has a title bar. */
+char HasTitleBar(const ClientNode *np)
+{
+   return (np->state.border & BORDER_TITLE)
+       && !(np->state.maxFlags && (np->state.border & TITLE_NOMAX))
+       && (int)GetTitleHeight() > settings.borderWidth;
+}
+
+/** Get the height of the title bar gradient. */
+unsigned GetGradientHeight(void)
+{
+   const unsigned titleHeight = GetTitleHeight();
+   if(settings.windowDecorations == DECO_MOTIF) {
+      return titleHeight + settings.borderWidth;
+   } else {
+      return titleHeight;
+   }
+}
+
+/** Render the title bar of a frame to its canvas. */
+void RenderBorderCanvas(ClientNode *np)
+{
+   FrameCanvas *cp = &np->canvas;
+   long titleColor1, titleColor2;
+   GradientDirection gradient;
+
+   GetBorderColors(np, &titleColor1, &titleColor2, &gradient);
 
    /* Set parent background to reduce flicker. */
    JXSetWindowBackground(display, np->parent, titleColor2);
 
-   canvas = JXCreatePixmap(display, np->parent, width, north, rootDepth);
-   gc = JXCreateGC(display, canvas, 0, NULL);
-
-   /* Clear the window with the right color. */
-   JXSetForeground(display, gc, titleColor2);
-   JXFillRectangle(display, canvas, gc, 0, 0, width, north);
+   /* Clear the canvas with the right color. */
+   JXSetForeground(display, borderGC, titleColor2);
+   JXFillRectangle(display, cp->pixmap, borderGC, 0, 0,
+                   cp->width, cp->north);
 
    /* Draw the top part (either a title or north border). */
-   if((np->state.border & BORDER_TITLE) &&
-      !(np->state.maxFlags && (np->state.border & TITLE_NOMAX)) &&
-      titleHeight > settings.borderWidth) {
+   cp->titleStart = 0;
+   cp->titleEnd = 0;
+   if(HasTitleBar(np)) {
 
       XPoint point;
-      const unsigned gradientHeight
-        = settings.windowDecorations == DECO_MOTIF
-        ? titleHeight + settings.borderWidth : titleHeight;
 
       /* Draw a title bar. */
-      DrawGradient(canvas, gc, titleColor1, titleColor2,
-                   0, 0, width, gradientHeight, gradient);
+      DrawGradient(cp->pixmap, borderGC, titleColor1, titleColor2,
+                   0, 0, cp->width, GetGradientHeight(), gradient);
 
       /* Draw the buttons.
        * This returns the start and end positions of the title as `x` and `y`.
        */
-      point = DrawBorderButtons(np, canvas, gc);
+      point = DrawBorderButtons(np, cp->pixmap, borderGC);
+      cp->titleStart = point.x;
+      cp->titleEnd = point.y;
 
       /* Draw the title. */
-      if(np->name && np->name[0] && point.x < point.y) {
-         unsigned titleWidth = point.y - point.x;
-         const int sheight = GetStringHeight(FONT_BORDER);
-         char *titleBuffer;
-         if (settings.showClientName && np->clientName && np->clientName[0]){
-             /* Space for 2 delimiters, space, terminator, and strings */
-             const size_t buffSize = strlen(np->name) + strlen(np->clientName) + 4;
-             titleBuffer = Allocate(buffSize);
-             sprintf(titleBuffer,"%s %c%s%c",np->name,
-                     settings.clientNameDelimiters[0],np->clientName,
-                     settings.clientNameDelimiters[1]);
-         } else {
-             titleBuffer = CopyString(np->name);
-         }
-         const int textWidth = GetStringWidth(FONT_BORDER,titleBuffer);
-         unsigned titlex, titley;
-         int xoffset = 0;
-
-         switch (settings.titleTextAlignment) {
-         case ALIGN_CENTER:
-            xoffset = (int)(titleWidth - textWidth) / 2;
-            break;
-         case ALIGN_RIGHT:
-            xoffset = (titleWidth - textWidth);
-            break;
-         }
-         xoffset = Max(xoffset, 0);
-         titlex = point.x + xoffset;
-         titlex = Min(Max(titlex, point.x), point.y);
+      DrawBorderTitle(np);
 
-         titleWidth = Min(titleWidth, point.y - titlex);
+   }
+}
 
-         titley = (titleHeight - sheight) / 2;
-         if(settings.windowDecorations == DECO_MOTIF) {
-            titley += south - 1;
-         }
-         RenderString(canvas, FONT_BORDER, borderTextColor,
-                      titlex, titley, titleWidth, titleBuffer);
-         Release(titleBuffer);
+/** Redraw only the title of a frame and copy it to the frame. */
+void RenderBorderTitle(ClientNode *np)
+{
+   FrameCanvas *cp = &np->canvas;
+   long titleColor1, titleColor2;
+   GradientDirection gradient;
+   XRectangle rect;
+   int off;
+
+   if(cp->titleStart >= cp->titleEnd) {
+      return;
+   }
+
+   GetBorderColors(np, &titleColor1, &titleColor2, &gradient);
+
+   /* Restore the background of the title area. */
+   rect.x = cp->titleStart;
+   rect.y = 0;
+   rect.width = cp->titleEnd - cp->titleStart;
+   rect.height = cp->north;
+   JXSetClipRectangles(display, borderGC, 0, 0, &rect, 1, Unsorted);
+   JXSetForeground(display, borderGC, titleColor2);
+   JXFillRectangle(display, cp->pixmap, borderGC,
+                   rect.x, rect.y, rect.width, rect.height);
+   DrawGradient(cp->pixmap, borderGC, titleColor1, titleColor2,
+                0, 0, cp->width, GetGradientHeight(), gradient);
+   JXSetClipMask(display, borderGC, None);
+
+   DrawBorderTitle(np);
+
+   /* Copy the title area to the frame. */
+   off = settings.windowDecorations == DECO_MOTIF ? 2 : 1;
+   rect.x = Max(cp->titleStart, off);
+   rect.width = Min(cp->titleEnd, cp->width - off) - rect.x;
+   if(rect.width > 0 && cp->north > off) {
+      JXCopyArea(display, cp->pixmap, np->parent, borderGC,
+                 rect.x, off, rect.width, cp->north - off, rect.x, off);
+      if(settings.windowDecorations == DECO_MOTIF) {
+         DrawBorderHandles(np, np->parent, borderGC);
       }
+   }
+}
+
+/** Draw the title text on the canvas of a frame. */
+void DrawBorderTitle(const ClientNode *np)
+{
+   const FrameCanvas *cp = &np->canvas;
+   const ColorType borderTextColor = (cp->look & LOOK_HIGHLIGHT)
+                                   ? COLOR_TITLE_ACTIVE_FG : COLOR_TITLE_FG;
+   const int titleHeight = GetTitleHeight();
+   const int sheight = GetStringHeight(FONT_BORDER);
+   unsigned titleWidth;
+   unsigned titlex, titley;
+   int textWidth;
+   int xoffset = 0;
+   int north, south, east, west;
 
+   if(!cp->title || cp->titleStart >= cp->titleEnd) {
+      return;
+   }
+
+   titleWidth = cp->titleEnd - cp->titleStart;
+   textWidth = GetStringWidth(FONT_BORDER, cp->title);
+   switch (settings.titleTextAlignment) {
+   case ALIGN_CENTER:
+      xoffset = (int)(titleWidth - textWidth) / 2;
+      break;
+   case ALIGN_RIGHT:
+      xoffset = (titleWidth - textWidth);
+      break;
    }
+   xoffset = Max(xoffset, 0);
+   titlex = cp->titleStart + xoffset;
+   titlex = Min(Max(titlex, cp->titleStart), cp->titleEnd);
+
+   titleWidth = Min(titleWidth, cp->titleEnd - titlex);
+
+   titley = (titleHeight - sheight) / 2;
+   if(settings.windowDecorations == DECO_MOTIF) {
+      GetBorderSize(&np->state, &north, &south, &east, &west);
+      titley += south - 1;
+   }
+   RenderString(cp->pixmap, FONT_BORDER, borderTextColor,
+                titlex, titley, titleWidth, cp->title);
+}
+
+/** Copy the canvas of a frame to the frame and draw the outline. */
+void CopyBorderCanvas(const ClientNode *np)
+{
+   const FrameCanvas *cp = &np->canvas;
+   const int width = cp->width;
+   int north, south, east, west;
+   int height;
+
+   GetBorderSize(&np->state, &north, &south, &east, &west);
+   height = np->height + north + south;
 
    /* Copy the pixmap for the title bar and clear the part of
     * the window to be drawn directly. */
    if(settings.windowDecorations == DECO_MOTIF) {
       const int off = 2;
-      JXCopyArea(display, canvas, np->parent, gc, off, off,
+      JXCopyArea(display, cp->pixmap, np->parent, borderGC, off, off,
          width - 2 * off, north - off, off, off);
       JXClearArea(display, np->parent,
          off, north, width - 2 * off, height - north - off, False);
    } else {
-      JXCopyArea(display, canvas, np->parent, gc, 1, 1,
+      JXCopyArea(display, cp->pixmap, np->parent, borderGC, 1, 1,
          width - 2, north - 1, 1, 1);
       JXClearArea(display, np->parent,
          1, north, width - 2, height - north - 1, False);
@@ -439,19 +636,20 @@ void DrawBorderHelper(const ClientNode *np)
 
    /* Window outline. */
    if(settings.windowDecorations == DECO_MOTIF) {
-      DrawBorderHandles(np, np->parent, gc);
+      DrawBorderHandles(np, np->parent, borderGC);
    } else {
-      JXSetForeground(display, gc, outlineColor);
+      const long outlineColor = (cp->look & LOOK_HIGHLIGHT)
+                              ? colors[COLOR_TITLE_ACTIVE_DOWN]
+                              : colors[COLOR_TITLE_DOWN];
+      JXSetForeground(display, borderGC, outlineColor);
       if(np->state.status & STAT_SHADED) {
-         JXDrawRectangle(display, np->parent, gc, 0, 0, width - 1, north - 1);
+         JXDrawRectangle(display, np->parent, borderGC,
+                         0, 0, width - 1, north - 1);
       } else {
-         JXDrawRectangle(display, np->parent, gc, 0, 0, width - 1, height - 1);
+         JXDrawRectangle(display, np->parent, borderGC,
+                         0, 0, width - 1, height - 1);
       }
    }
-
-   JXFreePixmap(display, canvas);
-   JXFreeGC(display, gc);
-
 }
 
 /** Draw window handles. */
@@ -33,7 +33,7 @@ typedef unsigned char BorderIconType;
 /*@{*/
 void InitializeBorders(void);
 void StartupBorders(void);
-#define ShutdownBorders()      (void)(0)
+void ShutdownBorders(void);
 void DestroyBorders(void);
 /*@}*/
 
@@ -56,6 +56,19 @@ void ResetBorder(const struct ClientNode *np);
  */
 void DrawBorder(struct ClientNode *np);
 
+/** Discard the cached drawing of a window border.
+ * This must be called when the frame is destroyed or when the icon
+ * of the client is replaced.
+ * @param np The client.
+ */
+void InvalidateBorder(struct ClientNode *np);
+
+/** Redraw the icons on all borders.
+ * This is called when icon images change without the icon nodes
+ * changing, for example when an icon has been decoded in the background.
+ */
+void UpdateBorderIcons(void);
+
 /** Get the size of a border icon.
  * @return The size in pixels (note that icons are square).
  */
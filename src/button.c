@@ -15,6 +15,7 @@
 #include "image.h"
 #include "misc.h"
 #include "settings.h"
+#include "drawpool.h"
 
 /** Determine the colors to use. */
 static void GetButtonColors(ButtonNode *bp, ColorType *fg, long *bg1, long *bg2,
@@ -186,7 +187,7 @@ void DrawButton(ButtonNode *bp)
    y = bp->y;
    width = bp->width;
    height = bp->height;
-   gc = JXCreateGC(display, drawable, 0, NULL);
+   gc = GetPoolGC(drawable, rootDepth);
 
    /* Determine the colors to use. */
    GetButtonColors(bp, &fg, &bg1, &bg2, &up, &down, &decorations, &gradient);
@@ -298,7 +299,7 @@ void DrawButton(ButtonNode *bp)
       }
    }
 
-   JXFreeGC(display, gc);
+   ReleasePoolGC(gc);
 
 }
 
@@ -0,0 +1,105 @@
+#!/bin/sh
+#
+# Check pager thumbnails under Xvfb.
+#
+# Starts Xvfb, runs ggwm with a tray that holds only a pager with
+# thumbnails="true", maps a magenta xterm, and captures the root window
+# with xwd.  The pager must show the magenta window contents.  The run
+# is then repeated with Composite disabled, where the pager must fall
+# back to the plain rectangles.
+#
+# usage: check-thumbnails.sh [ggwm]
+#
+# Exits with 77 if Xvfb, xterm, xwd, or python3 is missing.
+#
+
+GGWM=${1:-./ggwm}
+NUMBER=${THUMBNAIL_DISPLAY:-97}
+TMP=${TMPDIR:-/tmp}/ggwm-thumbnails.$$
+
+for tool in Xvfb xterm xwd python3 ; do
+   if ! command -v $tool >/dev/null 2>&1 ; then
+      echo "check-thumbnails: $tool not found, skipped" >&2
+      exit 77
+   fi
+done
+
+mkdir -p $TMP || exit 1
+trap 'kill $CLIENT $WM $SERVER 2>/dev/null ; rm -rf $TMP' EXIT
+
+cat > $TMP/ggwmrc <<EOF
+<?xml version="1.0"?>
+<JWM>
+    <Tray x="0" y="0" width="320" height="48" autohide="off">
+        <Pager thumbnails="true"/>
+    </Tray>
+    <TrayStyle>
+        <Background>#000000</Background>
+    </TrayStyle>
+    <PagerStyle>
+        <Outline>#000000</Outline>
+        <Foreground>#404040</Foreground>
+        <Background>#000000</Background>
+        <Active>
+            <Foreground>#808080</Foreground>
+            <Background>#202020</Background>
+        </Active>
+    </PagerStyle>
+    <Desktops width="1" height="1"/>
+</JWM>
+EOF
+
+# Count the magenta pixels in the tray of an xwd capture.
+count_magenta() {
+   python3 - "$1" <<'EOF'
+import struct, sys
+data = open(sys.argv[1], 'rb').read()
+h = struct.unpack('>25I', data[:100])
+size, width, height = h[0], h[4], h[5]
+order = 'little' if h[7] == 0 else 'big'
+bpp, stride, masks = h[11] // 8, h[12], h[14:17]
+pixels = size + h[19] * 12
+shifts = [(m & -m).bit_length() - 1 for m in masks]
+count = 0
+for y in range(min(48, height)):
+   for x in range(min(320, width)):
+      off = pixels + y * stride + x * bpp
+      p = int.from_bytes(data[off:off + bpp], order)
+      r, g, b = [((p & m) >> s) * 255 // (m >> s) for m, s in zip(masks, shifts)]
+      if r > 200 and g < 60 and b > 200:
+         count += 1
+print(count)
+EOF
+}
+
+# Run one session and print the number of magenta pixels in the pager.
+run() {
+   Xvfb :$NUMBER -screen 0 640x480x24 -nolisten tcp "$@" 2>/dev/null &
+   SERVER=$!
+   sleep 1
+   DISPLAY=:$NUMBER $GGWM -f $TMP/ggwmrc 2>/dev/null &
+   WM=$!
+   sleep 1
+   DISPLAY=:$NUMBER xterm -bg magenta -fg magenta -geometry 80x24+0+60 &
+   CLIENT=$!
+   sleep 2
+   DISPLAY=:$NUMBER xwd -root -silent > $TMP/root.xwd
+   kill $CLIENT $WM $SERVER 2>/dev/null
+   wait $CLIENT $WM $SERVER 2>/dev/null
+   count_magenta $TMP/root.xwd
+}
+
+WITH=`run`
+WITHOUT=`run -extension Composite`
+echo "check-thumbnails: $WITH magenta pixels with Composite," \
+     "$WITHOUT without"
+
+if [ "$WITH" -lt 100 ] ; then
+   echo "check-thumbnails: the pager does not show the window" >&2
+   exit 1
+fi
+if [ "$WITHOUT" -ne 0 ] ; then
+   echo "check-thumbnails: the pager did not fall back without Composite" >&2
+   exit 1
+fi
+exit 0
@@ -25,17 +25,44 @@
 #include "timing.h"
 #include "grab.h"
 #include "desktop.h"
+#include "thumbnail.h"
+#include "prefetch.h"
+#include "misc.h"
 
 static ClientNode *activeClient;
 
 unsigned int clientCount;
 
+/** A window and its position in the previous stacking order. */
+typedef struct StackEntry {
+   Window window;
+   int index;
+} StackEntry;
+
+/** Windows unmapped during a batch whose UnmapNotify is still queued. */
+static Window *unmapWindows = NULL;
+static unsigned int unmapCount = 0;
+static unsigned int unmapCapacity = 0;
+static unsigned int unmapBatch = 0;
+
+/** Stacking order last sent to the server, from top to bottom. */
+static Window *stackOrder = NULL;
+static unsigned int stackCount = 0;
+
 static void LoadFocus(void);
 static void RestackTransients(const ClientNode *np);
 static void MinimizeTransients(ClientNode *np, char lower);
 static void RestoreTransients(ClientNode *np, char raise);
 static void KillClientHandler(ClientNode *np);
 static void UnmapClient(ClientNode *np);
+static void SignalTitle(const TimeType *now, int x, int y, Window w,
+                        void *data);
+static void SendStackOrder(const Window *stack, unsigned int count);
+static char IsSameOrder(const Window *order, unsigned int count,
+                        const Window *windows, unsigned int newCount);
+static void SaveOrder(Window **order, unsigned int *count,
+                      Window *windows, unsigned int newCount);
+static int CompareStackEntries(const void *a, const void *b);
 
 /** Load windows that are already mapped. */
 void StartupClients(void)
@@ -61,13 +88,17 @@ void StartupClients(void)
    JXQueryTree(display, rootWindow, &rootReturn, &parentReturn,
                &childrenReturn, &childrenCount);
 
+   /* Read the attributes and hints of every window at once. */
+   PrefetchWindows(childrenReturn, childrenCount);
+
    /* Add each client. */
    for(x = 0; x < childrenCount; x++) {
-      if(JXGetWindowAttributes(display, childrenReturn[x], &attr)) {
+      if(PrefetchWindow(childrenReturn[x], &attr)) {
          if(attr.override_redirect == False && attr.map_state == IsViewable) {
             AddClientWindow(childrenReturn[x], 1, 1);
          }
       }
+      ReleasePrefetch(childrenReturn[x]);
    }
 
    JXFree(childrenReturn);
@@ -91,6 +122,8 @@ void ShutdownClients(void)
       }
    }
 
+   InvalidateStackOrder();
+
 }
 
 /** Set the focus to the window currently under the mouse pointer. */
@@ -122,16 +155,14 @@ ClientNode *AddClientWindow(Window w, char alreadyMapped, char notOwner)
 
    Assert(w != None);
 
-   /* Get window attributes. */
-   if(JXGetWindowAttributes(display, w, &attr) == 0) {
+   /* Get window attributes and read the hints in one round trip. */
+   if(PrefetchWindow(w, &attr) == 0) {
       return NULL;
    }
 
    /* Determine if we should care about this window. */
-   if(attr.override_redirect == True) {
-      return NULL;
-   }
-   if(attr.class == InputOnly) {
+   if(attr.override_redirect == True || attr.class == InputOnly) {
+      ReleasePrefetch(w);
       return NULL;
    }
 
@@ -148,6 +179,7 @@ ClientNode *AddClientWindow(Window w, char alreadyMapped, char notOwner)
    np->y = attr.y;
    np->width = attr.width;
    np->height = attr.height;
+   np->visual = attr.visual;
    np->cmap = attr.colormap;
    np->state.status = STAT_NONE;
    np->state.maxFlags = MAX_NONE;
@@ -158,6 +190,7 @@ ClientNode *AddClientWindow(Window w, char alreadyMapped, char notOwner)
    np->mouseContext = MC_NONE;
 
    ReadClientInfo(np, alreadyMapped);
+   ReleasePrefetch(w);
 
    if(!notOwner) {
       np->state.border = BORDER_OUTLINE | BORDER_TITLE | BORDER_MOVE;
@@ -815,6 +848,7 @@ void SetClientFullScreen(ClientNode *np, char fullScreen)
 
    WriteState(np);
    SendConfigureEvent(np);
+   RequirePagerUpdate();
    RequireRestack();
 
 }
@@ -1095,7 +1129,7 @@ void RestackClients(void)
 
    /* Allocate memory for restacking. */
    trayCount = GetTrayCount();
-   stack = AllocateStack((clientCount + trayCount) * sizeof(Window));
+   stack = Allocate((clientCount + trayCount + 1) * sizeof(Window));
 
    /* Prepare the stacking array. */
    fw = None;
@@ -1151,14 +1185,160 @@ void RestackClients(void)
 
    }
 
-   JXRestackWindows(display, stack, index);
+   /* Send only the windows that moved. */
+   if(!IsSameOrder(stackOrder, stackCount, stack, index)) {
+      SendStackOrder(stack, index);
+      RequirePagerUpdate();
+   }
+   SaveOrder(&stackOrder, &stackCount, stack, index);
 
-   ReleaseStack(stack);
+   /* Minimized clients are not stacked but are in the stacking list,
+    * so let the list decide if it changed. */
    UpdateNetClientList();
-   RequirePagerUpdate();
 
 }
 
+/** Forget the stacking order last sent to the server. */
+void InvalidateStackOrder(void)
+{
+   if(stackOrder) {
+      Release(stackOrder);
+      stackOrder = NULL;
+   }
+   stackCount = 0;
+}
+
+/** Send a new stacking order to the server.
+ * Windows whose positions in the previous order form the longest
+ * increasing sequence are already in the right order relative to each
+ * other, so only the remaining windows are moved.
+ */
+void SendStackOrder(const Window *stack, unsigned int count)
+{
+
+   XWindowChanges changes;
+   StackEntry *sorted;
+   StackEntry key;
+   const StackEntry *found;
+   int *position;
+   int *tails;
+   int *prev;
+   char *fixed;
+   int length, first;
+   int i;
+
+   if(stackCount == 0 || count < 2) {
+      JXRestackWindows(display, (Window*)stack, count);
+      return;
+   }
+
+   /* Look up the previous position of each window (-1 if new). */
+   sorted = AllocateStack(stackCount * sizeof(StackEntry));
+   for(i = 0; i < stackCount; i++) {
+      sorted[i].window = stackOrder[i];
+      sorted[i].index = i;
+   }
+   qsort(sorted, stackCount, sizeof(StackEntry), CompareStackEntries);
+   position = AllocateStack(count * sizeof(int));
+   for(i = 0; i < count; i++) {
+      key.window = stack[i];
+      found = bsearch(&key, sorted, stackCount, sizeof(StackEntry),
+                      CompareStackEntries);
+      position[i] = found ? found->index : -1;
+   }
+   ReleaseStack(sorted);
+
+   /* Find the longest increasing sequence of previous positions.
+    * tails[k] is the window ending the best sequence of length k + 1. */
+   tails = AllocateStack(count * sizeof(int));
+   prev = AllocateStack(count * sizeof(int));
+   length = 0;
+   for(i = 0; i < count; i++) {
+      int low = 0;
+      int high = length;
+      if(position[i] < 0) {
+         continue;
+      }
+      while(low < high) {
+         const int mid = (low + high) / 2;
+         if(position[tails[mid]] < position[i]) {
+            low = mid + 1;
+         } else {
+            high = mid;
+         }
+      }
+      prev[i] = low > 0 ? tails[low - 1] : -1;
+      tails[low] = i;
+      if(low == length) {
+         length += 1;
+      }
+   }
+   fixed = AllocateStack(count);
+   memset(fixed, 0, count);
+   first = -1;
+   for(i = length > 0 ? tails[length - 1] : -1; i >= 0; i = prev[i]) {
+      fixed[i] = 1;
+      first = i;
+   }
+   ReleaseStack(tails);
+   ReleaseStack(prev);
+   ReleaseStack(position);
+
+   /* Place each moved window below the one before it.
+    * A moved window at the top goes above the first window that stays. */
+   if(first < 0) {
+      JXRestackWindows(display, (Window*)stack, count);
+   } else {
+      for(i = 0; i < count; i++) {
+         if(fixed[i]) {
+            continue;
+         }
+         if(i == 0) {
+            changes.sibling = stack[first];
+            changes.stack_mode = Above;
+         } else {
+            changes.sibling = stack[i - 1];
+            changes.stack_mode = Below;
+         }
+         JXConfigureWindow(display, stack[i], CWSibling | CWStackMode,
+                           &changes);
+      }
+   }
+   ReleaseStack(fixed);
+
+}
+
+/** Determine if a window order matches a saved order. */
+char IsSameOrder(const Window *order, unsigned int count,
+                 const Window *windows, unsigned int newCount)
+{
+   if(count != newCount) {
+      return 0;
+   }
+   return count == 0 || !memcmp(order, windows, count * sizeof(Window));
+}
+
+/** Replace a saved window order.
+ * This takes ownership of windows.
+ */
+void SaveOrder(Window **order, unsigned int *count,
+               Window *windows, unsigned int newCount)
+{
+   if(*order) {
+      Release(*order);
+   }
+   *order = windows;
+   *count = newCount;
+}
+
+/** Compare stack entries by window for qsort and bsearch. */
+int CompareStackEntries(const void *a, const void *b)
+{
+   const Window wa = ((const StackEntry*)a)->window;
+   const Window wb = ((const StackEntry*)b)->window;
+   return wa < wb ? -1 : (wa > wb ? 1 : 0);
+}
+
 /** Send a client message to a window. */
 void SendClientMessage(Window w, AtomType type, AtomType message)
 {
@@ -1210,6 +1390,10 @@ void RemoveClient(ClientNode *np)
    if(np->state.status & STAT_URGENT) {
       UnregisterCallback(SignalUrgent, np);
    }
+   if(np->titlePending) {
+      UnregisterCallback(SignalTitle, np);
+   }
+   RemoveThumbnail(np);
 
    /* Make sure this client isn't active */
    if(activeClient == np && !shouldExit) {
@@ -1247,6 +1431,7 @@ void RemoveClient(ClientNode *np)
    }
 
    /* Destroy the parent */
+   InvalidateBorder(np);
    if(np->parent) {
       JXDestroyWindow(display, np->parent);
    }
@@ -1255,10 +1440,10 @@ void RemoveClient(ClientNode *np)
       Release(np->name);
    }
    if(np->instanceName) {
-      JXFree(np->instanceName);
+      Release(np->instanceName);
    }
    if(np->className) {
-      JXFree(np->className);
+      Release(np->className);
    }
    if(np->clientName) {
       Release(np->clientName);
@@ -1337,6 +1522,7 @@ void ReparentClient(ClientNode *np)
 
       JXReparentWindow(display, np->window, rootWindow, np->x, np->y);
       XDeleteContext(display, np->parent, frameContext);
+      InvalidateBorder(np);
       JXDestroyWindow(display, np->parent);
       np->parent = None;
 
@@ -1488,6 +1674,46 @@ void SignalUrgent(const TimeType *now, int x, int y, Window w, void *data)
 
 }
 
+/** Read and redraw the title of a client after its name changed. */
+void RefreshClientTitle(ClientNode *np)
+{
+   TimeType now;
+
+   /* The name is read when the scheduled redraw happens. */
+   if(np->titlePending) {
+      return;
+   }
+
+   GetCurrentTime(&now);
+   if(GetTimeDifference(&now, &np->titleTime) < settings.titleDelay) {
+      TimeType when = np->titleTime;
+      AddTime(&when, settings.titleDelay);
+      RegisterCallback(CALLBACK_SCHEDULED, SignalTitle, np);
+      ScheduleCallback(SignalTitle, np, &when);
+      np->titlePending = 1;
+      return;
+   }
+
+   np->titleTime = now;
+   ReadWMName(np);
+   DrawBorder(np);
+   RequireTaskUpdate();
+   RequirePagerUpdate();
+}
+
+/** Callback for title redraws that were delayed. */
+void SignalTitle(const TimeType *now, int x, int y, Window w, void *data)
+{
+   ClientNode *np = (ClientNode*)data;
+   UnregisterCallback(SignalTitle, np);
+   np->titlePending = 0;
+   np->titleTime = *now;
+   ReadWMName(np);
+   DrawBorder(np);
+   RequireTaskUpdate();
+   RequirePagerUpdate();
+}
+
 /** Unmap a client window and consume the UnmapNotify event. */
 void UnmapClient(ClientNode *np)
 {
@@ -1498,7 +1724,18 @@ void UnmapClient(ClientNode *np)
       np->state.status &= ~STAT_MAPPED;
       JXUnmapWindow(display, np->window);
 
-      /* Discard the unmap event so we don't process it later. */
+      /* Discard the unmap event so we don't process it later.
+       * In a batch, this waits until the batch ends. */
+      if(unmapBatch > 0) {
+         if(unmapCount == unmapCapacity) {
+            unmapCapacity = Max(unmapCapacity * 2, 8);
+            unmapWindows = Reallocate(unmapWindows,
+                                      unmapCapacity * sizeof(Window));
+         }
+         unmapWindows[unmapCount] = np->window;
+         unmapCount += 1;
+         return;
+      }
       JXSync(display, False);
       if(JXCheckTypedWindowEvent(display, np->window, UnmapNotify, &e)) {
          UpdateTime(&e);
@@ -1506,3 +1743,35 @@ void UnmapClient(ClientNode *np)
    }
 }
 
+/** Start unmapping a batch of clients. */
+void BeginUnmapBatch(void)
+{
+   unmapBatch += 1;
+}
+
+/** Finish unmapping a batch of clients. */
+void EndUnmapBatch(void)
+{
+   XEvent e;
+   unsigned int i;
+
+   Assert(unmapBatch > 0);
+   unmapBatch -= 1;
+   if(unmapBatch > 0 || unmapCount == 0) {
+      return;
+   }
+
+   /* One sync queues the UnmapNotify events for the whole batch. */
+   JXSync(display, False);
+   for(i = 0; i < unmapCount; i++) {
+      if(JXCheckTypedWindowEvent(display, unmapWindows[i],
+                                 UnmapNotify, &e)) {
+         UpdateTime(&e);
+      }
+   }
+   Release(unmapWindows);
+   unmapWindows = NULL;
+   unmapCount = 0;
+   unmapCapacity = 0;
+}
+
@@ -13,6 +13,7 @@
 #include "main.h"
 #include "border.h"
 #include "hint.h"
+#include "timing.h"
 
 struct TimeType;
 
@@ -113,6 +114,24 @@ typedef struct AspectRatio {
    int maxy;   /**< The y component of the maximum aspect ratio. */
 } AspectRatio;
 
+/** Cached drawing of the top of a frame (maintained in border.c).
+ * The title bar is rendered here once and copied to the frame when it
+ * is exposed.  A title change only redraws the title area.
+ */
+typedef struct FrameCanvas {
+   Pixmap pixmap;             /**< The canvas (None if not rendered). */
+   char *title;               /**< The title on the canvas. */
+   struct IconNode *icon;     /**< The icon on the canvas. */
+   unsigned iconGeneration;   /**< Icon generation used for the canvas. */
+   int width;                 /**< The width of the canvas. */
+   int north;                 /**< The height of the canvas. */
+   int titleStart;            /**< Start of the title area. */
+   int titleEnd;              /**< End of the title area. */
+   BorderFlags border;        /**< Border flags used for the canvas. */
+   MaxFlags maxFlags;         /**< Maximization used for the canvas. */
+   unsigned char look;        /**< Highlight and focus used for the canvas. */
+} FrameCanvas;
+
 /** Struture to store information about a client window. */
 typedef struct ClientNode {
 
@@ -141,6 +160,7 @@ typedef struct ClientNode {
    AspectRatio aspect;        /**< Aspect ratio. */
    int gravity;               /**< Gravity for reparenting. */
 
+   Visual *visual;            /**< This window's visual. */
    Colormap cmap;             /**< This window's colormap. */
    ColormapNode *colormaps;   /**< Colormaps assigned to this window. */
 
@@ -155,6 +175,11 @@ typedef struct ClientNode {
 
    struct IconNode *icon;     /**< Icon assigned to this window. */
 
+   FrameCanvas canvas;        /**< Cached title bar drawing. */
+
+   TimeType titleTime;        /**< Time of the last title redraw. */
+   char titlePending;         /**< Set if a title redraw is scheduled. */
+
    /** Callback to stop move/resize. */
    void (*controller)(int wasDestroyed);
 
@@ -292,6 +317,23 @@ void RestackClient(ClientNode *np, Window above, int detail);
  */
 void RestackClients(void);
 
+/** Start unmapping a batch of clients.
+ * Clients normally wait for the server to confirm each unmap so that
+ * the UnmapNotify can be discarded.  Within a batch, this is done once
+ * for all clients by EndUnmapBatch.  No events may be processed
+ * before the batch ends.  Batches nest.
+ */
+void BeginUnmapBatch(void);
+
+/** Finish unmapping a batch of clients. */
+void EndUnmapBatch(void);
+
+/** Forget the stacking order last sent to the server.
+ * This must be called when client frames or trays are restacked
+ * without RestackClients, so that the next restack sends everything.
+ */
+void InvalidateStackOrder(void);
+
 /** Set the layer of a client.
  * @param np The client whose layer to set.
  * @param layer the layer to assign to the client.
@@ -352,5 +394,13 @@ void SendClientMessage(Window w, AtomType type, AtomType message);
 void SignalUrgent(const struct TimeType *now, int x, int y, Window w,
                   void *data);
 
+/** Read and redraw the title of a client after its name changed.
+ * Updates are limited to one per titleDelay for each client.  A change
+ * that comes too soon is handled when the delay expires, using the name
+ * current at that time.
+ * @param np The client.
+ */
+void RefreshClientTitle(ClientNode *np);
+
 #endif /* CLIENT_H */
 
@@ -172,6 +172,7 @@ void WalkWindowStack(char forward)
             wasMinimized = 0;
          }
          JXRaiseWindow(display, np->parent ? np->parent : np->window);
+         InvalidateStackOrder();
          FocusClient(np);
          break;
 
@@ -30,12 +30,14 @@ typedef struct ClockType {
    char *format;                 /**< The time format to use. */
    char *zone;                   /**< The time zone to use (NULL = local). */
    struct ActionNode *actions;   /**< Actions */
-   TimeType lastTime;            /**< Currently displayed time. */
+   char *text;                   /**< Currently displayed time. */
+   int granularity;              /**< Seconds between updates. */
 
    /* The following are used to control popups. */
    int mousex;                /**< Last mouse x-coordinate. */
    int mousey;                /**< Last mouse y-coordinate. */
    TimeType mouseTime;        /**< Time of the last mouse motion. */
+   char popup;                /**< Set while the mouse is over the clock. */
 
    int userWidth;             /**< User-specified clock width (or 0). */
 
@@ -57,8 +59,10 @@ static void ProcessClockButtonRelease(TrayComponentType *cp,
                                       int x, int y, int button);
 static void ProcessClockMotionEvent(TrayComponentType *cp,
                                     int x, int y, int mask);
+static void ProcessClockLeaveEvent(TrayComponentType *cp);
 
-static void DrawClock(ClockType *clk, const TimeType *now);
+static void DrawClock(ClockType *clk);
+static void ScheduleClock(ClockType *clk, const TimeType *now);
 
 static void SignalClock(const struct TimeType *now, int x, int y, Window w,
                         void *data);
@@ -96,6 +100,9 @@ void DestroyClock(void)
       if(clocks->zone) {
          Release(clocks->zone);
       }
+      if(clocks->text) {
+         Release(clocks->text);
+      }
       DestroyActions(clocks->actions);
       UnregisterCallback(SignalClock, clocks);
 
@@ -120,6 +127,7 @@ TrayComponentType *CreateClock(const char *format, const char *zone,
    clk->mousey = -settings.doubleClickDelta;
    clk->mouseTime.seconds = 0;
    clk->mouseTime.ms = 0;
+   clk->popup = 0;
    clk->userWidth = 0;
 
    if(!format) {
@@ -128,7 +136,8 @@ TrayComponentType *CreateClock(const char *format, const char *zone,
    clk->format = CopyString(format);
    clk->zone = CopyString(zone);
    clk->actions = NULL;
-   memset(&clk->lastTime, 0, sizeof(clk->lastTime));
+   clk->text = NULL;
+   clk->granularity = GetTimeGranularity(format);
 
    cp = CreateTrayComponent();
    cp->object = clk;
@@ -148,8 +157,9 @@ TrayComponentType *CreateClock(const char *format, const char *zone,
    cp->ProcessButtonPress = ProcessClockButtonPress;
    cp->ProcessButtonRelease = ProcessClockButtonRelease;
    cp->ProcessMotionEvent = ProcessClockMotionEvent;
+   cp->ProcessLeaveEvent = ProcessClockLeaveEvent;
 
-   RegisterCallback(Min(900, settings.popupDelay / 2), SignalClock, clk);
+   RegisterCallback(CALLBACK_SCHEDULED, SignalClock, clk);
 
    return cp;
 }
@@ -166,8 +176,11 @@ void AddClockAction(TrayComponentType *cp,
 /** Initialize a clock tray component. */
 void Create(TrayComponentType *cp)
 {
+   TimeType now;
    cp->pixmap = JXCreatePixmap(display, rootWindow, cp->width, cp->height,
                                rootDepth);
+   GetCurrentTime(&now);
+   ScheduleClock((ClockType*)cp->object, &now);
 }
 
 /** Resize a clock tray component. */
@@ -175,7 +188,6 @@ void Resize(TrayComponentType *cp)
 {
 
    ClockType *clk;
-   TimeType now;
 
    Assert(cp);
 
@@ -190,10 +202,12 @@ void Resize(TrayComponentType *cp)
    cp->pixmap = JXCreatePixmap(display, rootWindow, cp->width, cp->height,
                                rootDepth);
 
-   memset(&clk->lastTime, 0, sizeof(clk->lastTime));
+   if(clk->text) {
+      Release(clk->text);
+      clk->text = NULL;
+   }
 
-   GetCurrentTime(&now);
-   DrawClock(clk, &now);
+   DrawClock(clk);
 
 }
 
@@ -227,6 +241,20 @@ void ProcessClockMotionEvent(TrayComponentType *cp,
    clk->mousex = cp->screenx + x;
    clk->mousey = cp->screeny + y;
    GetCurrentTime(&clk->mouseTime);
+   clk->popup = 1;
+   ScheduleClock(clk, &clk->mouseTime);
+}
+
+/** Process the mouse leaving the tray. */
+void ProcessClockLeaveEvent(TrayComponentType *cp)
+{
+   ClockType *clk = (ClockType*)cp->object;
+   if(clk->popup) {
+      TimeType now;
+      GetCurrentTime(&now);
+      clk->popup = 0;
+      ScheduleClock(clk, &now);
+   }
 }
 
 /** Update a clock tray component. */
@@ -236,31 +264,77 @@ void SignalClock(const TimeType *now, int x, int y, Window w, void *data)
    ClockType *cp = (ClockType*)data;
    const char *longTime;
 
-   DrawClock(cp, now);
-   if(cp->cp->tray->window == w &&
-      abs(cp->mousex - x) < settings.doubleClickDelta &&
-      abs(cp->mousey - y) < settings.doubleClickDelta) {
-      if(GetTimeDifference(now, &cp->mouseTime) >= settings.popupDelay) {
-         longTime = GetTimeString("%c", cp->zone);
-         ShowPopup(x, y, longTime, POPUP_CLOCK);
+   DrawClock(cp);
+   if(cp->popup) {
+      if(cp->cp->tray->window == w &&
+         abs(cp->mousex - x) < settings.doubleClickDelta &&
+         abs(cp->mousey - y) < settings.doubleClickDelta) {
+         if(GetTimeDifference(now, &cp->mouseTime) >= settings.popupDelay) {
+            TimeType wall;
+            GetWallTime(&wall);
+            longTime = GetTimeString("%c", cp->zone, &wall);
+            ShowPopup(x, y, longTime, POPUP_CLOCK);
+         }
+      } else {
+         cp->popup = 0;
+      }
+   }
+   ScheduleClock(cp, now);
+
+}
+
+/** Schedule the next update of a clock.
+ * Clocks wake up when the displayed time changes (at the next second or
+ * minute boundary) and when a popup is due.  The boundary is found from
+ * the time of day and converted to a delay from the monotonic time used
+ * for timers.  If the system time is set, the clock is corrected at the
+ * next update.
+ */
+void ScheduleClock(ClockType *clk, const TimeType *now)
+{
+   TimeType next;
+   TimeType wall;
+   int granularity;
+   int delay;
+
+   /* The popup shows seconds. */
+   granularity = clk->popup ? 1 : clk->granularity;
+   GetWallTime(&wall);
+   delay = (granularity - (int)(wall.seconds % granularity)) * 1000
+         - wall.ms;
+
+   if(clk->popup) {
+      const unsigned long elapsed = GetTimeDifference(now, &clk->mouseTime);
+      if(elapsed < settings.popupDelay) {
+         delay = Min(delay, (int)(settings.popupDelay - elapsed));
       }
    }
 
+   next = *now;
+   AddTime(&next, delay);
+   ScheduleCallback(SignalClock, clk, &next);
 }
 
 /** Draw a clock tray component. */
-void DrawClock(ClockType *clk, const TimeType *now)
+void DrawClock(ClockType *clk)
 {
 
    TrayComponentType *cp;
    const char *timeString;
+   TimeType now;
    int width;
    int rwidth;
 
-   /* Only draw if the time changed. */
-   if(now->seconds == clk->lastTime.seconds) {
+   /* Only draw if the displayed time changed. */
+   GetWallTime(&now);
+   timeString = GetTimeString(clk->format, clk->zone, &now);
+   if(clk->text && !strcmp(clk->text, timeString)) {
       return;
    }
+   if(clk->text) {
+      Release(clk->text);
+   }
+   clk->text = CopyString(timeString);
 
    /* Clear the area. */
    cp = clk->cp;
@@ -275,7 +349,6 @@ void DrawClock(ClockType *clk, const TimeType *now)
    }
 
    /* Determine if the clock is the right size. */
-   timeString = GetTimeString(clk->format, clk->zone);
    width = GetStringWidth(FONT_CLOCK, timeString);
    rwidth = width + 4;
    if(rwidth == clk->cp->requestedWidth || clk->userWidth) {
@@ -173,6 +173,8 @@ static unsigned long GetRGBFromXColor(const XColor *c);
 
 static unsigned long GetDirectPixel(const XColor *c);
 static void GetMappedPixel(XColor *c);
+static unsigned short GetComponent(unsigned long pixel, unsigned shift,
+                                   unsigned bits);
 static void AllocateColor(ColorType type, XColor *c);
 
 static unsigned long ReadHex(const char *hex);
@@ -513,6 +515,46 @@ void GetColor(XColor *c)
    }
 }
 
+/** Get the red, green, and blue values for a pixel. */
+void GetColorComponents(XColor *c)
+{
+   unsigned i;
+
+   /* Check the color table first. */
+   for(i = 0; i < COLOR_COUNT; i++) {
+      if(colors[i] == c->pixel && rgbColors[i] != ULONG_MAX) {
+         const XColor temp = GetXColorFromRGB(rgbColors[i]);
+         c->red = temp.red;
+         c->green = temp.green;
+         c->blue = temp.blue;
+         return;
+      }
+   }
+
+   switch(rootVisual->class) {
+   case DirectColor:
+   case TrueColor:
+      c->red = GetComponent(c->pixel, redShift, redBits);
+      c->green = GetComponent(c->pixel, greenShift, greenBits);
+      c->blue = GetComponent(c->pixel, blueShift, blueBits);
+      return;
+   default:
+      JXQueryColor(display, rootColormap, c);
+      return;
+   }
+}
+
+/** Extract a 16-bit color component from a direct pixel value. */
+unsigned short GetComponent(unsigned long pixel, unsigned shift,
+                            unsigned bits)
+{
+   const unsigned long mask = (1UL << bits) - 1;
+   if(mask == 0) {
+      return 0;
+   }
+   return (unsigned short)(((pixel >> shift) & mask) * 65535 / mask);
+}
+
 /** Get an XRenderColor for the specified component. */
 #ifdef USE_XRENDER
 XRenderColor *GetXRenderColor(ColorType type)
@@ -124,6 +124,13 @@ char ParseColor(const char *value, XColor *c);
  */
 void GetColor(XColor *c);
 
+/** Get the red, green, and blue values for a pixel.
+ * Pixels from the color table and pixels of TrueColor visuals are
+ * looked up locally; other pixels are queried from the server.
+ * @param c The structure containing the pixel value and the rgb values.
+ */
+void GetColorComponents(XColor *c);
+
 #ifdef USE_XRENDER
 /** Get an XRender color.
  * @param type The color whose XRender color to get.
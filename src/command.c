@@ -13,6 +13,7 @@
 #include "main.h"
 #include "error.h"
 #include "timing.h"
+#include "reactor.h"
 
 #include <fcntl.h>
 #include <errno.h>
@@ -130,6 +131,7 @@ void RunCommand(const char *command)
 
    displayString = DisplayString(display);
    if(!fork()) {
+      ResetChildSignals();
       close(ConnectionNumber(display));
       if(displayString && displayString[0]) {
          const size_t var_len = strlen(displayString) + 9;
@@ -165,6 +167,7 @@ char *ReadFromProcess(const char *command, unsigned timeout_ms)
    pid = fork();
    if(pid == 0) {
       /* The child process. */
+      ResetChildSignals();
       if(display) {
         close(ConnectionNumber(display));
       }
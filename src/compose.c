@@ -0,0 +1,364 @@
+/**
+ * @file compose.c
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Functions to compose background images.
+ *
+ * Backgrounds are built on the client: the image is resampled for each
+ * Xinerama screen into one root-sized XImage, which is then uploaded at
+ * once.  Resampling uses a separable triangle filter, which is bilinear
+ * when enlarging and averages all covered pixels when reducing.
+ *
+ */
+
+#include "ggwm.h"
+#include "compose.h"
+#include "image.h"
+#include "screen.h"
+#include "color.h"
+#include "main.h"
+#include "misc.h"
+#include "upload.h"
+
+#include <math.h>
+
+/** Maximum number of source pixels used for a destination pixel. */
+#define MAX_FILTER_TAPS 32
+
+/** Filter taps for one axis.
+ * Destination pixel i is the sum of taps source pixels, whose indexes
+ * and weights start at i * taps.  The weights for a pixel sum to 65536.
+ */
+typedef struct FilterAxis {
+   int *index;
+   unsigned *weight;
+   int taps;
+} FilterAxis;
+
+/** Horizontally filtered source rows needed for a destination row. */
+typedef struct RowCache {
+   unsigned short *rows;   /**< Filtered rows, RGB in 8.8 format. */
+   int *source;            /**< Source row held in each slot (-1 if none). */
+   unsigned char *line;    /**< Premultiplied source row. */
+} RowCache;
+
+static void ComposeScreen(XImage *dest, const ImageNode *image,
+                          const ScreenType *sp, ComposeMode mode);
+static void ComposeRegion(XImage *dest, const ImageNode *image,
+                          int x, int y, int width, int height,
+                          double xoffset, double yoffset,
+                          double xscale, double yscale);
+static void ComposeTile(XImage *dest, const ImageNode *image,
+                        const ScreenType *sp);
+static void CreateFilterAxis(FilterAxis *axis, int size, double offset,
+                             double scale, int count);
+static void DestroyFilterAxis(FilterAxis *axis);
+static void GetSourceLine(const ImageNode *image, int y, unsigned char *line);
+static unsigned long GetComposePixel(unsigned red, unsigned green,
+                                     unsigned blue);
+
+/** Compose an image on each screen of a root-sized drawable. */
+void ComposeBackground(Drawable d, const ImageNode *image, ComposeMode mode)
+{
+   XImage *dest;
+   int count;
+   int i;
+
+   dest = CreateUploadImage(rootDepth, rootWidth, rootHeight);
+   memset(dest->data, 0, dest->bytes_per_line * dest->height);
+
+   count = GetScreenCount();
+   for(i = 0; i < count; i++) {
+      ComposeScreen(dest, image, GetScreen(i), mode);
+   }
+
+   UploadImage(d, rootGC, dest);
+}
+
+/** Compose an image on one screen. */
+void ComposeScreen(XImage *dest, const ImageNode *image,
+                   const ScreenType *sp, ComposeMode mode)
+{
+   double xscale, yscale;
+   double xoffset, yoffset;
+   int x, y;
+   int width, height;
+
+   x = sp->x;
+   y = sp->y;
+   width = sp->width;
+   height = sp->height;
+   xoffset = 0.0;
+   yoffset = 0.0;
+
+   switch(mode) {
+   case COMPOSE_TILE:
+      ComposeTile(dest, image, sp);
+      return;
+   case COMPOSE_SCALE:
+      xscale = Min((double)width / image->width,
+                   (double)height / image->height);
+      yscale = xscale;
+      width = Max(1, (int)(image->width * xscale + 0.5));
+      height = Max(1, (int)(image->height * yscale + 0.5));
+      x += (sp->width - width) / 2;
+      y += (sp->height - height) / 2;
+      break;
+   case COMPOSE_FILL:
+      xscale = Max((double)width / image->width,
+                   (double)height / image->height);
+      yscale = xscale;
+      xoffset = (image->width - width / xscale) / 2.0;
+      yoffset = (image->height - height / yscale) / 2.0;
+      break;
+   case COMPOSE_CENTER:
+      xscale = 1.0;
+      yscale = 1.0;
+      if(image->width < width) {
+         x += (width - image->width) / 2;
+         width = image->width;
+      } else {
+         xoffset = (image->width - width) / 2;
+      }
+      if(image->height < height) {
+         y += (height - image->height) / 2;
+         height = image->height;
+      } else {
+         yoffset = (image->height - height) / 2;
+      }
+      break;
+   default:
+      xscale = (double)width / image->width;
+      yscale = (double)height / image->height;
+      break;
+   }
+
+   /* Clip to the root window. */
+   if(x < 0) {
+      xoffset -= x / xscale;
+      width += x;
+      x = 0;
+   }
+   if(y < 0) {
+      yoffset -= y / yscale;
+      height += y;
+      y = 0;
+   }
+   width = Min(width, dest->width - x);
+   height = Min(height, dest->height - y);
+   if(width > 0 && height > 0) {
+      ComposeRegion(dest, image, x, y, width, height,
+                    xoffset, yoffset, xscale, yscale);
+   }
+}
+
+/** Resample an image into part of the destination. */
+void ComposeRegion(XImage *dest, const ImageNode *image,
+                   int x, int y, int width, int height,
+                   double xoffset, double yoffset,
+                   double xscale, double yscale)
+{
+   FilterAxis xaxis, yaxis;
+   RowCache cache;
+   int row, col;
+   int i;
+
+   CreateFilterAxis(&xaxis, image->width, xoffset, xscale, width);
+   CreateFilterAxis(&yaxis, image->height, yoffset, yscale, height);
+
+   /* Each destination row uses at most yaxis.taps consecutive source
+    * rows, so filtered rows are kept in a ring of that many slots. */
+   cache.rows = Allocate(sizeof(unsigned short) * 3 * width * yaxis.taps);
+   cache.source = Allocate(sizeof(int) * yaxis.taps);
+   cache.line = Allocate(4 * image->width);
+   for(i = 0; i < yaxis.taps; i++) {
+      cache.source[i] = -1;
+   }
+
+   for(row = 0; row < height; row++) {
+
+      const int *sources = &yaxis.index[row * yaxis.taps];
+      const unsigned *weights = &yaxis.weight[row * yaxis.taps];
+      unsigned short *slots[MAX_FILTER_TAPS];
+      int t;
+
+      /* Filter the source rows horizontally. */
+      for(t = 0; t < yaxis.taps; t++) {
+         const int source = sources[t];
+         const int slot = source % yaxis.taps;
+         unsigned short *out = &cache.rows[3 * width * slot];
+         if(cache.source[slot] != source) {
+            GetSourceLine(image, source, cache.line);
+            for(col = 0; col < width; col++) {
+               const int *xi = &xaxis.index[col * xaxis.taps];
+               const unsigned *xw = &xaxis.weight[col * xaxis.taps];
+               unsigned r = 0, g = 0, b = 0;
+               for(i = 0; i < xaxis.taps; i++) {
+                  const unsigned char *p = &cache.line[4 * xi[i]];
+                  r += xw[i] * p[1];
+                  g += xw[i] * p[2];
+                  b += xw[i] * p[3];
+               }
+               out[3 * col + 0] = (r + 128) >> 8;
+               out[3 * col + 1] = (g + 128) >> 8;
+               out[3 * col + 2] = (b + 128) >> 8;
+            }
+            cache.source[slot] = source;
+         }
+         slots[t] = out;
+      }
+
+      /* Filter vertically and store the pixels. */
+      for(col = 0; col < width; col++) {
+         unsigned r = 1 << 23, g = 1 << 23, b = 1 << 23;
+         for(t = 0; t < yaxis.taps; t++) {
+            const unsigned short *p = &slots[t][3 * col];
+            r += weights[t] * p[0];
+            g += weights[t] * p[1];
+            b += weights[t] * p[2];
+         }
+         XPutPixel(dest, x + col, y + row,
+                   GetComposePixel(r >> 24, g >> 24, b >> 24));
+      }
+
+   }
+
+   Release(cache.rows);
+   Release(cache.source);
+   Release(cache.line);
+   DestroyFilterAxis(&xaxis);
+   DestroyFilterAxis(&yaxis);
+}
+
+/** Tile an image on a screen starting at the screen origin. */
+void ComposeTile(XImage *dest, const ImageNode *image, const ScreenType *sp)
+{
+   unsigned long *pixels;
+   unsigned char *line;
+   int x, y;
+   int width, height;
+
+   /* Convert the image to pixel values once. */
+   pixels = Allocate(sizeof(unsigned long) * image->width * image->height);
+   line = Allocate(4 * image->width);
+   for(y = 0; y < image->height; y++) {
+      unsigned long *out = &pixels[y * image->width];
+      GetSourceLine(image, y, line);
+      for(x = 0; x < image->width; x++) {
+         out[x] = GetComposePixel(line[4 * x + 1], line[4 * x + 2],
+                                  line[4 * x + 3]);
+      }
+   }
+   Release(line);
+
+   width = Min(sp->width, dest->width - sp->x);
+   height = Min(sp->height, dest->height - sp->y);
+   for(y = 0; y < height; y++) {
+      const unsigned long *in = &pixels[(y % image->height) * image->width];
+      for(x = 0; x < width; x++) {
+         XPutPixel(dest, sp->x + x, sp->y + y, in[x % image->width]);
+      }
+   }
+
+   Release(pixels);
+}
+
+/** Compute filter taps for one axis.
+ * @param axis The axis to fill in.
+ * @param size The number of source pixels.
+ * @param offset The source position of the first destination pixel.
+ * @param scale The number of destination pixels per source pixel.
+ * @param count The number of destination pixels.
+ */
+void CreateFilterAxis(FilterAxis *axis, int size, double offset,
+                      double scale, int count)
+{
+   const double support = scale < 1.0
+                        ? Min(1.0 / scale, (MAX_FILTER_TAPS - 2) / 2.0)
+                        : 1.0;
+   double *weights;
+   int i, t;
+
+   axis->taps = (int)ceil(2.0 * support) + 1;
+   axis->index = Allocate(sizeof(int) * axis->taps * count);
+   axis->weight = Allocate(sizeof(unsigned) * axis->taps * count);
+   weights = AllocateStack(sizeof(double) * axis->taps);
+
+   for(i = 0; i < count; i++) {
+
+      const double center = offset + (i + 0.5) / scale - 0.5;
+      const int first = (int)floor(center - support) + 1;
+      int *index = &axis->index[i * axis->taps];
+      unsigned *weight = &axis->weight[i * axis->taps];
+      double sum = 0.0;
+      unsigned total = 0;
+      int best = 0;
+
+      for(t = 0; t < axis->taps; t++) {
+         const double d = fabs(first + t - center) / support;
+         weights[t] = d < 1.0 ? 1.0 - d : 0.0;
+         sum += weights[t];
+         if(weights[t] > weights[best]) {
+            best = t;
+         }
+         index[t] = Max(0, Min(size - 1, first + t));
+      }
+
+      /* Normalize so the weights sum to exactly 65536. */
+      for(t = 0; t < axis->taps; t++) {
+         weight[t] = sum > 0.0 ? (unsigned)(weights[t] * 65536.0 / sum) : 0;
+         total += weight[t];
+      }
+      weight[best] += 65536 - total;
+
+   }
+
+   ReleaseStack(weights);
+}
+
+/** Release filter taps. */
+void DestroyFilterAxis(FilterAxis *axis)
+{
+   Release(axis->index);
+   Release(axis->weight);
+}
+
+/** Get a row of the image as ARGB bytes premultiplied by alpha.
+ * This composites the image over black.
+ */
+void GetSourceLine(const ImageNode *image, int y, unsigned char *line)
+{
+   int x;
+   if(image->bitmap) {
+      const int perLine = (image->width >> 3) + ((image->width & 7) ? 1 : 0);
+      const unsigned char *src = &image->data[y * perLine];
+      for(x = 0; x < image->width; x++) {
+         const unsigned char value = (src[x >> 3] & (1 << (x & 7))) ? 255 : 0;
+         line[0] = line[1] = line[2] = line[3] = value;
+         line += 4;
+      }
+   } else {
+      const unsigned char *src = &image->data[4 * y * image->width];
+      for(x = 0; x < image->width; x++) {
+         const unsigned alpha = src[0];
+         line[0] = alpha;
+         line[1] = (src[1] * alpha + 127) / 255;
+         line[2] = (src[2] * alpha + 127) / 255;
+         line[3] = (src[3] * alpha + 127) / 255;
+         line += 4;
+         src += 4;
+      }
+   }
+}
+
+/** Get the pixel value for a color. */
+unsigned long GetComposePixel(unsigned red, unsigned green, unsigned blue)
+{
+   XColor color;
+   color.red = red | (red << 8);
+   color.green = green | (green << 8);
+   color.blue = blue | (blue << 8);
+   GetColor(&color);
+   return color.pixel;
+}
@@ -0,0 +1,34 @@
+/**
+ * @file compose.h
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Functions to compose background images.
+ *
+ */
+
+#ifndef COMPOSE_H
+#define COMPOSE_H
+
+struct ImageNode;
+
+/** How an image is placed on each screen. */
+typedef unsigned char ComposeMode;
+#define COMPOSE_STRETCH    0  /**< Scale to the screen size. */
+#define COMPOSE_SCALE      1  /**< Scale to fit, preserving aspect. */
+#define COMPOSE_FILL       2  /**< Scale to cover, preserving aspect. */
+#define COMPOSE_CENTER     3  /**< Center without scaling. */
+#define COMPOSE_TILE       4  /**< Tile from the screen origin. */
+
+/** Compose an image on each screen of a root-sized drawable.
+ * The image is resampled once per screen with a separable filter and
+ * the result is sent to the server with a single upload.
+ * Areas not covered by the image are black.
+ * @param d The drawable (the size of the root window).
+ * @param image The image.
+ * @param mode How the image is placed on each screen.
+ */
+void ComposeBackground(Drawable d, const struct ImageNode *image,
+                       ComposeMode mode);
+
+#endif /* COMPOSE_H */
@@ -7,6 +7,7 @@
  *
  */
 
+#include "../config.h"
 #include "debug.h"
 #include <stdarg.h>
 #include <stdio.h>
@@ -42,6 +43,17 @@ typedef struct MemoryType {
 
 static MemoryType *allocations = NULL;
 
+/* Images may be allocated from decoder threads. */
+#ifdef USE_THREADS
+#include <pthread.h>
+static pthread_mutex_t allocationLock = PTHREAD_MUTEX_INITIALIZER;
+#  define LockAllocations()   pthread_mutex_lock(&allocationLock)
+#  define UnlockAllocations() pthread_mutex_unlock(&allocationLock)
+#else
+#  define LockAllocations()   (void)(0)
+#  define UnlockAllocations() (void)(0)
+#endif
+
 static const char *checkpointFile[CHECKPOINT_LIST_SIZE];
 static unsigned int checkpointLine[CHECKPOINT_LIST_SIZE];
 static unsigned int checkpointOffset;
@@ -127,8 +139,10 @@ void *DEBUG_Allocate(size_t size, const char *file, unsigned int line)
    mp->pointer[7] = 42;
    mp->pointer[size + 8] = 42;
 
+   LockAllocations();
    mp->next = allocations;
    allocations = mp;
+   UnlockAllocations();
    return mp->pointer + 8;
 }
 
@@ -144,6 +158,7 @@ void *DEBUG_Reallocate(void *ptr, size_t size,
       return DEBUG_Allocate(size, file, line);
    } else {
       char *cptr = (char*)ptr - 8;
+      LockAllocations();
       for(mp = allocations; mp; mp = mp->next) {
          if(mp->pointer == cptr) {
             if(cptr[mp->size + 8] != 42) {
@@ -165,6 +180,7 @@ void *DEBUG_Reallocate(void *ptr, size_t size,
             }
             mp->pointer[7] = 42;
             mp->pointer[size + 8] = 42;
+            UnlockAllocations();
             return mp->pointer + 8;
          }
       }
@@ -187,6 +203,7 @@ void *DEBUG_Reallocate(void *ptr, size_t size,
       mp->pointer[size + 8] = 42;
       mp->next = allocations;
       allocations = mp;
+      UnlockAllocations();
       return mp->pointer + 8;
    }
 }
@@ -202,6 +219,7 @@ void DEBUG_Release(void **ptr, const char *file, unsigned int line)
             file, line);
    } else {
       char *cptr = (char*)*ptr - 8;
+      LockAllocations();
       last = NULL;
       for(mp = allocations; mp; mp = mp->next) {
          if(mp->pointer == cptr) {
@@ -224,10 +242,12 @@ void DEBUG_Release(void **ptr, const char *file, unsigned int line)
             free(mp);
             free(cptr);
             *ptr = NULL;
+            UnlockAllocations();
             return;
          }
          last = mp;
       }
+      UnlockAllocations();
       Debug("MEMORY: %s[%u]: Attempt to delete unallocated pointer",
             file, line);
       free(*ptr);
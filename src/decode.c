@@ -0,0 +1,364 @@
+/**
+ * @file decode.c
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Asynchronous image decoding.
+ *
+ * Images are decoded by a small pool of worker threads.  Decoded images
+ * are handed back to the event loop, which is woken through a pipe, so
+ * that all X requests are still made from the main thread.
+ *
+ */
+
+#include "ggwm.h"
+#include "decode.h"
+#include "image.h"
+#include "misc.h"
+#include "error.h"
+#include "reactor.h"
+
+#ifdef USE_THREADS
+
+#include <pthread.h>
+#include <fcntl.h>
+#include <errno.h>
+
+/** Maximum number of worker threads. */
+#define MAX_DECODE_THREADS 4
+
+/** A request to decode an image. */
+typedef struct DecodeJob {
+   char *fileName;
+   int width;
+   int height;
+   char preserveAspect;
+   char cancelled;
+   DecodeCallback callback;
+   void *data;
+   ImageNode *image;
+   struct DecodeJob *next;
+} DecodeJob;
+
+static pthread_t threads[MAX_DECODE_THREADS];
+static unsigned threadCount = 0;
+
+/* The lock protects all of the job lists. */
+static pthread_mutex_t jobLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobReady = PTHREAD_COND_INITIALIZER;
+static DecodeJob *pendingHead = NULL;
+static DecodeJob *pendingTail = NULL;
+static DecodeJob *activeJobs = NULL;
+static DecodeJob *doneJobs = NULL;
+static char stopWorkers = 0;
+
+static int wakeFds[2] = { -1, -1 };
+
+static void *DecodeThread(void *arg);
+static void ReleaseJob(DecodeJob *job);
+static void RemoveActiveJob(DecodeJob *job);
+static void HandleDecoderWake(int fd, void *data);
+
+/** Startup the decoder. */
+void StartupDecoder(void)
+{
+   sigset_t blocked;
+   sigset_t original;
+   long cpus;
+   unsigned i;
+
+   if(pipe(wakeFds) < 0) {
+      Warning(_("could not create pipe: %s"), strerror(errno));
+      wakeFds[0] = -1;
+      wakeFds[1] = -1;
+      return;
+   }
+   fcntl(wakeFds[0], F_SETFL, O_NONBLOCK);
+   fcntl(wakeFds[1], F_SETFL, O_NONBLOCK);
+   fcntl(wakeFds[0], F_SETFD, FD_CLOEXEC);
+   fcntl(wakeFds[1], F_SETFD, FD_CLOEXEC);
+
+   cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   cpus = Max(1, Min(cpus, MAX_DECODE_THREADS));
+
+   /* Signals are handled by the main thread only. */
+   sigfillset(&blocked);
+   pthread_sigmask(SIG_BLOCK, &blocked, &original);
+
+   stopWorkers = 0;
+   threadCount = 0;
+   for(i = 0; i < cpus; i++) {
+      if(pthread_create(&threads[threadCount], NULL, DecodeThread, NULL)) {
+         break;
+      }
+      threadCount += 1;
+   }
+
+   pthread_sigmask(SIG_SETMASK, &original, NULL);
+
+   if(JUNLIKELY(threadCount == 0)) {
+      Warning(_("could not start image decoder threads"));
+      close(wakeFds[0]);
+      close(wakeFds[1]);
+      wakeFds[0] = -1;
+      wakeFds[1] = -1;
+   } else {
+      RegisterDescriptor(wakeFds[0], HandleDecoderWake, NULL);
+   }
+}
+
+/** Shutdown the decoder. */
+void ShutdownDecoder(void)
+{
+   unsigned i;
+
+   if(threadCount == 0) {
+      return;
+   }
+
+   pthread_mutex_lock(&jobLock);
+   stopWorkers = 1;
+   while(pendingHead) {
+      DecodeJob *job = pendingHead;
+      pendingHead = job->next;
+      ReleaseJob(job);
+   }
+   pendingTail = NULL;
+   pthread_cond_broadcast(&jobReady);
+   pthread_mutex_unlock(&jobLock);
+
+   for(i = 0; i < threadCount; i++) {
+      pthread_join(threads[i], NULL);
+   }
+   threadCount = 0;
+
+   while(doneJobs) {
+      DecodeJob *job = doneJobs;
+      doneJobs = job->next;
+      ReleaseJob(job);
+   }
+
+   UnregisterDescriptor(wakeFds[0]);
+   close(wakeFds[0]);
+   close(wakeFds[1]);
+   wakeFds[0] = -1;
+   wakeFds[1] = -1;
+}
+
+/** Request that an image be decoded in the background. */
+char RequestImage(const char *fileName, int rwidth, int rheight,
+                  char preserveAspect, DecodeCallback callback, void *data)
+{
+   DecodeJob *job;
+
+   if(threadCount == 0 || !CanLoadImageAsync(fileName)) {
+      return 0;
+   }
+
+   job = Allocate(sizeof(DecodeJob));
+   job->fileName = CopyString(fileName);
+   job->width = rwidth;
+   job->height = rheight;
+   job->preserveAspect = preserveAspect;
+   job->cancelled = 0;
+   job->callback = callback;
+   job->data = data;
+   job->image = NULL;
+   job->next = NULL;
+
+   pthread_mutex_lock(&jobLock);
+   if(pendingTail) {
+      pendingTail->next = job;
+   } else {
+      pendingHead = job;
+   }
+   pendingTail = job;
+   pthread_cond_signal(&jobReady);
+   pthread_mutex_unlock(&jobLock);
+
+   return 1;
+}
+
+/** Cancel outstanding requests. */
+void CancelImageRequests(DecodeCallback callback, void *data)
+{
+   DecodeJob **prev;
+   DecodeJob *job;
+
+   if(threadCount == 0) {
+      return;
+   }
+
+   pthread_mutex_lock(&jobLock);
+
+   /* Jobs that have not started are simply removed. */
+   pendingTail = NULL;
+   prev = &pendingHead;
+   while(*prev) {
+      job = *prev;
+      if(job->callback == callback && job->data == data) {
+         *prev = job->next;
+         ReleaseJob(job);
+      } else {
+         pendingTail = job;
+         prev = &job->next;
+      }
+   }
+
+   /* Jobs in progress are discarded when they finish. */
+   for(job = activeJobs; job; job = job->next) {
+      if(job->callback == callback && job->data == data) {
+         job->cancelled = 1;
+      }
+   }
+   for(job = doneJobs; job; job = job->next) {
+      if(job->callback == callback && job->data == data) {
+         job->cancelled = 1;
+      }
+   }
+
+   pthread_mutex_unlock(&jobLock);
+}
+
+/** Deliver decoded images to their callbacks. */
+void ProcessDecodedImages(void)
+{
+   char buffer[32];
+   DecodeJob *jobs;
+   DecodeJob *prev;
+
+   if(threadCount == 0) {
+      return;
+   }
+
+   /* Drain the wake up pipe. */
+   while(read(wakeFds[0], buffer, sizeof(buffer)) > 0);
+
+   pthread_mutex_lock(&jobLock);
+   jobs = doneJobs;
+   doneJobs = NULL;
+   pthread_mutex_unlock(&jobLock);
+
+   /* Reverse the list so callbacks run in completion order. */
+   prev = NULL;
+   while(jobs) {
+      DecodeJob *next = jobs->next;
+      jobs->next = prev;
+      prev = jobs;
+      jobs = next;
+   }
+   jobs = prev;
+
+   while(jobs) {
+      DecodeJob *job = jobs;
+      jobs = job->next;
+      if(!job->cancelled) {
+         (job->callback)(job->data, job->width, job->height, job->image);
+         job->image = NULL;
+      }
+      ReleaseJob(job);
+   }
+}
+
+/** Worker thread. */
+void *DecodeThread(void *arg)
+{
+   for(;;) {
+
+      DecodeJob *job;
+      ImageNode *image;
+
+      pthread_mutex_lock(&jobLock);
+      while(!pendingHead && !stopWorkers) {
+         pthread_cond_wait(&jobReady, &jobLock);
+      }
+      if(stopWorkers) {
+         pthread_mutex_unlock(&jobLock);
+         break;
+      }
+      job = pendingHead;
+      pendingHead = job->next;
+      if(!pendingHead) {
+         pendingTail = NULL;
+      }
+      job->next = activeJobs;
+      activeJobs = job;
+      pthread_mutex_unlock(&jobLock);
+
+      image = LoadImageAsync(job->fileName, job->width, job->height,
+                             job->preserveAspect);
+
+      pthread_mutex_lock(&jobLock);
+      RemoveActiveJob(job);
+      job->image = image;
+      if(stopWorkers) {
+         ReleaseJob(job);
+      } else {
+         job->next = doneJobs;
+         doneJobs = job;
+      }
+      pthread_mutex_unlock(&jobLock);
+
+      /* Wake the event loop. */
+      if(write(wakeFds[1], "", 1) < 0) {
+         /* The pipe is full, so the event loop will wake anyway. */
+      }
+
+   }
+   return NULL;
+}
+
+/** Remove a job from the active list (jobLock must be held). */
+void RemoveActiveJob(DecodeJob *job)
+{
+   DecodeJob **prev = &activeJobs;
+   while(*prev != job) {
+      prev = &(*prev)->next;
+   }
+   *prev = job->next;
+}
+
+/** Release a job and any image it holds. */
+void ReleaseJob(DecodeJob *job)
+{
+   DestroyImage(job->image);
+   Release(job->fileName);
+   Release(job);
+}
+
+/** Called by the reactor when the worker threads wake the event loop. */
+void HandleDecoderWake(int fd, void *data)
+{
+   ProcessDecodedImages();
+}
+
+#else /* USE_THREADS */
+
+/** Startup the decoder. */
+void StartupDecoder(void)
+{
+}
+
+/** Shutdown the decoder. */
+void ShutdownDecoder(void)
+{
+}
+
+/** Images are always loaded by the caller without threads. */
+char RequestImage(const char *fileName, int rwidth, int rheight,
+                  char preserveAspect, DecodeCallback callback, void *data)
+{
+   return 0;
+}
+
+/** Cancel outstanding requests. */
+void CancelImageRequests(DecodeCallback callback, void *data)
+{
+}
+
+/** Deliver decoded images to their callbacks. */
+void ProcessDecodedImages(void)
+{
+}
+
+#endif /* USE_THREADS */
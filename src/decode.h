@@ -0,0 +1,57 @@
+/**
+ * @file decode.h
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Asynchronous image decoding.
+ *
+ */
+
+#ifndef DECODE_H
+#define DECODE_H
+
+struct ImageNode;
+
+/** Callback for decoded images.
+ * This is always invoked from the event loop (never from a worker).
+ * @param data The data passed to RequestImage.
+ * @param rwidth The requested width.
+ * @param rheight The requested height.
+ * @param image The decoded image (NULL if the image could not be loaded).
+ * The callback takes ownership of the image.
+ */
+typedef void (*DecodeCallback)(void *data, int rwidth, int rheight,
+                               struct ImageNode *image);
+
+/*@{*/
+#define InitializeDecoder()   (void)(0)
+void StartupDecoder(void);
+void ShutdownDecoder(void);
+#define DestroyDecoder()      (void)(0)
+/*@}*/
+
+/** Request that an image be decoded in the background.
+ * Only images that can be decoded without the X connection are
+ * handled asynchronously.
+ * @param fileName The file containing the image.
+ * @param rwidth The preferred width.
+ * @param rheight The preferred height.
+ * @param preserveAspect Set to preserve image aspect when scaling.
+ * @param callback The function to call when the image is available.
+ * @param data Data to pass to the callback.
+ * @return 1 if the request was queued, 0 if the caller must load
+ *         the image itself.
+ */
+char RequestImage(const char *fileName, int rwidth, int rheight,
+                  char preserveAspect, DecodeCallback callback, void *data);
+
+/** Cancel outstanding requests.
+ * @param callback The callback passed to RequestImage.
+ * @param data The data passed to RequestImage.
+ */
+void CancelImageRequests(DecodeCallback callback, void *data);
+
+/** Deliver decoded images to their callbacks. */
+void ProcessDecodedImages(void);
+
+#endif /* DECODE_H */
@@ -18,7 +18,6 @@
 #include "misc.h"
 #include "background.h"
 #include "settings.h"
-#include "grab.h"
 #include "event.h"
 #include "tray.h"
 
@@ -273,7 +272,7 @@ void ShowDesktop(void)
    ClientNode *np;
    int layer;
 
-   GrabServer();
+   BeginUnmapBatch();
    for(layer = 0; layer < LAYER_COUNT; layer++) {
       for(np = nodes[layer]; np; np = np->next) {
          if(np->state.status & STAT_NOLIST) {
@@ -298,13 +297,12 @@ void ShowDesktop(void)
          }
       }
    }
+   EndUnmapBatch();
    RequireRestack();
    RequireTaskUpdate();
-   JXSync(display, True);
 
    if(showingDesktop[currentDesktop]) {
       char first = 1;
-      JXSync(display, False);
       for(layer = 0; layer < LAYER_COUNT; layer++) {
          for(np = nodes[layer]; np; np = np->next) {
             if(np->state.status & STAT_NOLIST) {
@@ -326,7 +324,6 @@ void ShowDesktop(void)
    }
    SetCardinalAtom(rootWindow, ATOM_NET_SHOWING_DESKTOP,
                    showingDesktop[currentDesktop]);
-   UngrabServer();
    DrawTray();
 
 }
@@ -0,0 +1,178 @@
+/**
+ * @file drawpool.c
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Shared graphics contexts and scratch pixmaps.
+ *
+ * Drawing helpers used to create a GC (and menus and popups a pixmap)
+ * each time they drew something.  GCs are instead kept per depth and
+ * handed out while in use, so nested helpers each get their own.
+ * Scratch pixmaps are rounded up to a power of two in each dimension
+ * and kept for reuse after they are released.
+ *
+ */
+
+#include "ggwm.h"
+#include "drawpool.h"
+#include "main.h"
+#include "misc.h"
+
+/** Smallest scratch pixmap dimension. */
+#define SCRATCH_MIN_SIZE   32
+
+/** Maximum number of free scratch pixmaps to keep. */
+#define SCRATCH_MAX_FREE   4
+
+/** A pooled graphics context. */
+typedef struct GCNode {
+   GC gc;
+   unsigned depth;
+   char busy;
+   struct GCNode *next;
+} GCNode;
+
+/** A pooled scratch pixmap. */
+typedef struct PixmapNode {
+   Pixmap pixmap;
+   unsigned depth;
+   int width, height;
+   char busy;
+   struct PixmapNode *next;
+} PixmapNode;
+
+static GCNode *gcs = NULL;
+static PixmapNode *pixmaps = NULL;
+
+static int GetScratchSize(int size);
+
+/** Release pooled resources. */
+void ShutdownDrawPool(void)
+{
+   while(gcs) {
+      GCNode *next = gcs->next;
+      Assert(!gcs->busy);
+      JXFreeGC(display, gcs->gc);
+      Release(gcs);
+      gcs = next;
+   }
+   while(pixmaps) {
+      PixmapNode *next = pixmaps->next;
+      JXFreePixmap(display, pixmaps->pixmap);
+      Release(pixmaps);
+      pixmaps = next;
+   }
+}
+
+/** Get a graphics context from the pool. */
+GC GetPoolGC(Drawable d, unsigned depth)
+{
+   XGCValues gcValues;
+   GCNode *np;
+
+   for(np = gcs; np; np = np->next) {
+      if(!np->busy && np->depth == depth) {
+         np->busy = 1;
+         return np->gc;
+      }
+   }
+
+   gcValues.graphics_exposures = False;
+   np = Allocate(sizeof(GCNode));
+   np->gc = JXCreateGC(display, d, GCGraphicsExposures, &gcValues);
+   np->depth = depth;
+   np->busy = 1;
+   np->next = gcs;
+   gcs = np;
+   return np->gc;
+}
+
+/** Return a graphics context to the pool. */
+void ReleasePoolGC(GC gc)
+{
+   GCNode *np;
+   for(np = gcs; np; np = np->next) {
+      if(np->gc == gc) {
+         np->busy = 0;
+         return;
+      }
+   }
+   Assert(0);
+}
+
+/** Get a scratch pixmap from the pool. */
+Pixmap GetScratchPixmap(unsigned depth, int width, int height)
+{
+   PixmapNode *best;
+   PixmapNode *np;
+
+   /* Use the smallest free pixmap that is large enough. */
+   width = GetScratchSize(width);
+   height = GetScratchSize(height);
+   best = NULL;
+   for(np = pixmaps; np; np = np->next) {
+      if(!np->busy && np->depth == depth
+         && np->width >= width && np->height >= height) {
+         if(!best || np->width * np->height < best->width * best->height) {
+            best = np;
+         }
+      }
+   }
+   if(best) {
+      best->busy = 1;
+      return best->pixmap;
+   }
+
+   np = Allocate(sizeof(PixmapNode));
+   np->pixmap = JXCreatePixmap(display, rootWindow, width, height, depth);
+   np->depth = depth;
+   np->width = width;
+   np->height = height;
+   np->busy = 1;
+   np->next = pixmaps;
+   pixmaps = np;
+   return np->pixmap;
+}
+
+/** Return a scratch pixmap to the pool. */
+void ReleaseScratchPixmap(Pixmap pixmap)
+{
+   PixmapNode **pp;
+   PixmapNode *np;
+   unsigned count;
+
+   for(np = pixmaps; np; np = np->next) {
+      if(np->pixmap == pixmap) {
+         np->busy = 0;
+         break;
+      }
+   }
+   Assert(np);
+
+   /* Free the oldest pixmaps beyond the limit. */
+   count = 0;
+   pp = &pixmaps;
+   while(*pp) {
+      np = *pp;
+      if(!np->busy) {
+         count += 1;
+         if(count > SCRATCH_MAX_FREE) {
+            *pp = np->next;
+            JXFreePixmap(display, np->pixmap);
+            Release(np);
+            continue;
+         }
+      }
+      pp = &np->next;
+   }
+}
+
+/** Round a size up to a power of two. */
+int GetScratchSize(int size)
+{
+   int result = SCRATCH_MIN_SIZE;
+   while(result < size) {
+      result *= 2;
+   }
+   return result;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file drawpool.h
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Shared graphics contexts and scratch pixmaps.
+ *
+ */
+
+#ifndef DRAWPOOL_H
+#define DRAWPOOL_H
+
+/*@{*/
+#define InitializeDrawPool()  (void)(0)
+#define StartupDrawPool()     (void)(0)
+void ShutdownDrawPool(void);
+#define DestroyDrawPool()     (void)(0)
+/*@}*/
+
+/** Get a graphics context from the pool.
+ * The GC has graphics exposures disabled.  It must be returned with
+ * ReleasePoolGC with a solid fill style and no clip mask.
+ * @param d A drawable with the depth to use (only used to create a GC).
+ * @param depth The depth of the drawables the GC will be used with.
+ * @return The GC.
+ */
+GC GetPoolGC(Drawable d, unsigned depth);
+
+/** Return a graphics context to the pool.
+ * @param gc The GC returned by GetPoolGC.
+ */
+void ReleasePoolGC(GC gc);
+
+/** Get a scratch pixmap from the pool.
+ * The pixmap may be larger than requested since sizes are rounded up so
+ * that pixmaps can be reused.  The contents are undefined.
+ * @param depth The depth of the pixmap.
+ * @param width The minimum width.
+ * @param height The minimum height.
+ * @return The pixmap.
+ */
+Pixmap GetScratchPixmap(unsigned depth, int width, int height);
+
+/** Return a scratch pixmap to the pool.
+ * @param pixmap The pixmap returned by GetScratchPixmap.
+ */
+void ReleaseScratchPixmap(Pixmap pixmap);
+
+#endif /* DRAWPOOL_H */
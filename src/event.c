@@ -32,34 +32,75 @@
 #include "pager.h"
 #include "grab.h"
 #include "screen.h"
-
+#include "thumbnail.h"
+#include "reactor.h"
+#include "border.h"
+#include "menu.h"
+#include "misc.h"
+#include "traybutton.h"
+
+/** Minimum time between runs of callbacks with a frequency of 0. */
 #define MIN_TIME_DELTA 50
 
+/** Number of buckets used to look up callbacks. */
+#define CALLBACK_HASH_SIZE 32
+
 Time eventTime = CurrentTime;
 
+/** A registered callback.
+ * Callbacks with a deadline are kept in a min-heap ordered by deadline,
+ * so only timers that are due are visited and the time to sleep is the
+ * deadline at the top of the heap.  When the heap is empty (and no
+ * callback runs on every pass), the event loop sleeps until an event
+ * arrives.
+ */
 typedef struct CallbackNode {
-   TimeType last;
-   int freq;
-   SignalCallback callback;
+   TimeType deadline;   /**< Next time to run (if in the heap). */
+   int freq;            /**< Period, 0 for every pass, or scheduled. */
+   int index;           /**< Position in the heap (-1 if not queued). */
+   SignalCallback callback;   /**< NULL once unregistered during a pass. */
    void *data;
-   struct CallbackNode *next;
+   struct CallbackNode *next;    /**< Next callback in the hash bucket. */
+   struct CallbackNode *pass;    /**< Next callback run on every pass. */
 } CallbackNode;
 
-static CallbackNode *callbacks = NULL;
+static CallbackNode *callbackHash[CALLBACK_HASH_SIZE];
+static CallbackNode *passCallbacks = NULL;
+static CallbackNode **timerHeap = NULL;
+static int timerCount = 0;
+static int timerCapacity = 0;
+static TimeType lastPass = ZERO_TIME;
+static char passPending = 0;
+static char passRunning = 0;
+static char passRemoved = 0;
 
 static char restack_pending = 0;
 static char task_update_pending = 0;
 static char pager_update_pending = 0;
+static char icon_update_pending = 0;
+
+static unsigned long wakeupCount = 0;
+static unsigned long idleWakeupCount = 0;
 
 static void Signal(void);
+static char GetNextDeadline(TimeType *deadline);
+static CallbackNode **FindCallback(SignalCallback callback, void *data);
+static void QueueCallback(CallbackNode *cp);
+static void DequeueCallback(CallbackNode *cp);
+static void MoveCallback(int index);
+static char IsEarlier(const TimeType *a, const TimeType *b);
 
 static void ProcessBinding(MouseContextType context, ClientNode *np,
                            unsigned state, int code, int x, int y);
 
-static void HandleConfigureRequest(const XConfigureRequestEvent *event);
+static void HandleConfigureRequest(XConfigureRequestEvent *event);
+static void MergeConfigureRequests(XConfigureRequestEvent *event);
+static Bool MatchConfigureRequest(Display *d, XEvent *e, XPointer arg);
 static char HandleConfigureNotify(const XConfigureEvent *event);
 static char HandleExpose(const XExposeEvent *event);
 static char HandlePropertyNotify(const XPropertyEvent *event);
+static void DiscardPropertyEvents(const XPropertyEvent *event);
+static Bool MatchPropertyEvent(Display *d, XEvent *e, XPointer arg);
 static void HandleClientMessage(const XClientMessageEvent *event);
 static void HandleColormapChange(const XColormapEvent *event);
 static char HandleDestroyNotify(const XDestroyWindowEvent *event);
@@ -89,43 +130,33 @@ static char ClientCanReceiveSloppyFocus(const ClientNode *np);
 /** Wait for an event and process it. */
 char WaitForEvent(XEvent *event)
 {
-   struct timeval timeout;
-   CallbackNode *cp;
-   fd_set fds;
-   long sleepTime;
-   int fd;
+   TimeType deadline;
    char handled;
 
-#ifdef ConnectionNumber
-   fd = ConnectionNumber(display);
-#else
-   fd = JXConnectionNumber(display);
-#endif
-
-   /* Compute how long we should sleep. */
-   sleepTime = 10 * 1000;  /* 10 seconds. */
-   for(cp = callbacks; cp; cp = cp->next) {
-      if(cp->freq > 0 && cp->freq < sleepTime) {
-         sleepTime = cp->freq;
-      }
-   }
-
    do {
 
-      while(JXPending(display) == 0) {
-         FD_ZERO(&fds);
-         FD_SET(fd, &fds);
-         timeout.tv_sec = sleepTime / 1000;
-         timeout.tv_usec = (sleepTime % 1000) * 1000;
-         if(select(fd + 1, &fds, NULL, NULL, &timeout) <= 0) {
-            Signal();
-         }
+      /* Run pending work and timers, then sleep until the next deadline
+       * (or indefinitely if there is none) unless events are queued. */
+      for(;;) {
+         Signal();
          if(JUNLIKELY(shouldExit)) {
             return 0;
          }
-      }
+         if(JXPending(display) > 0) {
+            break;
+         }
+         if(GetNextDeadline(&deadline)) {
+            WaitForReactor(&deadline);
+         } else {
+            WaitForReactor(NULL);
+         }
 
-      Signal();
+         /* Wakeups without X events are timers or other descriptors. */
+         wakeupCount += 1;
+         if(JXPending(display) == 0) {
+            idleWakeupCount += 1;
+         }
+      }
 
       JXNextEvent(display, event);
       UpdateTime(event);
@@ -201,7 +232,8 @@ char WaitForEvent(XEvent *event)
          handled = 1;
          break;
       default:
-         if(0) {
+         if(HandleThumbnailEvent(event)) {
+            handled = 1;
          } else {
             handled = 0;
          }
@@ -230,17 +262,25 @@ char WaitForEvent(XEvent *event)
 /** Wake up components that need to run at certain times. */
 void Signal(void)
 {
-   static TimeType last = ZERO_TIME;
-
-   CallbackNode *cp;   
+   CallbackNode *cp;
    TimeType now;
    Window w;
    int x, y;
+   int count;
+   char havePosition;
 
    if(restack_pending) {
       RestackClients();
       restack_pending = 0;
    }
+   if(icon_update_pending) {
+      UpdateBorderIcons();
+      UpdateTrayButtons();
+      RedrawMenus();
+      InvalidateTaskBar();
+      task_update_pending = 1;
+      icon_update_pending = 0;
+   }
    if(task_update_pending) {
       UpdateTaskBar();
       task_update_pending = 0;
@@ -251,18 +291,94 @@ void Signal(void)
    }
 
    GetCurrentTime(&now);
-   if(GetTimeDifference(&now, &last) < MIN_TIME_DELTA) {
-      return;
+   havePosition = 0;
+
+   /* Run the timers that are due.  Periodic timers are requeued before
+    * running, since the callback may unregister itself.  Timers queued
+    * by the callbacks wait for the next pass. */
+   count = timerCount;
+   while(count > 0 && timerCount > 0
+         && !IsEarlier(&now, &timerHeap[0]->deadline)) {
+      cp = timerHeap[0];
+      if(cp->freq > 0) {
+         AddTime(&cp->deadline, cp->freq);
+         if(IsEarlier(&cp->deadline, &now)) {
+            /* Fell behind; skip the missed runs. */
+            cp->deadline = now;
+            AddTime(&cp->deadline, cp->freq);
+         }
+         MoveCallback(0);
+      } else {
+         DequeueCallback(cp);
+      }
+      if(!havePosition) {
+         GetMousePosition(&x, &y, &w);
+         havePosition = 1;
+      }
+      (cp->callback)(&now, x, y, w, cp->data);
+      count -= 1;
    }
-   last = now;
 
-   GetMousePosition(&x, &y, &w);
-   for(cp = callbacks; cp; cp = cp->next) {
-      if(cp->freq == 0 || GetTimeDifference(&now, &cp->last) >= cp->freq) {
-         cp->last = now;
-         (cp->callback)(&now, x, y, w, cp->data);
+   /* Run the callbacks that run on every pass, at most once per
+    * MIN_TIME_DELTA.  If it is too soon, wake up when it is time. */
+   if(passCallbacks) {
+      if(GetTimeDifference(&now, &lastPass) < MIN_TIME_DELTA) {
+         passPending = 1;
+      } else {
+         lastPass = now;
+         passPending = 0;
+         if(!havePosition) {
+            GetMousePosition(&x, &y, &w);
+         }
+
+         /* A callback may unregister any callback, so removals are
+          * only marked during the walk and released afterwards. */
+         passRunning = 1;
+         for(cp = passCallbacks; cp; cp = cp->pass) {
+            if(cp->callback) {
+               (cp->callback)(&now, x, y, w, cp->data);
+            }
+         }
+         passRunning = 0;
+         if(passRemoved) {
+            CallbackNode **cpp = &passCallbacks;
+            while(*cpp) {
+               cp = *cpp;
+               if(cp->callback) {
+                  cpp = &cp->pass;
+               } else {
+                  *cpp = cp->pass;
+                  Release(cp);
+               }
+            }
+            passRemoved = 0;
+         }
+      }
+   } else {
+      passPending = 0;
+   }
+}
+
+/** Get the time of the next timer.
+ * @param deadline Set to the deadline if there is one.
+ * @return 1 if there is a deadline, 0 to wait for events only.
+ */
+char GetNextDeadline(TimeType *deadline)
+{
+   char result = 0;
+   if(timerCount > 0) {
+      *deadline = timerHeap[0]->deadline;
+      result = 1;
+   }
+   if(passPending) {
+      TimeType when = lastPass;
+      AddTime(&when, MIN_TIME_DELTA);
+      if(!result || IsEarlier(&when, deadline)) {
+         *deadline = when;
       }
+      result = 1;
    }
+   return result;
 }
 
 /** Process an event. */
@@ -746,10 +862,11 @@ void HandleKeyRelease(const XKeyEvent *event)
 }
 
 /** Process a configure request. */
-void HandleConfigureRequest(const XConfigureRequestEvent *event)
+void HandleConfigureRequest(XConfigureRequestEvent *event)
 {
    ClientNode *np;
 
+   MergeConfigureRequests(event);
    if(HandleDockConfigureRequest(event)) {
       return;
    }
@@ -885,6 +1002,51 @@ void HandleConfigureRequest(const XConfigureRequestEvent *event)
    }
 }
 
+/** Merge queued configure requests for a window into one request.
+ * Clients that resize in a loop can queue many requests; only the
+ * final geometry and stacking need to be applied.  This only looks at
+ * events that have already been received.
+ */
+void MergeConfigureRequests(XConfigureRequestEvent *event)
+{
+   XEvent temp;
+   while(JXCheckIfEvent(display, &temp, MatchConfigureRequest,
+                        (XPointer)&event->window)) {
+      const XConfigureRequestEvent *next = &temp.xconfigurerequest;
+      if(next->value_mask & CWX) {
+         event->x = next->x;
+      }
+      if(next->value_mask & CWY) {
+         event->y = next->y;
+      }
+      if(next->value_mask & CWWidth) {
+         event->width = next->width;
+      }
+      if(next->value_mask & CWHeight) {
+         event->height = next->height;
+      }
+      if(next->value_mask & CWBorderWidth) {
+         event->border_width = next->border_width;
+      }
+      if(next->value_mask & CWStackMode) {
+         /* The sibling goes with the stack mode it was sent with. */
+         event->value_mask &= ~CWSibling;
+         event->detail = next->detail;
+      }
+      if(next->value_mask & CWSibling) {
+         event->above = next->above;
+      }
+      event->value_mask |= next->value_mask;
+   }
+}
+
+/** Predicate for configure requests for a window. */
+Bool MatchConfigureRequest(Display *d, XEvent *e, XPointer arg)
+{
+   return e->type == ConfigureRequest
+       && e->xconfigurerequest.window == *(Window*)arg;
+}
+
 /** Process a configure notify event. */
 char HandleConfigureNotify(const XConfigureEvent *event)
 {
@@ -980,10 +1142,10 @@ char HandlePropertyNotify(const XPropertyEvent *event)
    ClientNode *np = FindClientByWindow(event->window);
    if(np) {
       char changed = 0;
+      DiscardPropertyEvents(event);
       switch(event->atom) {
       case XA_WM_NAME:
-         ReadWMName(np);
-         changed = 1;
+         RefreshClientTitle(np);
          break;
       case XA_WM_NORMAL_HINTS:
          ReadWMNormalHints(np);
@@ -1019,10 +1181,11 @@ char HandlePropertyNotify(const XPropertyEvent *event)
             ReadWMProtocols(np->window, &np->state);
          } else if(event->atom == atoms[ATOM_NET_WM_ICON]) {
             LoadIcon(np);
+            InvalidateBorder(np);
+            InvalidateTaskBar();
             changed = 1;
          } else if(event->atom == atoms[ATOM_NET_WM_NAME]) {
-            ReadWMName(np);
-            changed = 1;
+            RefreshClientTitle(np);
          } else if(event->atom == atoms[ATOM_NET_WM_STRUT_PARTIAL]) {
             ReadClientStrut(np);
          } else if(event->atom == atoms[ATOM_NET_WM_STRUT]) {
@@ -1056,6 +1219,28 @@ char HandlePropertyNotify(const XPropertyEvent *event)
    return 1;
 }
 
+/** Discard queued changes to the same property of the same window.
+ * Properties are read when handled, so later notifications for the
+ * same property would only read the same value again.
+ */
+void DiscardPropertyEvents(const XPropertyEvent *event)
+{
+   XEvent temp;
+   while(JXCheckIfEvent(display, &temp, MatchPropertyEvent,
+                        (XPointer)event)) {
+      UpdateTime(&temp);
+   }
+}
+
+/** Predicate for property notify events matching a window and atom. */
+Bool MatchPropertyEvent(Display *d, XEvent *e, XPointer arg)
+{
+   const XPropertyEvent *event = (const XPropertyEvent*)arg;
+   return e->type == PropertyNotify
+       && e->xproperty.window == event->window
+       && e->xproperty.atom == event->atom;
+}
+
 /** Handle a client message. */
 void HandleClientMessage(const XClientMessageEvent *event)
 {
@@ -1148,6 +1333,8 @@ void HandleClientMessage(const XClientMessageEvent *event)
          Exit(0);
       } else if(event->message_type == atoms[ATOM_JWM_RELOAD]) {
          ReloadMenu();
+      } else if(event->message_type == atoms[ATOM_JWM_STATS]) {
+         ShowStatistics();
       } else if(event->message_type == atoms[ATOM_NET_CURRENT_DESKTOP]) {
          ChangeDesktop(event->data.l[0]);
       } else if(event->message_type == atoms[ATOM_NET_SHOWING_DESKTOP]) {
@@ -1624,8 +1811,10 @@ void HandleUnmapNotify(const XUnmapEvent *event)
    if(np) {
 
       /* Grab the server to prevent the client from destroying the
-       * window after we check for a DestroyNotify. */
+       * window after we check for a DestroyNotify.
+       * Sync so that a DestroyNotify sent before the grab is queued. */
       GrabServer();
+      JXSync(display, False);
 
       if(np->controller) {
          (np->controller)(1);
@@ -1762,30 +1951,172 @@ void UpdateTime(const XEvent *event)
 /** Register a callback. */
 void RegisterCallback(int freq, SignalCallback callback, void *data)
 {
+   const unsigned bucket = ((size_t)data / sizeof(void*)) % CALLBACK_HASH_SIZE;
    CallbackNode *cp;
+
+   Assert(!*FindCallback(callback, data));
+
    cp = Allocate(sizeof(CallbackNode));
-   cp->last.seconds = 0;
-   cp->last.ms = 0;
    cp->freq = freq;
+   cp->index = -1;
    cp->callback = callback;
    cp->data = data;
-   cp->next = callbacks;
-   callbacks = cp;
+   cp->next = callbackHash[bucket];
+   callbackHash[bucket] = cp;
+   cp->pass = NULL;
+
+   if(freq == 0) {
+      cp->pass = passCallbacks;
+      passCallbacks = cp;
+   } else if(freq > 0) {
+      /* Periodic callbacks run for the first time on the next pass. */
+      GetCurrentTime(&cp->deadline);
+      QueueCallback(cp);
+   }
 }
 
 /** Unregister a callback. */
 void UnregisterCallback(SignalCallback callback, void *data)
 {
-   CallbackNode **cp;
-   for(cp = &callbacks; *cp; cp = &(*cp)->next) {
-      if((*cp)->callback == callback && (*cp)->data == data) {
-         CallbackNode *temp = *cp;
-         *cp = (*cp)->next;
-         Release(temp);
+   CallbackNode **cpp = FindCallback(callback, data);
+   CallbackNode *cp = *cpp;
+
+   Assert(cp);
+   *cpp = cp->next;
+
+   if(cp->freq == 0) {
+      if(passRunning) {
+         /* Signal is walking the list; it releases the node. */
+         cp->callback = NULL;
+         passRemoved = 1;
          return;
       }
+      for(cpp = &passCallbacks; *cpp != cp; cpp = &(*cpp)->pass);
+      *cpp = cp->pass;
+   }
+   DequeueCallback(cp);
+   Release(cp);
+}
+
+/** Schedule a callback to run at a specific time. */
+void ScheduleCallback(SignalCallback callback, void *data,
+                      const TimeType *when)
+{
+   CallbackNode *cp = *FindCallback(callback, data);
+   Assert(cp);
+   cp->deadline = *when;
+   QueueCallback(cp);
+}
+
+/** Cancel the next run of a callback. */
+void CancelCallback(SignalCallback callback, void *data)
+{
+   CallbackNode *cp = *FindCallback(callback, data);
+   Assert(cp);
+   if(cp->freq < 0) {
+      DequeueCallback(cp);
+   }
+}
+
+/** Find the link to a registered callback (which is NULL if none). */
+CallbackNode **FindCallback(SignalCallback callback, void *data)
+{
+   const unsigned bucket = ((size_t)data / sizeof(void*)) % CALLBACK_HASH_SIZE;
+   CallbackNode **cpp;
+   for(cpp = &callbackHash[bucket]; *cpp; cpp = &(*cpp)->next) {
+      if((*cpp)->callback == callback && (*cpp)->data == data) {
+         break;
+      }
+   }
+   return cpp;
+}
+
+/** Add a callback to the timer heap or update its position. */
+void QueueCallback(CallbackNode *cp)
+{
+   if(cp->index < 0) {
+      if(timerCount == timerCapacity) {
+         timerCapacity = timerCapacity ? timerCapacity * 2 : 8;
+         timerHeap = Reallocate(timerHeap,
+                                sizeof(CallbackNode*) * timerCapacity);
+      }
+      cp->index = timerCount;
+      timerHeap[timerCount] = cp;
+      timerCount += 1;
+   }
+   MoveCallback(cp->index);
+}
+
+/** Remove a callback from the timer heap. */
+void DequeueCallback(CallbackNode *cp)
+{
+   const int index = cp->index;
+   CallbackNode *last;
+
+   if(index < 0) {
+      return;
+   }
+   cp->index = -1;
+   timerCount -= 1;
+   last = timerHeap[timerCount];
+   if(last != cp) {
+      timerHeap[index] = last;
+      last->index = index;
+      MoveCallback(index);
+   }
+   if(timerCount == 0) {
+      Release(timerHeap);
+      timerHeap = NULL;
+      timerCapacity = 0;
+   }
+}
+
+/** Restore the heap order for a callback whose deadline changed. */
+void MoveCallback(int index)
+{
+   CallbackNode *cp = timerHeap[index];
+
+   /* Move toward the top while earlier than the parent. */
+   while(index > 0) {
+      const int parent = (index - 1) / 2;
+      if(!IsEarlier(&cp->deadline, &timerHeap[parent]->deadline)) {
+         break;
+      }
+      timerHeap[index] = timerHeap[parent];
+      timerHeap[index]->index = index;
+      index = parent;
    }
-   Assert(0);
+
+   /* Move toward the bottom while later than the earliest child. */
+   for(;;) {
+      int child = 2 * index + 1;
+      if(child >= timerCount) {
+         break;
+      }
+      if(child + 1 < timerCount
+         && IsEarlier(&timerHeap[child + 1]->deadline,
+                      &timerHeap[child]->deadline)) {
+         child += 1;
+      }
+      if(!IsEarlier(&timerHeap[child]->deadline, &cp->deadline)) {
+         break;
+      }
+      timerHeap[index] = timerHeap[child];
+      timerHeap[index]->index = index;
+      index = child;
+   }
+
+   timerHeap[index] = cp;
+   cp->index = index;
+}
+
+/** Determine if a time is before another time. */
+char IsEarlier(const TimeType *a, const TimeType *b)
+{
+   if(a->seconds != b->seconds) {
+      return a->seconds < b->seconds;
+   }
+   return a->ms < b->ms;
 }
 
 /** Restack clients before waiting for an event. */
@@ -1805,3 +2136,16 @@ void RequirePagerUpdate()
 {
    pager_update_pending = 1;
 }
+
+/** Redraw icons before waiting for an event. */
+void RequireIconUpdate()
+{
+   icon_update_pending = 1;
+}
+
+/** Get the number of times the event loop woke up. */
+void GetWakeupStatistics(unsigned long *count, unsigned long *idle)
+{
+   *count = wakeupCount;
+   *idle = idleWakeupCount;
+}
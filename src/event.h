@@ -50,8 +50,13 @@ void DiscardKeyEvents(XEvent *event, Window w);
  */
 void UpdateTime(const XEvent *event);
 
+/** Frequency for callbacks that only run when scheduled. */
+#define CALLBACK_SCHEDULED -1
+
 /** Register a callback.
- * @param freq The frequency in milliseconds.
+ * A frequency of 0 runs the callback whenever events are processed.
+ * A periodic callback first runs the next time events are processed.
+ * @param freq The frequency in milliseconds or CALLBACK_SCHEDULED.
  * @param callback The callback function.
  * @param data Data to pass to the callback.
  */
@@ -63,6 +68,23 @@ void RegisterCallback(int freq, SignalCallback callback, void *data);
  */
 void UnregisterCallback(SignalCallback callback, void *data);
 
+/** Schedule a registered callback to run at a specific time.
+ * This replaces the next run of the callback.  A periodic callback
+ * continues at its regular frequency after running at this time.
+ * @param callback The callback function.
+ * @param data The data passed to the register function.
+ * @param when The time to run the callback.
+ */
+void ScheduleCallback(SignalCallback callback, void *data,
+                      const struct TimeType *when);
+
+/** Cancel a scheduled run of a callback.
+ * This only affects callbacks registered with CALLBACK_SCHEDULED.
+ * @param callback The callback function.
+ * @param data The data passed to the register function.
+ */
+void CancelCallback(SignalCallback callback, void *data);
+
 /** Restack clients before waiting for an event. */
 void RequireRestack();
 
@@ -72,5 +94,16 @@ void RequireTaskUpdate();
 /** Update the pager before waiting for an event. */
 void RequirePagerUpdate();
 
+/** Redraw components showing icons before waiting for an event.
+ * This is used when an image finishes decoding in the background.
+ */
+void RequireIconUpdate();
+
+/** Get the number of times the event loop woke up since startup.
+ * @param count Location to store the number of wakeups.
+ * @param idle Location to store the wakeups with no X event queued.
+ */
+void GetWakeupStatistics(unsigned long *count, unsigned long *idle);
+
 #endif /* EVENT_H */
 
@@ -16,6 +16,7 @@
 #include "misc.h"
 #include "schrift_x11.h"
 #include "sds.h"
+#include "drawpool.h"
 
 #ifdef USE_ICONV
 #  ifdef HAVE_LANGINFO_H
@@ -206,6 +207,8 @@ static iconv_t toUTF8 = (iconv_t)-1;
 
 #ifdef USE_XRENDER
 static SFT_X *fonts[FONT_COUNT];
+static Picture pens[COLOR_COUNT];
+static Picture GetPen(ColorType color);
 #else
 static XFontStruct *fonts[FONT_COUNT];
 #endif
@@ -354,6 +357,14 @@ void ShutdownFonts(void)
          fonts[x] = NULL;
       }
    }
+#ifdef USE_XRENDER
+   for(x = 0; x < COLOR_COUNT; x++) {
+      if(pens[x] != None) {
+         JXRenderFreePicture(display, pens[x]);
+         pens[x] = None;
+      }
+   }
+#endif
 }
 
 /** Destroy font data. */
@@ -532,11 +543,7 @@ void RenderString(Drawable d, FontType font, ColorType color,
    FriBidiParType type = FRIBIDI_PAR_ON;
    int unicodeLength;
 #endif
-#ifdef USE_XRENDER
-   XRenderColor * sft_color = GetXRenderColor(color);
-#else
-   XGCValues gcValues;
-   unsigned long gcMask;
+#ifndef USE_XRENDER
    GC gc;
 #endif
    char *utf8String;
@@ -552,12 +559,8 @@ void RenderString(Drawable d, FontType font, ColorType color,
    /* Get the length of the UTF-8 string. */
    len = strlen(utf8String);
 
-#ifdef USE_XRENDER
-//   xd = XftDrawCreate(display, d, rootVisual, rootColormap);
-#else
-   gcMask = GCGraphicsExposures;
-   gcValues.graphics_exposures = False;
-   gc = JXCreateGC(display, d, gcMask, &gcValues);
+#ifndef USE_XRENDER
+   gc = GetPoolGC(d, rootDepth);
 #endif
 
 
@@ -593,8 +596,8 @@ void RenderString(Drawable d, FontType font, ColorType color,
 
    /* Display the string. */
 #ifdef USE_XRENDER
-   SFT_X_draw_string32(display, d, x, y,  sft_color, fonts[font], str, width);
-   free(sft_color);
+   SFT_X_draw_string32_pen(display, d, x, y, GetPen(color), fonts[font],
+                           str, width);
 #else
    JXSetForeground(display, gc, colors[color]);
    JXSetRegion(display, gc, renderRegion);
@@ -612,10 +615,37 @@ void RenderString(Drawable d, FontType font, ColorType color,
 
    XDestroyRegion(renderRegion);
 
-#ifdef USE_XRENDER
-//   XftDrawDestroy(xd);
-#else
-   JXFreeGC(display, gc);
+#ifndef USE_XRENDER
+   JXSetClipMask(display, gc, None);
+   ReleasePoolGC(gc);
 #endif
 
 }
+
+#ifdef USE_XRENDER
+/** Get a repeating picture of a color used to draw text.
+ * Pens are created on first use and kept until shutdown.
+ */
+Picture GetPen(ColorType color)
+{
+   if(pens[color] == None) {
+      XRenderPictureAttributes attr;
+      XRenderPictFormat *fp;
+      XRenderColor *rcolor;
+      Pixmap pixmap;
+
+      pixmap = JXCreatePixmap(display, rootWindow, 1, 1, 24);
+      fp = JXRenderFindStandardFormat(display, PictStandardRGB24);
+      attr.repeat = True;
+      pens[color] = JXRenderCreatePicture(display, pixmap, fp,
+                                          CPRepeat, &attr);
+      JXFreePixmap(display, pixmap);
+
+      rcolor = GetXRenderColor(color);
+      JXRenderFillRectangle(display, PictOpSrc, pens[color], rcolor,
+                            0, 0, 1, 1);
+      Release(rcolor);
+   }
+   return pens[color];
+}
+#endif
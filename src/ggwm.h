@@ -78,9 +78,21 @@
 #  ifdef USE_XRENDER
 #     include <X11/extensions/Xrender.h>
 #  endif
+#  ifdef USE_COMPOSITE
+#     include <X11/extensions/Xcomposite.h>
+#     include <X11/extensions/Xdamage.h>
+#  endif
+#  ifdef USE_SHM
+#     include <sys/ipc.h>
+#     include <sys/shm.h>
+#     include <X11/extensions/XShm.h>
+#  endif
 #  ifdef USE_FRIBIDI
 #     include <fribidi/fribidi.h>
 #  endif
+#  ifdef USE_XCB
+#     include <X11/Xlib-xcb.h>
+#  endif
 
 #endif /* MAKE_DEPEND */
 
@@ -0,0 +1,46 @@
+/**
+ * @file globals.c
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Global state declared in main.h.
+ *
+ * This is kept out of main.c so that other programs, such as the image
+ * benchmark, can be linked with every object except main.o.
+ *
+ */
+
+#include "ggwm.h"
+#include "main.h"
+
+Display *display = NULL;
+Window rootWindow;
+int rootWidth, rootHeight;
+int rootScreen;
+Colormap rootColormap;
+Visual *rootVisual;
+int rootDepth;
+GC rootGC;
+int colormapCount;
+Window supportingWindow;
+Atom managerSelection;
+
+char shouldExit = 0;
+char shouldRestart = 0;
+char isRestarting = 0;
+char initializing = 0;
+char shouldReload = 0;
+
+unsigned int currentDesktop = 0;
+unsigned int previousDesktop = 0;
+
+char *exitCommand = NULL;
+
+XContext clientContext;
+XContext frameContext;
+
+#ifdef USE_XRENDER
+char haveRender;
+#endif
+
+char *configPath = NULL;
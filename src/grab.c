@@ -8,16 +8,29 @@
  */
 
 #include "ggwm.h"
+#include "grab.h"
 #include "main.h"
+#include "timing.h"
+#include "misc.h"
+
+/** Grabs held longer than this (in milliseconds) are reported. */
+#define GRAB_REPORT_MS 50
 
 static unsigned int grabCount = 0;
 
-/** Grab the server and sync. */
+/* Time spent with the server grabbed. */
+static TimeType grabStart;
+static unsigned long grabTotal = 0;
+static unsigned long grabLongest = 0;
+static unsigned int grabsTaken = 0;
+
+/** Grab the server. */
 void GrabServer(void)
 {
    if(grabCount == 0) {
       JXGrabServer(display);
-      JXSync(display, False);
+      GetCurrentTime(&grabStart);
+      grabsTaken += 1;
    }
    grabCount += 1;
 }
@@ -28,7 +41,26 @@ void UngrabServer(void)
    Assert(grabCount > 0);
    grabCount -= 1;
    if(grabCount == 0) {
+      TimeType now;
+      unsigned long held;
       JXUngrabServer(display);
+      GetCurrentTime(&now);
+      held = GetTimeDifference(&grabStart, &now);
+      grabTotal += held;
+      grabLongest = Max(grabLongest, held);
+      if(JUNLIKELY(held >= GRAB_REPORT_MS)) {
+         Debug("server grabbed for %lu ms (%u grabs, %lu ms total)",
+               held, grabsTaken, grabTotal);
+      }
    }
 }
 
+/** Get statistics about server grabs. */
+void GetGrabStatistics(unsigned *count, unsigned long *total,
+                       unsigned long *longest)
+{
+   *count = grabsTaken;
+   *total = grabTotal;
+   *longest = grabLongest;
+}
+
@@ -10,11 +10,25 @@
 #ifndef GRAB_H
 #define GRAB_H
 
-/** Grab the server and sync. */
+/** Grab the server.
+ * Grabs nest; the server is released by the last UngrabServer.
+ * This does not wait for the grab to take effect, so callers that
+ * need events generated before the grab must sync themselves.
+ * Every other client is frozen while the server is grabbed, so
+ * grabs should only cover operations that must be atomic.
+ */
 void GrabServer(void);
 
 /** Ungrab the server. */
 void UngrabServer(void);
 
+/** Get statistics about server grabs since startup.
+ * @param count Location to store the number of grabs taken.
+ * @param total Location to store the time grabbed in milliseconds.
+ * @param longest Location to store the longest grab in milliseconds.
+ */
+void GetGrabStatistics(unsigned *count, unsigned long *total,
+                       unsigned long *longest);
+
 #endif /* GRAB_H */
 
@@ -5,11 +5,47 @@
  *
  * @brief Gradient fill functions.
  *
+ * Gradients are rendered once into a one pixel wide (or high) strip,
+ * which is kept in a small cache and tiled over the area to fill.
+ *
  */
 
 #include "ggwm.h"
 #include "gradient.h"
 #include "main.h"
+#include "upload.h"
+
+/** Number of gradient strips to keep. */
+#define GRADIENT_CACHE_SIZE 32
+
+/** A rendered gradient strip. */
+typedef struct GradientNode {
+   Pixmap pixmap;
+   long fromColor;
+   long toColor;
+   unsigned length;
+   unsigned lastUsed;
+   GradientDirection direction;
+} GradientNode;
+
+static GradientNode strips[GRADIENT_CACHE_SIZE];
+static unsigned stripCount = 0;
+static unsigned stripClock = 0;
+
+static Pixmap GetGradientStrip(long fromColor, long toColor,
+                               unsigned length, GradientDirection gd);
+static Pixmap CreateGradientStrip(long fromColor, long toColor,
+                                  unsigned length, GradientDirection gd);
+
+/** Shutdown gradients. */
+void ShutdownGradients(void)
+{
+   unsigned i;
+   for(i = 0; i < stripCount; i++) {
+      JXFreePixmap(display, strips[i].pixmap);
+   }
+   stripCount = 0;
+}
 
 /** Draw a gradient. */
 void DrawGradient(Drawable d, GC g,
@@ -18,71 +54,116 @@ void DrawGradient(Drawable d, GC g,
                   unsigned width, unsigned height,
                   GradientDirection gd)
 {
-
-   unsigned i;
-   unsigned limit;
-   XColor colors[2];
-   float red, green, blue;
-   float ared, agreen, ablue;
-   float bred, bgreen, bblue;
-   float redStep, greenStep, blueStep;
+   Pixmap strip;
 
    /* Return if there's nothing to do or if the background was filled elsewhere. */
    if((width == 0 || height == 0) || (fromColor == toColor)) {
       return;
    }
 
-   /* Query the from/to colors. */
-   colors[0].pixel = fromColor;
-   colors[1].pixel = toColor;
-   JXQueryColors(display, rootColormap, colors, 2);
+   strip = GetGradientStrip(fromColor, toColor,
+                            gd == GRADIENT_VERTICAL ? height : width, gd);
+
+   /* Tile the strip over the area. */
+   JXSetTile(display, g, strip);
+   JXSetTSOrigin(display, g, x, y);
+   JXSetFillStyle(display, g, FillTiled);
+   JXFillRectangle(display, d, g, x, y, width, height);
+   JXSetFillStyle(display, g, FillSolid);
+}
+
+/** Get a gradient strip, rendering it if it is not cached. */
+Pixmap GetGradientStrip(long fromColor, long toColor,
+                        unsigned length, GradientDirection gd)
+{
+   GradientNode *np;
+   unsigned i;
 
-   /* Set the "from" color. */
-   ared = colors[0].red;
-   agreen = colors[0].green;
-   ablue = colors[0].blue;
+   stripClock += 1;
+   for(i = 0; i < stripCount; i++) {
+      np = &strips[i];
+      if(np->fromColor == fromColor && np->toColor == toColor
+         && np->length == length && np->direction == gd) {
+         np->lastUsed = stripClock;
+         return np->pixmap;
+      }
+   }
 
-   /* Set the "to" color. */
-   bred = colors[1].red;
-   bgreen = colors[1].green;
-   bblue = colors[1].blue;
+   /* Use a free entry or replace the least recently used strip. */
+   if(stripCount < GRADIENT_CACHE_SIZE) {
+      np = &strips[stripCount];
+      stripCount += 1;
+   } else {
+      np = &strips[0];
+      for(i = 1; i < GRADIENT_CACHE_SIZE; i++) {
+         if(strips[i].lastUsed < np->lastUsed) {
+            np = &strips[i];
+         }
+      }
+      JXFreePixmap(display, np->pixmap);
+   }
+
+   np->pixmap = CreateGradientStrip(fromColor, toColor, length, gd);
+   np->fromColor = fromColor;
+   np->toColor = toColor;
+   np->length = length;
+   np->direction = gd;
+   np->lastUsed = stripClock;
+   return np->pixmap;
+}
+
+/** Render a gradient strip. */
+Pixmap CreateGradientStrip(long fromColor, long toColor,
+                           unsigned length, GradientDirection gd)
+{
+   XImage *image;
+   Pixmap pixmap;
+   unsigned i;
+   XColor colors[2];
+   float red, green, blue;
+   float redStep, greenStep, blueStep;
+
+   /* Get the from/to colors. */
+   colors[0].pixel = fromColor;
+   colors[1].pixel = toColor;
+   GetColorComponents(&colors[0]);
+   GetColorComponents(&colors[1]);
 
    /* Determine the step. */
+   red = colors[0].red;
+   green = colors[0].green;
+   blue = colors[0].blue;
+   redStep = ((float)colors[1].red - red) / length;
+   greenStep = ((float)colors[1].green - green) / length;
+   blueStep = ((float)colors[1].blue - blue) / length;
+
    if(gd == GRADIENT_VERTICAL) {
-      redStep = (bred - ared) / height;
-      greenStep = (bgreen - agreen) / height;
-      blueStep = (bblue - ablue) / height;
-      limit = height;
+      pixmap = JXCreatePixmap(display, rootWindow, 1, length, rootDepth);
+      image = CreateUploadImage(rootDepth, 1, length);
    } else {
-      redStep = (bred - ared) / width;
-      greenStep = (bgreen - agreen) / width;
-      blueStep = (bblue - ablue) / width;
-      limit = width;
+      pixmap = JXCreatePixmap(display, rootWindow, length, 1, rootDepth);
+      image = CreateUploadImage(rootDepth, length, 1);
    }
 
-   /* Loop over each line or column. */
-   red = ared;
-   blue = ablue;
-   green = agreen;
-   for(i = 0; i < limit; i++) {
+   /* Compute the color for each line or column. */
+   for(i = 0; i < length; i++) {
 
-      /* Determine the color for this line. */
       colors[0].red = (unsigned short)red;
       colors[0].green = (unsigned short)green;
       colors[0].blue = (unsigned short)blue;
-
       GetColor(&colors[0]);
 
-      /* Draw the line. */
-      JXSetForeground(display, g, colors[0].pixel);
       if(gd == GRADIENT_VERTICAL) {
-         JXDrawLine(display, d, g, x, y + i, x + width - 1, y + i);
+         XPutPixel(image, 0, i, colors[0].pixel);
       } else {
-         JXDrawLine(display, d, g, x + i, y, x + i + 1, y + height - 1);
+         XPutPixel(image, i, 0, colors[0].pixel);
       }
-      
+
       red += redStep;
       green += greenStep;
       blue += blueStep;
    }
+
+   UploadImage(pixmap, rootGC, image);
+   return pixmap;
 }
@@ -12,8 +12,17 @@
 
 #include "color.h"
 
+/*@{*/
+#define InitializeGradients() (void)(0)
+#define StartupGradients()    (void)(0)
+void ShutdownGradients(void);
+#define DestroyGradients()    (void)(0)
+/*@}*/
+
 /** Draw a gradient.
  * Note that no action is taken if fromColor == toColor.
+ * The gradient is rendered once per color pair, direction, and size
+ * and then tiled, so repeated draws cost a single fill request.
  * @param d The drawable on which to draw the gradient.
  * @param g The graphics context to use.
  * @param fromColor The starting color pixel value.
@@ -59,6 +59,7 @@ void DisplayHelp(void)
           "  -p          Parse the configuration file and exit\n"
           "  -reload     Reload menu (send _JWM_RELOAD to the root)\n"
           "  -restart    Restart JWM (send _JWM_RESTART to the root)\n"
+          "  -stats      Show cache, grab, and wakeup counts (send _JWM_STATS)\n"
           "  -v          Display version information\n");
 }
 
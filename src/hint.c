@@ -14,6 +14,7 @@
 #include "misc.h"
 #include "font.h"
 #include "settings.h"
+#include "prefetch.h"
 
 #include <X11/Xlibint.h>
 
@@ -70,6 +71,7 @@ Atom atoms[ATOM_COUNT];
 const char jwmRestart[]       = "_JWM_RESTART";
 const char jwmExit[]          = "_JWM_EXIT";
 const char jwmReload[]        = "_JWM_RELOAD";
+const char jwmStats[]         = "_JWM_STATS";
 const char managerProperty[]  = "MANAGER";
 
 static const AtomNode atomList[] = {
@@ -165,6 +167,7 @@ static const AtomNode atomList[] = {
    { &atoms[ATOM_JWM_RESTART],               &jwmRestart[0]                },
    { &atoms[ATOM_JWM_EXIT],                  &jwmExit[0]                   },
    { &atoms[ATOM_JWM_RELOAD],                &jwmReload[0]                 },
+   { &atoms[ATOM_JWM_STATS],                 &jwmStats[0]                  },
    { &atoms[ATOM_JWM_WM_STATE_MAXIMIZED_TOP],
       "_JWM_WM_STATE_MAXIMIZED_TOP" },
    { &atoms[ATOM_JWM_WM_STATE_MAXIMIZED_BOTTOM],
@@ -180,12 +183,15 @@ static char CheckShape(Window win);
 static void WriteNetAllowed(ClientNode *np);
 static void ReadWMState(Window win, ClientState *state);
 static void ReadMotifHints(Window win, ClientState *state);
+static void ReadWMTransientFor(ClientNode *np);
+static char ReadSizeHints(Window win, XSizeHints *hints);
 
 /** Set root hints and intern atoms. */
 void StartupHints(void)
 {
 
    unsigned long *array;
+   char **names;
    char *data;
    Atom *supported;
    Window win;
@@ -207,10 +213,16 @@ void StartupHints(void)
    array = (unsigned long*)data;
    supported = (Atom*)data;
 
-   /* Intern the atoms */
+   /* Intern the atoms in one round trip. */
+   names = AllocateStack(ATOM_COUNT * sizeof(char*));
    for(x = 0; x < ATOM_COUNT; x++) {
-      *atomList[x].atom = JXInternAtom(display, atomList[x].name, False);
+      names[x] = (char*)atomList[x].name;
    }
+   JXInternAtoms(display, names, ATOM_COUNT, False, supported);
+   for(x = 0; x < ATOM_COUNT; x++) {
+      *atomList[x].atom = supported[x];
+   }
+   ReleaseStack(names);
 
    /* _NET_SUPPORTED */
    for(x = FIRST_NET_ATOM; x <= LAST_NET_ATOM; x++) {
@@ -288,7 +300,6 @@ void ReadCurrentDesktop(void)
 void ReadClientInfo(ClientNode *np, char alreadyMapped)
 {
 
-   Status status;
    ClientNode *pp;
 
    Assert(np);
@@ -298,11 +309,7 @@ void ReadClientInfo(ClientNode *np, char alreadyMapped)
    ReadWMNormalHints(np);
    ReadWMColormaps(np);
    ReadWMMachine(np);
-
-   status = JXGetTransientForHint(display, np->window, &np->owner);
-   if(!status) {
-      np->owner = None;
-   }
+   ReadWMTransientFor(np);
 
    /* Read the window state. */
    np->state = ReadWindowState(np->window, alreadyMapped);
@@ -573,9 +580,9 @@ ClientState ReadWindowState(Window win, char alreadyMapped)
    }
 
    /* _NET_WM_STATE */
-   status = JXGetWindowProperty(display, win, atoms[ATOM_NET_WM_STATE], 0, 32,
-                                False, XA_ATOM, &realType, &realFormat,
-                                &count, &extra, &temp);
+   status = GetWindowProperty(win, atoms[ATOM_NET_WM_STATE], 0, 32,
+                              XA_ATOM, &realType, &realFormat,
+                              &count, &extra, &temp);
    if(status == Success && realFormat != 0) {
       if(count > 0) {
          state = (Atom*)temp;
@@ -619,9 +626,9 @@ ClientState ReadWindowState(Window win, char alreadyMapped)
    }
 
    /* _NET_WM_WINDOW_TYPE */
-   status = JXGetWindowProperty(display, win, atoms[ATOM_NET_WM_WINDOW_TYPE],
-                                0, 32, False, XA_ATOM, &realType, &realFormat,
-                                &count, &extra, &temp);
+   status = GetWindowProperty(win, atoms[ATOM_NET_WM_WINDOW_TYPE],
+                              0, 32, XA_ATOM, &realType, &realFormat,
+                              &count, &extra, &temp);
    if(status == Success && realFormat != 0) {
       /* Loop until we hit a window type we recognize. */
       state = (Atom*)temp;
@@ -722,10 +729,9 @@ void ReadWMName(ClientNode *np)
       Release(np->name);
    }
 
-   status = JXGetWindowProperty(display, np->window,
-                                atoms[ATOM_NET_WM_NAME], 0, 1024, False,
-                                atoms[ATOM_UTF8_STRING], &realType,
-                                &realFormat, &count, &extra, &name);
+   status = GetWindowProperty(np->window, atoms[ATOM_NET_WM_NAME], 0, 1024,
+                              atoms[ATOM_UTF8_STRING], &realType,
+                              &realFormat, &count, &extra, &name);
    if(status != Success || realFormat == 0) {
       np->name = NULL;
    } else {
@@ -738,11 +744,10 @@ void ReadWMName(ClientNode *np)
 
 #ifdef USE_XUTF8
    if(!np->name) {
-      status = JXGetWindowProperty(display, np->window,
-                                   XA_WM_NAME, 0, 1024, False,
-                                   atoms[ATOM_COMPOUND_TEXT],
-                                   &realType, &realFormat, &count,
-                                   &extra, &name);
+      status = GetWindowProperty(np->window, XA_WM_NAME, 0, 1024,
+                                 atoms[ATOM_COMPOUND_TEXT],
+                                 &realType, &realFormat, &count,
+                                 &extra, &name);
       if(status == Success && realFormat != 0) {
          char **tlist;
          XTextProperty tprop;
@@ -764,12 +769,16 @@ void ReadWMName(ClientNode *np)
 #endif
 
    if(!np->name) {
-      char *temp = NULL;
-      if(JXFetchName(display, np->window, &temp)) {
-         const size_t len = strlen(temp) + 1;
-         np->name = Allocate(len);
-         memcpy(np->name, temp, len);
-         JXFree(temp);
+      status = GetWindowProperty(np->window, XA_WM_NAME, 0, BUFSIZ,
+                                 XA_STRING, &realType, &realFormat,
+                                 &count, &extra, &name);
+      if(status == Success && name) {
+         if(realType == XA_STRING && realFormat == 8) {
+            np->name = Allocate(count + 1);
+            memcpy(np->name, name, count);
+            np->name[count] = 0;
+         }
+         JXFree(name);
       }
    }
 
@@ -779,34 +788,68 @@ void ReadWMName(ClientNode *np)
 void ReadWMMachine(ClientNode *np)
 {
    XTextProperty tprop;
+   unsigned long extra;
    char **tlist;
    int tcount;
+   int status;
 
    if(np->clientName) {
       Release(np->clientName);
    }
 
-   XGetWMClientMachine(display, np->window, &tprop);
+   np->clientName = NULL;
+   status = GetWindowProperty(np->window, XA_WM_CLIENT_MACHINE, 0, 1024,
+                              AnyPropertyType, &tprop.encoding,
+                              &tprop.format, &tprop.nitems, &extra,
+                              &tprop.value);
+   if(status != Success || !tprop.value) {
+      return;
+   }
    if(XmbTextPropertyToTextList(display, &tprop, &tlist, &tcount)
       == Success && tcount > 0) {
       const size_t len = strlen(tlist[0]) + 1;
       np->clientName = Allocate(len);
       memcpy(np->clientName, tlist[0], len);
       XFreeStringList(tlist);
-   } else {
-      np->clientName = NULL;
    }
+   JXFree(tprop.value);
 }
 
 /** Read the window class for a client. */
 void ReadWMClass(ClientNode *np)
 {
-   XClassHint hint;
+
+   unsigned long count;
+   int status;
+   unsigned long extra;
+   Atom realType;
+   int realFormat;
+   unsigned char *data;
+
    Assert(np);
-   if(JXGetClassHint(display, np->window, &hint)) {
-      np->instanceName = hint.res_name;
-      np->className = hint.res_class;
+
+   status = GetWindowProperty(np->window, XA_WM_CLASS, 0, BUFSIZ,
+                              XA_STRING, &realType, &realFormat,
+                              &count, &extra, &data);
+   if(status != Success || !data) {
+      return;
    }
+
+   /* The instance and class are consecutive NUL-terminated strings.
+    * The data always ends with a NUL. */
+   if(realType == XA_STRING && realFormat == 8) {
+      const char *instance = (const char*)data;
+      const size_t instanceLen = strlen(instance) + 1;
+      const char *resClass = instanceLen <= count
+                           ? instance + instanceLen : "";
+      const size_t classLen = strlen(resClass) + 1;
+      np->instanceName = Allocate(instanceLen);
+      memcpy(np->instanceName, instance, instanceLen);
+      np->className = Allocate(classLen);
+      memcpy(np->className, resClass, classLen);
+   }
+   JXFree(data);
+
 }
 
 /** Read the protocols hint for a window. */
@@ -825,9 +868,9 @@ void ReadWMProtocols(Window w, ClientState *state)
 
    state->status &= ~STAT_TAKEFOCUS;
    state->status &= ~STAT_DELETE;
-   status = JXGetWindowProperty(display, w, atoms[ATOM_WM_PROTOCOLS],
-                                0, 32, False, XA_ATOM, &realType, &realFormat,
-                                &count, &extra, &temp);
+   status = GetWindowProperty(w, atoms[ATOM_WM_PROTOCOLS],
+                              0, 32, XA_ATOM, &realType, &realFormat,
+                              &count, &extra, &temp);
    p = (Atom*)temp;
    if(status != Success || realFormat == 0 || !p) {
       return;
@@ -850,11 +893,10 @@ void ReadWMNormalHints(ClientNode *np)
 {
 
    XSizeHints hints;
-   long temp;
 
    Assert(np);
 
-   if(!JXGetWMNormalHints(display, np->window, &hints, &temp)) {
+   if(!ReadSizeHints(np->window, &hints)) {
       np->sizeFlags = 0;
    } else {
       np->sizeFlags = hints.flags;
@@ -916,19 +958,105 @@ void ReadWMNormalHints(ClientNode *np)
 
 }
 
+/** Read WM_NORMAL_HINTS the way XGetWMNormalHints does. */
+char ReadSizeHints(Window win, XSizeHints *hints)
+{
+
+   unsigned long count;
+   int status;
+   unsigned long extra;
+   Atom realType;
+   int realFormat;
+   unsigned char *data;
+   const long *values;
+
+   memset(hints, 0, sizeof(XSizeHints));
+   status = GetWindowProperty(win, XA_WM_NORMAL_HINTS, 0, 18,
+                              XA_WM_SIZE_HINTS, &realType, &realFormat,
+                              &count, &extra, &data);
+   if(status != Success || !data) {
+      return 0;
+   }
+   if(realType != XA_WM_SIZE_HINTS || realFormat != 32 || count < 15) {
+      JXFree(data);
+      return 0;
+   }
+
+   values = (const long*)data;
+   hints->flags = values[0] & (USPosition | USSize | PAllHints);
+   hints->x = values[1];
+   hints->y = values[2];
+   hints->width = values[3];
+   hints->height = values[4];
+   hints->min_width = values[5];
+   hints->min_height = values[6];
+   hints->max_width = values[7];
+   hints->max_height = values[8];
+   hints->width_inc = values[9];
+   hints->height_inc = values[10];
+   hints->min_aspect.x = values[11];
+   hints->min_aspect.y = values[12];
+   hints->max_aspect.x = values[13];
+   hints->max_aspect.y = values[14];
+
+   /* The base size and gravity were added in ICCCM version 1. */
+   if(count >= 18) {
+      hints->flags |= values[0] & (PBaseSize | PWinGravity);
+      hints->base_width = values[15];
+      hints->base_height = values[16];
+      hints->win_gravity = values[17];
+   }
+
+   JXFree(data);
+   return 1;
+
+}
+
+/** Read the window a client is transient for. */
+void ReadWMTransientFor(ClientNode *np)
+{
+
+   unsigned long count;
+   int status;
+   unsigned long extra;
+   Atom realType;
+   int realFormat;
+   unsigned char *data;
+
+   np->owner = None;
+   status = GetWindowProperty(np->window, XA_WM_TRANSIENT_FOR, 0, 1,
+                              XA_WINDOW, &realType, &realFormat,
+                              &count, &extra, &data);
+   if(status == Success && data) {
+      if(realType == XA_WINDOW && realFormat == 32 && count > 0) {
+         np->owner = *(Window*)data;
+      }
+      JXFree(data);
+   }
+
+}
+
 /** Read colormap information for a client. */
 void ReadWMColormaps(ClientNode *np)
 {
 
-   Window *windows;
+   unsigned long count;
+   int status;
+   unsigned long extra;
+   Atom realType;
+   int realFormat;
+   unsigned char *data;
    ColormapNode *cp;
-   int count;
 
    Assert(np);
 
-   if(JXGetWMColormapWindows(display, np->window, &windows, &count)) {
-      if(count > 0) {
-         int x;
+   status = GetWindowProperty(np->window, atoms[ATOM_WM_COLORMAP_WINDOWS],
+                              0, 1024, XA_WINDOW, &realType, &realFormat,
+                              &count, &extra, &data);
+   if(status == Success && data) {
+      if(realType == XA_WINDOW && realFormat == 32 && count > 0) {
+         const Window *windows = (const Window*)data;
+         unsigned long x;
 
          /* Free old colormaps. */
          while(np->colormaps) {
@@ -950,9 +1078,8 @@ void ReadWMColormaps(ClientNode *np)
             np->colormaps = cp;
          }
 
-         JXFree(windows);
-
       }
+      JXFree(data);
    }
 
 }
@@ -969,10 +1096,10 @@ void ReadWMState(Window win, ClientState *state)
    unsigned long *temp;
 
    count = 0;
-   status = JXGetWindowProperty(display, win, atoms[ATOM_WM_STATE], 0, 2,
-                                False, atoms[ATOM_WM_STATE],
-                                &realType, &realFormat,
-                                &count, &extra, (unsigned char**)&temp);
+   status = GetWindowProperty(win, atoms[ATOM_WM_STATE], 0, 2,
+                              atoms[ATOM_WM_STATE],
+                              &realType, &realFormat,
+                              &count, &extra, (unsigned char**)&temp);
    if(JLIKELY(status == Success && realFormat != 0)) {
       if(JLIKELY(count == 2)) {
          switch(temp[0]) {
@@ -995,16 +1122,29 @@ void ReadWMState(Window win, ClientState *state)
 void ReadWMHints(Window win, ClientState *state, char alreadyMapped)
 {
 
-   XWMHints *wmhints;
+   unsigned long count;
+   int status;
+   unsigned long extra;
+   Atom realType;
+   int realFormat;
+   unsigned char *data;
 
    Assert(win != None);
    Assert(state);
 
    state->status |= STAT_CANFOCUS;
-   wmhints = JXGetWMHints(display, win);
-   if(wmhints) {
-      if(!alreadyMapped && (wmhints->flags & StateHint)) {
-         switch(wmhints->initial_state) {
+   status = GetWindowProperty(win, XA_WM_HINTS, 0, 9, XA_WM_HINTS,
+                              &realType, &realFormat, &count, &extra, &data);
+   if(status != Success || !data) {
+      return;
+   }
+
+   /* Older clients omit the window group, the last of the 9 items. */
+   if(realType == XA_WM_HINTS && realFormat == 32 && count >= 8) {
+      const long *values = (const long*)data;
+      const long flags = values[0];
+      if(!alreadyMapped && (flags & StateHint)) {
+         switch(values[2]) {
          case IconicState:
             state->status |= STAT_MINIMIZED;
             break;
@@ -1012,16 +1152,16 @@ void ReadWMHints(Window win, ClientState *state, char alreadyMapped)
             break;
          }
       }
-      if((wmhints->flags & InputHint) && wmhints->input == False) {
+      if((flags & InputHint) && values[1] == 0) {
          state->status &= ~STAT_CANFOCUS;
       }
-      if(wmhints->flags & XUrgencyHint) {
+      if(flags & XUrgencyHint) {
          state->status |= STAT_URGENT;
       } else {
          state->status &= ~(STAT_URGENT | STAT_FLASH);
       }
-      JXFree(wmhints);
    }
+   JXFree(data);
 
 }
 
@@ -1050,9 +1190,9 @@ void ReadMotifHints(Window win, ClientState *state)
    Assert(win != None);
    Assert(state);
 
-   status = JXGetWindowProperty(display, win, atoms[ATOM_MOTIF_WM_HINTS],
-                                0L, 20L, False, atoms[ATOM_MOTIF_WM_HINTS],
-                                &type, &format, &itemCount, &bytesLeft, &data);
+   status = GetWindowProperty(win, atoms[ATOM_MOTIF_WM_HINTS],
+                              0L, 20L, atoms[ATOM_MOTIF_WM_HINTS],
+                              &type, &format, &itemCount, &bytesLeft, &data);
    if(status != Success || type == 0) {
       return;
    }
@@ -1111,9 +1251,9 @@ char GetCardinalAtom(Window window, AtomType atom, unsigned long *value)
    Assert(value);
 
    count = 0;
-   status = JXGetWindowProperty(display, window, atoms[atom], 0, 1, False,
-                                XA_CARDINAL, &realType, &realFormat,
-                                &count, &extra, &data);
+   status = GetWindowProperty(window, atoms[atom], 0, 1,
+                              XA_CARDINAL, &realType, &realFormat,
+                              &count, &extra, &data);
    ret = 0;
    if(status == Success && realFormat != 0 && data) {
       if(JLIKELY(count == 1)) {
@@ -1151,9 +1291,9 @@ char GetWindowAtom(Window window, AtomType atom, Window *value)
    Assert(value);
 
    count = 0;
-   status = JXGetWindowProperty(display, window, atoms[atom], 0, 1, False,
-                                XA_WINDOW, &realType, &realFormat,
-                                &count, &extra, &data);
+   status = GetWindowProperty(window, atoms[atom], 0, 1,
+                              XA_WINDOW, &realType, &realFormat,
+                              &count, &extra, &data);
    ret = 0;
    if(status == Success && realFormat != 0 && data) {
       if(JLIKELY(count == 1)) {
@@ -114,6 +114,7 @@ typedef enum {
    ATOM_JWM_RESTART,
    ATOM_JWM_EXIT,
    ATOM_JWM_RELOAD,
+   ATOM_JWM_STATS,
    ATOM_JWM_WM_STATE_MAXIMIZED_TOP,
    ATOM_JWM_WM_STATE_MAXIMIZED_BOTTOM,
    ATOM_JWM_WM_STATE_MAXIMIZED_LEFT,
@@ -125,6 +126,7 @@ typedef enum {
 extern const char jwmRestart[];
 extern const char jwmExit[];
 extern const char jwmReload[];
+extern const char jwmStats[];
 extern const char managerProperty[];
 
 #define FIRST_NET_ATOM ATOM_NET_SUPPORTED
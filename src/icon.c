@@ -18,6 +18,10 @@
 #include "color.h"
 #include "settings.h"
 #include "border.h"
+#include "decode.h"
+#include "event.h"
+#include "upload.h"
+#include "drawpool.h"
 
 IconNode emptyIcon;
 
@@ -25,6 +29,9 @@ IconNode emptyIcon;
 /* Must be a power of two. */
 #define HASH_SIZE 128
 
+/** Memory for scaled icons besides a screen sized image in bytes. */
+#define ICON_CACHE_BASE (16384UL * 1024)
+
 /** Linked list of icon paths. */
 typedef struct IconPathNode {
    char *path;
@@ -59,6 +66,12 @@ static GC iconGC;
 static char iconSizeSet = 0;
 static char *defaultIconName;
 
+/* Scaled icons in least recently used order for all icons. */
+static ScaledIconNode *newestScaledIcon;
+static ScaledIconNode *oldestScaledIcon;
+static unsigned long scaledIconBytes;
+static unsigned scaledIconCount;
+
 static void DoDestroyIcon(int index, IconNode *icon);
 static IconNode *ReadNetWMIcon(Window win);
 static IconNode *ReadWMHintIcon(Window win);
@@ -68,10 +81,24 @@ static IconNode *CreateIconFromBinary(const unsigned long *data,
                                       unsigned int length);
 static IconNode *LoadNamedIconHelper(const char *name, const char *path,
                                      char save, char preserveAspect);
+static IconNode *CreateIconFromFile(const char *fileName,
+                                    char preserveAspect);
 
 static ImageNode *GetBestImage(IconNode *icon, int rwidth, int rheight);
 static ScaledIconNode *GetScaledIcon(IconNode *icon, long fg,
                                      int rwidth, int rheight);
+static ScaledIconNode *CreateScaledIcon(IconNode *icon, long fg,
+                                        int width, int height);
+static void FillScaledIcon(IconNode *icon, ScaledIconNode *np,
+                           ImageNode *imageNode);
+static void HandleDecodedIcon(void *data, int rwidth, int rheight,
+                              ImageNode *image);
+static void FillDefaultIcon(IconNode *icon, ScaledIconNode *np);
+static void TouchScaledIcon(ScaledIconNode *np);
+static void ChargeScaledIcon(ScaledIconNode *np);
+static void EvictScaledIcons(const ScaledIconNode *keep);
+static unsigned long GetIconCacheBudget(void);
+static void DestroyScaledIcon(ScaledIconNode *np);
 
 static void InsertIcon(IconNode *icon);
 static IconNode *FindIcon(const char *name);
@@ -92,6 +119,10 @@ void InitializeIcons(void)
    memset(&emptyIcon, 0, sizeof(emptyIcon));
    iconSizeSet = 0;
    defaultIconName = NULL;
+   newestScaledIcon = NULL;
+   oldestScaledIcon = NULL;
+   scaledIconBytes = 0;
+   scaledIconCount = 0;
 }
 
 /** Startup icon support. */
@@ -117,6 +148,8 @@ void StartupIcons(void)
 void ShutdownIcons(void)
 {
    unsigned int x;
+   Debug("icon cache: %u scaled icons, %lu bytes",
+         scaledIconCount, scaledIconBytes);
    for(x = 0; x < HASH_SIZE; x++) {
       while(iconHash[x]) {
          DoDestroyIcon(x, iconHash[x]);
@@ -300,15 +333,11 @@ IconNode *LoadNamedIcon(const char *name, char save, char preserveAspect)
 
    /* Check for an absolute file name. */
    if(name[0] == '/') {
-      ImageNode *image = LoadImage(name, 0, 0, 1);
-      if(image) {
-         icon = CreateIcon(image);
-         icon->preserveAspect = preserveAspect;
-         icon->name = CopyString(name);
+      icon = CreateIconFromFile(name, preserveAspect);
+      if(icon) {
          if(save) {
             InsertIcon(icon);
          }
-         DestroyImage(image);
          return icon;
       } else {
          return &emptyIcon;
@@ -331,7 +360,7 @@ IconNode *LoadNamedIcon(const char *name, char save, char preserveAspect)
 IconNode *LoadNamedIconHelper(const char *name, const char *path,
                               char save, char preserveAspect)
 {
-   ImageNode *image;
+   IconNode *result;
    char *temp;
    const unsigned nameLength = strlen(name);
    const unsigned pathLength = strlen(path);
@@ -360,34 +389,53 @@ IconNode *LoadNamedIconHelper(const char *name, const char *path,
    }
 
    /* Attempt to load the image. */
-   image = NULL;
+   result = NULL;
    if(hasExtension) {
-      image = LoadImage(temp, 0, 0, 1);
+      result = CreateIconFromFile(temp, preserveAspect);
    } else {
       for(i = 0; i < EXTENSION_COUNT; i++) {
          const unsigned len = strlen(ICON_EXTENSIONS[i]);
          memcpy(&temp[pathLength + nameLength], ICON_EXTENSIONS[i], len + 1);
-         image = LoadImage(temp, 0, 0, 1);
-         if(image) {
+         result = CreateIconFromFile(temp, preserveAspect);
+         if(result) {
             break;
          }
       }
    }
    ReleaseStack(temp);
 
-   /* Create the icon if we were able to load the image. */
-   if(image) {
-      IconNode *result = CreateIcon(image);
-      result->preserveAspect = preserveAspect;
-      result->name = CopyString(temp);
-      if(save) {
-         InsertIcon(result);
+   if(result && save) {
+      InsertIcon(result);
+   }
+   return result;
+}
+
+/** Create an icon for an image file.
+ * The image data is not kept; it is loaded again for each size that
+ * is needed.  If possible, only the header is read here.
+ */
+IconNode *CreateIconFromFile(const char *fileName, char preserveAspect)
+{
+   IconNode *result;
+   ImageNode info;
+
+   if(GetImageSize(fileName, &info.width, &info.height)) {
+      info.bitmap = 0;
+#ifdef USE_XRENDER
+      info.render = haveRender;
+#endif
+      result = CreateIcon(&info);
+   } else {
+      ImageNode *image = LoadImage(fileName, 0, 0, 1);
+      if(!image) {
+         return NULL;
       }
+      result = CreateIcon(image);
       DestroyImage(image);
-      return result;
    }
-
-   return NULL;
+   result->preserveAspect = preserveAspect;
+   result->name = CopyString(fileName);
+   return result;
 }
 
 /** Read the icon property from a client. */
@@ -496,6 +544,15 @@ IconNode *GetDefaultIcon(void)
    return result;
 }
 
+/** Create a transient icon from an image. */
+IconNode *CreateIconFromImage(ImageNode *image, char preserveAspect)
+{
+   IconNode *result = CreateIcon(image);
+   result->images = image;
+   result->preserveAspect = preserveAspect;
+   return result;
+}
+
 IconNode *CreateIconFromDrawable(Drawable d, Pixmap mask)
 {
    ImageNode *image;
@@ -516,11 +573,6 @@ ImageNode *GetBestImage(IconNode *icon, int rwidth, int rheight)
    ImageNode *best;
    ImageNode *ip;
 
-   /* If we don't have an image loaded, load one. */
-   if(icon->images == NULL) {
-      return LoadImage(icon->name, rwidth, rheight, icon->preserveAspect);
-   }
-
    /* Find the best image to use.
     * Select the smallest image to completely cover the
     * requested size.  If no image completely covers the
@@ -563,18 +615,9 @@ ScaledIconNode *GetScaledIcon(IconNode *icon, long fg,
                               int rwidth, int rheight)
 {
 
-   XColor color;
-   XImage *image;
-   XPoint *points;
    ImageNode *imageNode;
    ScaledIconNode *np;
-   GC maskGC;
-   int x, y;
-   int scalex, scaley;     /* Fixed point. */
-   int srcx, srcy;         /* Fixed point. */
    int nwidth, nheight;
-   unsigned char *data;
-   unsigned perLine;
 
    if(rwidth == 0) {
       rwidth = icon->width;
@@ -598,62 +641,117 @@ ScaledIconNode *GetScaledIcon(IconNode *icon, long fg,
    /* Check if this size already exists. */
    for(np = icon->nodes; np; np = np->next) {
       if(!icon->bitmap || np->fg == fg) {
-#ifdef USE_XRENDER
-         /* If we are using xrender and only have one image size
-          * available, we can simply scale the existing icon. */
-         if(icon->render) {
-            if(icon->images == NULL || icon->images->next == NULL) {
-               return np;
-            }
-         }
-#endif
          if(np->width == nwidth && np->height == nheight) {
+            TouchScaledIcon(np);
             return np;
          }
       }
    }
 
+   /* Icons loaded from files are decoded in the background if possible.
+    * Until the image arrives, the node is an empty placeholder. */
+   if(icon->images == NULL) {
+      np = CreateScaledIcon(icon, fg, nwidth, nheight);
+      np->pending = RequestImage(icon->name, nwidth, nheight,
+                                 icon->preserveAspect,
+                                 HandleDecodedIcon, icon);
+      if(!np->pending) {
+         imageNode = LoadImage(icon->name, nwidth, nheight,
+                               icon->preserveAspect);
+         if(JLIKELY(imageNode)) {
+            FillScaledIcon(icon, np, imageNode);
+            DestroyImage(imageNode);
+         } else {
+            FillDefaultIcon(icon, np);
+         }
+      }
+      return np;
+   }
+
    /* Need to load the image. */
    imageNode = GetBestImage(icon, nwidth, nheight);
    if(JUNLIKELY(!imageNode)) {
       return NULL;
    }
 
+   np = CreateScaledIcon(icon, fg, nwidth, nheight);
+   FillScaledIcon(icon, np, imageNode);
+   return np;
+
+}
+
+/** Create an empty scaled icon node. */
+ScaledIconNode *CreateScaledIcon(IconNode *icon, long fg,
+                                 int width, int height)
+{
+   ScaledIconNode *np = Allocate(sizeof(ScaledIconNode));
+   np->fg = fg;
+   np->width = width;
+   np->height = height;
+   np->image = None;
+   np->mask = None;
+   np->pending = 0;
+   np->bytes = 0;
+   np->icon = icon;
+   np->next = icon->nodes;
+   icon->nodes = np;
+
+   /* Insert as the most recently used. */
+   np->older = newestScaledIcon;
+   np->newer = NULL;
+   if(newestScaledIcon) {
+      newestScaledIcon->newer = np;
+   } else {
+      oldestScaledIcon = np;
+   }
+   newestScaledIcon = np;
+   scaledIconCount += 1;
+
+   return np;
+}
+
+/** Render image data to a scaled icon node. */
+void FillScaledIcon(IconNode *icon, ScaledIconNode *np,
+                    ImageNode *imageNode)
+{
+
+   XColor color;
+   XImage *image;
+   XPoint *points;
+   GC maskGC;
+   int x, y;
+   int scalex, scaley;     /* Fixed point. */
+   int srcx, srcy;         /* Fixed point. */
+   int nwidth, nheight;
+   unsigned char *data;
+   unsigned perLine;
+
    /* See if we can use XRender to create the icon. */
 #ifdef USE_XRENDER
    if(icon->render) {
-      np = CreateScaledRenderIcon(imageNode, fg);
-      np->next = icon->nodes;
-      icon->nodes = np;
-
-      /* Don't keep the image data around after creating the icon. */
-      if(icon->images == NULL) {
-         DestroyImage(imageNode);
-      }
-
-      return np;
+      ScaledIconNode *rp = CreateScaledRenderIcon(imageNode, np->fg,
+                                                  np->width, np->height);
+      np->image = rp->image;
+      np->mask = rp->mask;
+      Release(rp);
+      ChargeScaledIcon(np);
+      return;
    }
 #endif
 
-   /* Create a new ScaledIconNode the old-fashioned way. */
-   np = Allocate(sizeof(ScaledIconNode));
-   np->fg = fg;
-   np->width = nwidth;
-   np->height = nheight;
-   np->next = icon->nodes;
-   icon->nodes = np;
+   /* Create the icon the old-fashioned way. */
+   nwidth = np->width;
+   nheight = np->height;
 
    /* Create a mask. */
    np->mask = JXCreatePixmap(display, rootWindow, nwidth, nheight, 1);
-   maskGC = JXCreateGC(display, np->mask, 0, NULL);
+   maskGC = GetPoolGC(np->mask, 1);
    JXSetForeground(display, maskGC, 0);
    JXFillRectangle(display, np->mask, maskGC, 0, 0, nwidth, nheight);
    JXSetForeground(display, maskGC, 1);
 
    /* Create a temporary XImage for scaling. */
-   image = JXCreateImage(display, rootVisual, rootDepth,
-                         ZPixmap, 0, NULL, nwidth, nheight, 8, 0);
-   image->data = Allocate(sizeof(unsigned long) * nwidth * nheight);
+   image = CreateUploadImage(rootDepth, nwidth, nheight);
 
    /* Determine the scale factor. */
    scalex = (imageNode->width << 16) / nwidth;
@@ -679,7 +777,7 @@ ScaledIconNode *GetScaledIcon(IconNode *icon, long fg,
             if(data[offset] & mask) {
                points[pindex].x = x;
                points[pindex].y = y;
-               XPutPixel(image, x, y, fg);
+               XPutPixel(image, x, y, np->fg);
                pindex += 1;
             }
          } else {
@@ -707,25 +805,209 @@ ScaledIconNode *GetScaledIcon(IconNode *icon, long fg,
    Release(points);
 
    /* Release the mask GC. */
-   JXFreeGC(display, maskGC);
+   ReleasePoolGC(maskGC);
  
    /* Create the color data pixmap. */
    np->image = JXCreatePixmap(display, rootWindow, nwidth, nheight,
                               rootDepth);
 
    /* Render the image to the color data pixmap. */
-   JXPutImage(display, np->image, rootGC, image, 0, 0, 0, 0, nwidth, nheight);   
-   /* Release the XImage. */
-   Release(image->data);
-   image->data = NULL;
-   JXDestroyImage(image);
+   UploadImage(np->image, rootGC, image);
 
-   if(icon->images == NULL) {
-      DestroyImage(imageNode);
+   ChargeScaledIcon(np);
+
+}
+
+/** Mark a scaled icon as the most recently used. */
+void TouchScaledIcon(ScaledIconNode *np)
+{
+   if(np == newestScaledIcon) {
+      return;
    }
 
-   return np;
+   /* Remove the node (it is not the newest, so it has a newer node). */
+   np->newer->older = np->older;
+   if(np->older) {
+      np->older->newer = np->newer;
+   } else {
+      oldestScaledIcon = np->newer;
+   }
+
+   /* Insert it at the front. */
+   np->older = newestScaledIcon;
+   np->newer = NULL;
+   newestScaledIcon->newer = np;
+   newestScaledIcon = np;
+}
+
+/** Account for the server memory used by a scaled icon.
+ * This is called once the X resources for the node exist.
+ * Less recently used icons are released to stay within the budget.
+ */
+void ChargeScaledIcon(ScaledIconNode *np)
+{
+   const unsigned long pixels = (unsigned long)np->width * np->height;
+   const unsigned pixelBytes = rootDepth > 16 ? 4 : (rootDepth > 8 ? 2 : 1);
+   unsigned long bytes;
+#ifdef USE_XRENDER
+   if(np->icon->render) {
+      bytes = pixels * 4;           /* ARGB picture. */
+   } else {
+      bytes = pixels * pixelBytes + (pixels + 7) / 8;
+   }
+#else
+   bytes = pixels * pixelBytes + (pixels + 7) / 8;
+#endif
+
+   /* An icon larger than the whole budget would flush everything else,
+    * so it is not charged.  It is released with its icon. */
+   if(bytes > GetIconCacheBudget()) {
+      Debug("icon cache: not charging %dx%d icon (%lu bytes)",
+            np->width, np->height, bytes);
+      bytes = 0;
+   }
+
+   scaledIconBytes -= np->bytes;
+   np->bytes = bytes;
+   scaledIconBytes += bytes;
+   EvictScaledIcons(np);
+}
+
+/** Release the least recently used scaled icons until the cache
+ * is within its budget.
+ * @param keep A node that must not be released.
+ */
+void EvictScaledIcons(const ScaledIconNode *keep)
+{
+   const unsigned long budget = GetIconCacheBudget();
+   ScaledIconNode *np = oldestScaledIcon;
+   while(scaledIconBytes > budget && np && np != keep) {
+      ScaledIconNode *newer = np->newer;
+      ScaledIconNode **pp;
+
+      /* Nodes waiting for a decoded image use no server memory. */
+      if(!np->pending) {
+         for(pp = &np->icon->nodes; *pp != np; pp = &(*pp)->next);
+         *pp = np->next;
+         Debug("icon cache: releasing %dx%d icon (%u bytes)",
+               np->width, np->height, np->bytes);
+         DestroyScaledIcon(np);
+      }
+      np = newer;
+   }
+}
 
+/** Release a scaled icon and its X resources.
+ * The node must already be removed from the icon's node list.
+ */
+void DestroyScaledIcon(ScaledIconNode *np)
+{
+#ifdef USE_XRENDER
+   if(np->icon->render) {
+      if(np->image != None) {
+         JXRenderFreePicture(display, np->image);
+      }
+      if(np->mask != None) {
+         JXRenderFreePicture(display, np->mask);
+      }
+#else
+   if(0) {
+#endif
+   } else {
+      if(np->image != None) {
+         JXFreePixmap(display, np->image);
+      }
+      if(np->mask != None) {
+         JXFreePixmap(display, np->mask);
+      }
+   }
+
+   if(np->newer) {
+      np->newer->older = np->older;
+   } else {
+      newestScaledIcon = np->older;
+   }
+   if(np->older) {
+      np->older->newer = np->newer;
+   } else {
+      oldestScaledIcon = np->newer;
+   }
+   scaledIconBytes -= np->bytes;
+   scaledIconCount -= 1;
+
+   Release(np);
+}
+
+/** Get the occupancy of the scaled icon cache. */
+void GetIconCacheUsage(unsigned *entries, unsigned long *bytes,
+                       unsigned long *limit)
+{
+   *entries = scaledIconCount;
+   *bytes = scaledIconBytes;
+   *limit = GetIconCacheBudget();
+}
+
+/** Get the memory budget for scaled icons in bytes.
+ * Unless configured, this leaves room for a screen sized image
+ * (such as a scaled background) on top of the icons themselves.
+ */
+unsigned long GetIconCacheBudget(void)
+{
+   if(settings.iconCacheSize > 0) {
+      return (unsigned long)settings.iconCacheSize * 1024;
+   }
+   return ICON_CACHE_BASE + (unsigned long)rootWidth * rootHeight * 4;
+}
+
+/** Finish a scaled icon once its image has been decoded. */
+void HandleDecodedIcon(void *data, int rwidth, int rheight, ImageNode *image)
+{
+   IconNode *icon = (IconNode*)data;
+   ScaledIconNode *np;
+
+   for(np = icon->nodes; np; np = np->next) {
+      if(np->pending && np->width == rwidth && np->height == rheight) {
+         break;
+      }
+   }
+   if(JLIKELY(np)) {
+      np->pending = 0;
+      if(image) {
+         FillScaledIcon(icon, np, image);
+      } else {
+         FillDefaultIcon(icon, np);
+      }
+      RequireIconUpdate();
+   }
+   DestroyImage(image);
+}
+
+/** Fill a scaled icon whose image could not be decoded.
+ * The image of the default icon is used in its place.  It is rendered
+ * the way the owning icon is, since the node belongs to that icon.
+ */
+void FillDefaultIcon(IconNode *icon, ScaledIconNode *np)
+{
+   IconNode *def = GetDefaultIcon();
+   ImageNode *image;
+
+   if(def == icon || def == &emptyIcon) {
+      return;
+   }
+   if(def->images) {
+      image = GetBestImage(def, np->width, np->height);
+      if(image) {
+         FillScaledIcon(icon, np, image);
+      }
+   } else if(def->name) {
+      /* Decoding is rare here, so do it now. */
+      image = LoadImage(def->name, np->width, np->height,
+                        def->preserveAspect);
+      if(image) {
+         FillScaledIcon(icon, np, image);
+         DestroyImage(image);
+      }
+   }
 }
 
 /** Create an icon from binary data (as specified via window properties). */
@@ -806,42 +1088,27 @@ IconNode *CreateIcon(const ImageNode *image)
 void DoDestroyIcon(int index, IconNode *icon)
 {
    if(icon && icon != &emptyIcon) {
+      CancelImageRequests(HandleDecodedIcon, icon);
       while(icon->nodes) {
          ScaledIconNode *np = icon->nodes;
-#ifdef USE_XRENDER
-         if(icon->render) {
-            if(np->image != None) {
-               JXRenderFreePicture(display, np->image);
-            }
-            if(np->mask != None) {
-               JXRenderFreePicture(display, np->mask);
-            }
-#else
-         if(0) {
-#endif
-         } else {
-            if(np->image != None) {
-               JXFreePixmap(display, np->image);
-            }
-            if(np->mask != None) {
-               JXFreePixmap(display, np->mask);
-            }
-         }
          icon->nodes = np->next;
-         Release(np);
+         DestroyScaledIcon(np);
       }
       DestroyImage(icon->images);
       if(icon->name) {
          Release(icon->name);
       }
 
-      if(icon->prev) {
-         icon->prev->next = icon->next;
-      } else {
-         iconHash[index] = icon->next;
-      }
-      if(icon->next) {
-         icon->next->prev = icon->prev;
+      /* Transient icons are not in the hash. */
+      if(!icon->transient) {
+         if(icon->prev) {
+            icon->prev->next = icon->next;
+         } else {
+            iconHash[index] = icon->next;
+         }
+         if(icon->next) {
+            icon->next->prev = icon->prev;
+         }
       }
       Release(icon);
    }
@@ -22,6 +22,12 @@ typedef struct ScaledIconNode {
    XID image;
    XID mask;
 
+   char pending;  /**< Set while the image is being decoded. */
+   unsigned bytes;  /**< Estimated server memory used by this node. */
+
+   struct IconNode *icon;          /**< The icon owning this node. */
+   struct ScaledIconNode *newer;   /**< Next more recently used node. */
+   struct ScaledIconNode *older;   /**< Next less recently used node. */
    struct ScaledIconNode *next;
 
 } ScaledIconNode;
@@ -90,6 +96,13 @@ void LoadIcon(struct ClientNode *np);
  */
 IconNode *LoadNamedIcon(const char *name, char save, char preserveAspect);
 
+/** Create a transient icon from an image.
+ * @param image The image to use (owned by the icon).
+ * @param preserveAspect Set to preserve the aspect ratio when scaling.
+ * @return The icon (release with DestroyIcon).
+ */
+IconNode *CreateIconFromImage(struct ImageNode *image, char preserveAspect);
+
 /** Load the default icon.
  * @return The default icon.
  */
@@ -103,6 +116,14 @@ void DestroyIcon(IconNode *icon);
 /** Set the default icon. */
 void SetDefaultIcon(const char *name);
 
+/** Get the occupancy of the scaled icon cache.
+ * @param entries Location to store the number of scaled icons.
+ * @param bytes Location to store the estimated server memory used.
+ * @param limit Location to store the budget in bytes.
+ */
+void GetIconCacheUsage(unsigned *entries, unsigned long *bytes,
+                       unsigned long *limit);
+
 #else
 
 #define ICON_DUMMY_FUNCTION ((void)0)
@@ -118,6 +139,8 @@ void SetDefaultIcon(const char *name);
 #define LoadNamedIcon( a, b, c )           NULL
 #define DestroyIcon( a )                   ICON_DUMMY_FUNCTION
 #define SetDefaultIcon( a )                ICON_DUMMY_FUNCTION
+#define GetIconCacheUsage( a, b, c ) \
+   (void)(*(a) = 0, *(b) = 0, *(c) = 0)
 
 #endif /* ICON_H */
 
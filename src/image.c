@@ -42,12 +42,43 @@
 #include "nanosvgrastFLTK.h"
 
 #include <stdint.h> //for uint32_t
+
+#ifdef USE_THREADS
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+/** SVG images with at least this many pixels are rasterized in bands. */
+#define SVG_BAND_MIN_PIXELS   (256 * 256)
+
+/** Maximum number of bands used to rasterize an SVG image. */
+#define SVG_MAX_BANDS         4
+
+/** Bytes read from the start of an SVG file to find its size. */
+#define SVG_HEADER_SIZE       16384
+
+/** Rows of an SVG image to be rasterized. */
+typedef struct SVGBand {
+   NSVGimage *image;
+   float xscale, yscale;
+   unsigned char *data;
+   int width, height;
+   int y0, y1;
+} SVGBand;
 typedef ImageNode *(*ImageLoader)(const char *fileName,
                                   int rwidth, int rheight,
                                   char preserveAspect);
+typedef char (*ImageSizer)(const char *fileName, int *width, int *height);
 
 static ImageNode *LoadNSVGImage(const char *fileName, int rwidth, int rheight,
                                char preserveAspect);
+static char GetNSVGImageSize(const char *fileName, int *width, int *height);
+static const char *FindSVGRoot(const char *data);
+static const char *ParseSVGNumber(const char *str, float *value);
+static float ParseSVGLength(const char *str);
+static void RasterizeNSVGImage(NSVGimage *image, float xscale, float yscale,
+                               unsigned char *data, int width, int height);
+static void *RasterizeNSVGBand(void *arg);
 
 /* include stb_image.h */
 #define STB_IMAGE_IMPLEMENTATION
@@ -60,6 +91,7 @@ static ImageNode *LoadNSVGImage(const char *fileName, int rwidth, int rheight,
 
 static ImageNode *LoadSTBImage(const char *fileName, int rwidth, int rheight,
                                char preserveAspect);
+static char GetSTBImageSize(const char *fileName, int *width, int *height);
 
 static ImageNode *LoadXPMImage(const char *fileName, int rwidth, int rheight,
                                char preserveAspect);
@@ -69,19 +101,25 @@ static ImageNode *LoadXBMImage(const char *fileName, int rwidth, int rheight,
 #endif
 
 static ImageNode *CreateImageFromXImages(XImage *image, XImage *shape);
+static int FindImageLoader(const char *fileName);
+static ImageNode *DoLoadImage(const char *fileName, int rwidth, int rheight,
+                              char preserveAspect, char async);
 
-/* File extension to image loader mapping. */
+/* File extension to image loader mapping.
+ * Loaders with a size function do not use the X connection,
+ * so they may also be run from a worker thread. */
 static const struct {
    const char *extension;
    ImageLoader loader;
+   ImageSizer sizer;
 } IMAGE_LOADERS[] = {
-   {".svg",       LoadNSVGImage      },
-   {".png",       LoadSTBImage      },
-   {".jpg",       LoadSTBImage     },
-   {".jpeg",      LoadSTBImage     },
-   {".xpm",       LoadXPMImage      },
+   {".svg",       LoadNSVGImage,    GetNSVGImageSize  },
+   {".png",       LoadSTBImage,     GetSTBImageSize   },
+   {".jpg",       LoadSTBImage,     GetSTBImageSize   },
+   {".jpeg",      LoadSTBImage,     GetSTBImageSize   },
+   {".xpm",       LoadXPMImage,     NULL              },
 #ifdef USE_XBM
-   {".xbm",       LoadXBMImage      },
+   {".xbm",       LoadXBMImage,     NULL              },
 #endif
 };
 static const unsigned IMAGE_LOADER_COUNT = ARRAY_LENGTH(IMAGE_LOADERS);
@@ -89,9 +127,69 @@ static const unsigned IMAGE_LOADER_COUNT = ARRAY_LENGTH(IMAGE_LOADERS);
 /** Load an image from the specified file. */
 ImageNode *LoadImage(const char *fileName, int rwidth, int rheight,
                      char preserveAspect)
+{
+   return DoLoadImage(fileName, rwidth, rheight, preserveAspect, 0);
+}
+
+/** Load an image without using the X connection. */
+ImageNode *LoadImageAsync(const char *fileName, int rwidth, int rheight,
+                          char preserveAspect)
+{
+   return DoLoadImage(fileName, rwidth, rheight, preserveAspect, 1);
+}
+
+/** Determine if an image can be loaded without using the X connection. */
+char CanLoadImageAsync(const char *fileName)
+{
+   const int i = FindImageLoader(fileName);
+   return i >= 0 && IMAGE_LOADERS[i].sizer != NULL;
+}
+
+/** Get the size of an image without decoding it. */
+char GetImageSize(const char *fileName, int *width, int *height)
+{
+   const int i = FindImageLoader(fileName);
+   if(i < 0 || IMAGE_LOADERS[i].sizer == NULL) {
+      return 0;
+   }
+   if(access(fileName, R_OK) < 0) {
+      return 0;
+   }
+   return (IMAGE_LOADERS[i].sizer)(fileName, width, height);
+}
+
+/** Find the loader for a file name based on its extension.
+ * @return The index of the loader (-1 if not found).
+ */
+int FindImageLoader(const char *fileName)
+{
+   unsigned i;
+   unsigned name_length;
+   if(!fileName) {
+      return -1;
+   }
+   name_length = strlen(fileName);
+   for(i = 0; i < IMAGE_LOADER_COUNT; i++) {
+      const char *ext = IMAGE_LOADERS[i].extension;
+      const unsigned ext_length = strlen(ext);
+      if(JLIKELY(name_length >= ext_length)) {
+         const unsigned offset = name_length - ext_length;
+         if(!StrCmpNoCase(&fileName[offset], ext)) {
+            return i;
+         }
+      }
+   }
+   return -1;
+}
+
+/** Load an image, optionally restricted to loaders that
+ * do not use the X connection. */
+ImageNode *DoLoadImage(const char *fileName, int rwidth, int rheight,
+                       char preserveAspect, char async)
 {
    unsigned i;
    unsigned name_length;
+   int index;
    ImageNode *result = NULL;
 
    /* Make sure we have a reasonable file name. */
@@ -110,25 +208,21 @@ ImageNode *LoadImage(const char *fileName, int rwidth, int rheight,
 
    /* First we attempt to use the extension to determine the type
     * to avoid trying all loaders. */
-   for(i = 0; i < IMAGE_LOADER_COUNT; i++) {
-      const char *ext = IMAGE_LOADERS[i].extension;
-      const unsigned ext_length = strlen(ext);
-      if(JLIKELY(name_length >= ext_length)) {
-         const unsigned offset = name_length - ext_length;
-         if(!StrCmpNoCase(&fileName[offset], ext)) {
-            const ImageLoader loader = IMAGE_LOADERS[i].loader;
-            result = (loader)(fileName, rwidth, rheight, preserveAspect);
-            if(JLIKELY(result)) {
-               return result;
-            }
-            break;
-         }
+   index = FindImageLoader(fileName);
+   if(index >= 0 && (!async || IMAGE_LOADERS[index].sizer != NULL)) {
+      const ImageLoader loader = IMAGE_LOADERS[index].loader;
+      result = (loader)(fileName, rwidth, rheight, preserveAspect);
+      if(JLIKELY(result)) {
+         return result;
       }
    }
 
    /* We were unable to load by extension, so try everything. */
    for(i = 0; i < IMAGE_LOADER_COUNT; i++) {
       const ImageLoader loader = IMAGE_LOADERS[i].loader;
+      if(async && IMAGE_LOADERS[i].sizer == NULL) {
+         continue;
+      }
       result = (loader)(fileName, rwidth, rheight, preserveAspect);
       if(result) {
          /* We were able to load the image, so it must have either the
@@ -228,6 +322,269 @@ static ImageNode *LoadSTBImage(const char *fileName, int rwidth, int rheight,
 }
 
 
+/** Get the size of a (PNG, JPEG) image from its header.
+ * The bundled stb_image.h does not include stbi_info, so the
+ * headers are read here. */
+static char GetSTBImageSize(const char *fileName, int *width, int *height)
+{
+   unsigned char header[24];
+   FILE *fd;
+   char result = 0;
+
+   fd = fopen(fileName, "rb");
+   if(!fd) {
+      return 0;
+   }
+   if(fread(header, 1, sizeof(header), fd) != sizeof(header)) {
+      fclose(fd);
+      return 0;
+   }
+
+   if(!memcmp(header, "\x89PNG\r\n\x1a\n", 8)
+      && !memcmp(&header[12], "IHDR", 4)) {
+
+      /* PNG: the size is the start of the IHDR chunk. */
+      *width = (header[16] << 24) | (header[17] << 16)
+             | (header[18] << 8) | header[19];
+      *height = (header[20] << 24) | (header[21] << 16)
+              | (header[22] << 8) | header[23];
+      result = 1;
+
+   } else if(header[0] == 0xFF && header[1] == 0xD8) {
+
+      /* JPEG: walk the markers until we find a start of frame. */
+      int c;
+      fseek(fd, 2, SEEK_SET);
+      for(;;) {
+         unsigned char segment[7];
+         unsigned length;
+         do {
+            c = fgetc(fd);
+         } while(c == 0xFF);
+         if(c == EOF || c == 0xD9 || c == 0xDA) {
+            break;
+         }
+         if(fread(segment, 1, 2, fd) != 2) {
+            break;
+         }
+         length = (segment[0] << 8) | segment[1];
+         if(length < 2) {
+            break;
+         }
+         if(c >= 0xC0 && c <= 0xCF && c != 0xC4 && c != 0xC8 && c != 0xCC) {
+            if(fread(segment, 1, 5, fd) != 5) {
+               break;
+            }
+            *height = (segment[1] << 8) | segment[2];
+            *width = (segment[3] << 8) | segment[4];
+            result = 1;
+            break;
+         }
+         if(fseek(fd, length - 2, SEEK_CUR) < 0) {
+            break;
+         }
+      }
+
+   }
+
+   fclose(fd);
+   return result && *width > 0 && *height > 0;
+}
+
+/** Get the natural size of an SVG image without parsing it.
+ * Only the attributes of the root element are read.  This gives the
+ * size nanosvg uses unless the image has neither a size nor a view box,
+ * in which case the caller has to load the image.
+ */
+static char GetNSVGImageSize(const char *fileName, int *width, int *height)
+{
+   char *data;
+   const char *attr;
+   float w = 0.0f;
+   float h = 0.0f;
+   float box[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+   size_t len;
+   FILE *fd;
+
+   fd = fopen(fileName, "rb");
+   if(!fd) {
+      return 0;
+   }
+   data = Allocate(SVG_HEADER_SIZE + 1);
+   len = fread(data, 1, SVG_HEADER_SIZE, fd);
+   fclose(fd);
+   data[len] = 0;
+
+   attr = FindSVGRoot(data);
+   while(attr) {
+      const char *name;
+      const char *value;
+      const char *end;
+      size_t nameLength;
+      char quote;
+
+      while(isspace((unsigned char)*attr)) {
+         attr += 1;
+      }
+      name = attr;
+      while(*attr && *attr != '=' && *attr != '>' && *attr != '/'
+            && !isspace((unsigned char)*attr)) {
+         attr += 1;
+      }
+      nameLength = attr - name;
+      while(isspace((unsigned char)*attr)) {
+         attr += 1;
+      }
+      if(nameLength == 0 || *attr != '=') {
+         break;
+      }
+      attr += 1;
+      while(isspace((unsigned char)*attr)) {
+         attr += 1;
+      }
+      quote = *attr;
+      if(quote != '"' && quote != '\'') {
+         break;
+      }
+      value = attr + 1;
+      end = strchr(value, quote);
+      if(!end) {
+         break;
+      }
+
+      if(nameLength == 5 && !strncmp(name, "width", 5)) {
+         w = ParseSVGLength(value);
+      } else if(nameLength == 6 && !strncmp(name, "height", 6)) {
+         h = ParseSVGLength(value);
+      } else if(nameLength == 7 && !strncmp(name, "viewBox", 7)) {
+         unsigned i;
+         for(i = 0; i < 4 && value; i++) {
+            while(isspace((unsigned char)*value) || *value == ',') {
+               value += 1;
+            }
+            value = ParseSVGNumber(value, &box[i]);
+         }
+      }
+      attr = end + 1;
+   }
+   Release(data);
+
+   /* Like nanosvg, use the view box if the size is not given. */
+   *width = (int)(w > 0.0f ? w : box[2]);
+   *height = (int)(h > 0.0f ? h : box[3]);
+   return *width > 0 && *height > 0;
+}
+
+/** Find the attributes of the root element of an SVG image.
+ * @param data The start of the file.
+ * @return The text following the element name, or NULL if the
+ *         root element is not an svg element.
+ */
+static const char *FindSVGRoot(const char *data)
+{
+   const char *p = data;
+   while(p && (p = strchr(p, '<')) != NULL) {
+      if(!strncmp(p, "<!--", 4)) {
+         p = strstr(p + 4, "-->");
+      } else if(p[1] == '?' || p[1] == '!') {
+         p = strchr(p + 1, '>');
+      } else if(!strncmp(p + 1, "svg", 3)
+                && (isspace((unsigned char)p[4])
+                    || p[4] == '>' || p[4] == '/')) {
+         return p + 4;
+      } else {
+         return NULL;
+      }
+   }
+   return NULL;
+}
+
+/** Parse a number in an SVG attribute.
+ * @param str The text to parse.
+ * @param value The value to set.
+ * @return The text following the number, or NULL if there is none.
+ */
+static const char *ParseSVGNumber(const char *str, float *value)
+{
+   double result = 0.0;
+   double sign = 1.0;
+   char digits = 0;
+
+   if(*str == '+' || *str == '-') {
+      sign = *str == '-' ? -1.0 : 1.0;
+      str += 1;
+   }
+   while(isdigit((unsigned char)*str)) {
+      result = result * 10.0 + (*str - '0');
+      digits = 1;
+      str += 1;
+   }
+   if(*str == '.') {
+      double scale = 0.1;
+      str += 1;
+      while(isdigit((unsigned char)*str)) {
+         result += (*str - '0') * scale;
+         scale *= 0.1;
+         digits = 1;
+         str += 1;
+      }
+   }
+   if(!digits) {
+      return NULL;
+   }
+
+   /* An exponent, but not the "em" and "ex" units. */
+   if((*str == 'e' || *str == 'E')
+      && (isdigit((unsigned char)str[1])
+         || ((str[1] == '+' || str[1] == '-')
+            && isdigit((unsigned char)str[2])))) {
+      const char negative = str[1] == '-';
+      int exponent = 0;
+      str += isdigit((unsigned char)str[1]) ? 1 : 2;
+      while(isdigit((unsigned char)*str)) {
+         exponent = Min(exponent * 10 + (*str - '0'), 38);
+         str += 1;
+      }
+      while(exponent > 0) {
+         result = negative ? result / 10.0 : result * 10.0;
+         exponent -= 1;
+      }
+   }
+
+   *value = (float)(sign * result);
+   return str;
+}
+
+/** Parse an SVG length and convert it to pixels at 96 DPI.
+ * Percentages and font relative units have nothing to refer to on
+ * the root element, so they yield 0 as they do in nanosvg.
+ */
+static float ParseSVGLength(const char *str)
+{
+   float value;
+   while(isspace((unsigned char)*str)) {
+      str += 1;
+   }
+   str = ParseSVGNumber(str, &value);
+   if(!str) {
+      return 0.0f;
+   }
+   if(str[0] == 'p' && str[1] == 't') {
+      return value / 72.0f * 96.0f;
+   } else if(str[0] == 'p' && str[1] == 'c') {
+      return value / 6.0f * 96.0f;
+   } else if(str[0] == 'm' && str[1] == 'm') {
+      return value / 25.4f * 96.0f;
+   } else if(str[0] == 'c' && str[1] == 'm') {
+      return value / 2.54f * 96.0f;
+   } else if(str[0] == 'i' && str[1] == 'n') {
+      return value * 96.0f;
+   } else if(str[0] == '%' || str[0] == 'e') {
+      return 0.0f;
+   }
+   return value;
+}
+
 static ImageNode *LoadNSVGImage(const char *fileName, int rwidth, int rheight,
                                 char preserveAspect)
 {
@@ -257,10 +614,8 @@ static ImageNode *LoadNSVGImage(const char *fileName, int rwidth, int rheight,
 
        result = CreateImage(rwidth,rheight,0);
 
-       NSVGrasterizer *rast = nsvgCreateRasterizer();
-       nsvgRasterizeXY(rast, image, 0,0, xscale, yscale,
-                       result->data, rwidth, rheight, rwidth*4);
-       nsvgDeleteRasterizer(rast);
+       RasterizeNSVGImage(image, xscale, yscale,
+                          result->data, rwidth, rheight);
        nsvgDelete(image);
 
        if (result->data) {
@@ -273,6 +628,81 @@ static ImageNode *LoadNSVGImage(const char *fileName, int rwidth, int rheight,
   return result;
 }
 
+/** Rasterize an SVG image.
+ * Large images are split in horizontal bands which are rendered
+ * in parallel when threads are available.
+ */
+static void RasterizeNSVGImage(NSVGimage *image, float xscale, float yscale,
+                               unsigned char *data, int width, int height)
+{
+   SVGBand bands[SVG_MAX_BANDS];
+   unsigned count = 1;
+   unsigned i;
+
+#ifdef USE_THREADS
+   pthread_t threads[SVG_MAX_BANDS];
+   char started[SVG_MAX_BANDS];
+   sigset_t blocked;
+   sigset_t original;
+
+   if((long)width * height >= SVG_BAND_MIN_PIXELS) {
+      long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+      count = Max(1, Min(cpus, SVG_MAX_BANDS));
+      count = Min(count, height);
+   }
+#endif
+
+   for(i = 0; i < count; i++) {
+      bands[i].image = image;
+      bands[i].xscale = xscale;
+      bands[i].yscale = yscale;
+      bands[i].data = data;
+      bands[i].width = width;
+      bands[i].height = height;
+      bands[i].y0 = (height * i) / count;
+      bands[i].y1 = (height * (i + 1)) / count;
+   }
+
+#ifdef USE_THREADS
+   /* The first band is rendered by this thread.
+    * Bands are rendered here too if a thread cannot be started. */
+   sigfillset(&blocked);
+   pthread_sigmask(SIG_BLOCK, &blocked, &original);
+   for(i = 1; i < count; i++) {
+      started[i] = !pthread_create(&threads[i], NULL,
+                                   RasterizeNSVGBand, &bands[i]);
+   }
+   pthread_sigmask(SIG_SETMASK, &original, NULL);
+   RasterizeNSVGBand(&bands[0]);
+   for(i = 1; i < count; i++) {
+      if(started[i]) {
+         pthread_join(threads[i], NULL);
+      } else {
+         RasterizeNSVGBand(&bands[i]);
+      }
+   }
+#else
+   RasterizeNSVGBand(&bands[0]);
+#endif
+
+   nsvgUnpremultiplyAlpha(data, width, height, width * 4);
+}
+
+/** Rasterize the rows of an SVG image in a band. */
+static void *RasterizeNSVGBand(void *arg)
+{
+   SVGBand *band = (SVGBand*)arg;
+   NSVGrasterizer *rast = nsvgCreateRasterizer();
+   if(JLIKELY(rast)) {
+      nsvgRasterizeRowsXY(rast, band->image, 0, 0,
+                          band->xscale, band->yscale,
+                          band->data, band->width, band->height,
+                          band->width * 4, band->y0, band->y1);
+      nsvgDeleteRasterizer(rast);
+   }
+   return NULL;
+}
+
 /** Load an XPM image from the specified file. */
 
 /* xpixmap.c:
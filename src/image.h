@@ -34,6 +34,32 @@ typedef struct ImageNode {
 ImageNode *LoadImage(const char *fileName, int rwidth, int rheight,
                      char preserveAspect);
 
+/** Load an image without using the X connection.
+ * This is safe to call from a worker thread.
+ * @param fileName The file containing the image.
+ * @param rwidth The preferred width.
+ * @param rheight The preferred height.
+ * @param preserveAspect Set to preserve image aspect when scaling.
+ * @return A new image node (NULL if the image could not be loaded).
+ */
+ImageNode *LoadImageAsync(const char *fileName, int rwidth, int rheight,
+                          char preserveAspect);
+
+/** Determine if an image can be loaded without using the X connection.
+ * @param fileName The file containing the image.
+ * @return 1 if LoadImageAsync can load the image, 0 otherwise.
+ */
+char CanLoadImageAsync(const char *fileName);
+
+/** Get the natural size of an image without decoding it.
+ * This is only supported for images that can be loaded asynchronously.
+ * @param fileName The file containing the image.
+ * @param width Location to store the width.
+ * @param height Location to store the height.
+ * @return 1 on success, 0 if the size could not be determined.
+ */
+char GetImageSize(const char *fileName, int *width, int *height);
+
 /** Load an image from a Drawable.
  * @param pmap The drawable.
  * @param mask The mask (may be None).
@@ -79,6 +79,8 @@
 #define JXChangeWindowAttributes( a, b, c, d ) \
    JFUNC4(XChangeWindowAttributes, a, b, c, d)
 
+#define JXCheckIfEvent( a, b, c, d ) JFUNC4(XCheckIfEvent, a, b, c, d)
+
 #define JXCheckTypedEvent( a, b, c ) JFUNC3(XCheckTypedEvent, a, b, c)
 
 #define JXCheckTypedWindowEvent( a, b, c, d ) \
@@ -226,6 +228,8 @@
 
 #define JXInternAtom( a, b, c ) JFUNC3(XInternAtom, a, b, c)
 
+#define JXInternAtoms( a, b, c, d, e ) JFUNC5(XInternAtoms, a, b, c, d, e)
+
 #define JXKeysymToKeycode( a, b ) JFUNC2(XKeysymToKeycode, a, b)
 
 #define JXKillClient( a, b ) JFUNC2(XKillClient, a, b)
@@ -292,10 +296,16 @@
 
 #define JXSetErrorHandler( a ) JFUNC1(XSetErrorHandler, a)
 
+#define JXSetFillStyle( a, b, c ) JFUNC3(XSetFillStyle, a, b, c)
+
 #define JXSetFont( a, b, c ) JFUNC3(XSetFont, a, b, c)
 
 #define JXSetForeground( a, b, c ) JFUNC3(XSetForeground, a, b, c)
 
+#define JXSetTile( a, b, c ) JFUNC3(XSetTile, a, b, c)
+
+#define JXSetTSOrigin( a, b, c, d ) JFUNC4(XSetTSOrigin, a, b, c, d)
+
 #define JXGetInputFocus( a, b, c ) JFUNC3(XGetInputFocus, a, b, c)
 
 #define JXSetInputFocus( a, b, c, d ) JFUNC4(XSetInputFocus, a, b, c, d)
@@ -385,4 +395,55 @@
 #define JXRenderComposite( a, b, c, d, e, f, g, h, i, j, k, l, m ) \
    JFUNC13(XRenderComposite, a, b, c, d, e, f, g, h, i, j, k, l, m)
 
+#define JXRenderSetPictureTransform( a, b, c ) \
+   JFUNC3(XRenderSetPictureTransform, a, b, c)
+
+#define JXRenderSetPictureFilter( a, b, c, d, e ) \
+   JFUNC5(XRenderSetPictureFilter, a, b, c, d, e)
+
+#define JXRenderFillRectangle( a, b, c, d, e, f, g, h ) \
+   JFUNC8(XRenderFillRectangle, a, b, c, d, e, f, g, h)
+
+#define JXShmQueryExtension( a ) JFUNC1(XShmQueryExtension, a)
+
+#define JXShmAttach( a, b ) JFUNC2(XShmAttach, a, b)
+
+#define JXShmDetach( a, b ) JFUNC2(XShmDetach, a, b)
+
+#define JXShmCreateImage( a, b, c, d, e, f, g, h ) \
+   JFUNC8(XShmCreateImage, a, b, c, d, e, f, g, h)
+
+#define JXShmPutImage( a, b, c, d, e, f, g, h, i, j, k ) \
+   JFUNC11(XShmPutImage, a, b, c, d, e, f, g, h, i, j, k)
+
+/* XCB */
+
+#define JXGetXCBConnection( a ) JFUNC1(XGetXCBConnection, a)
+
+/* Composite and Damage */
+
+#define JXCompositeQueryExtension( a, b, c ) \
+   JFUNC3(XCompositeQueryExtension, a, b, c)
+
+#define JXCompositeQueryVersion( a, b, c ) \
+   JFUNC3(XCompositeQueryVersion, a, b, c)
+
+#define JXCompositeRedirectWindow( a, b, c ) \
+   JFUNC3(XCompositeRedirectWindow, a, b, c)
+
+#define JXCompositeUnredirectWindow( a, b, c ) \
+   JFUNC3(XCompositeUnredirectWindow, a, b, c)
+
+#define JXCompositeNameWindowPixmap( a, b ) \
+   JFUNC2(XCompositeNameWindowPixmap, a, b)
+
+#define JXDamageQueryExtension( a, b, c ) \
+   JFUNC3(XDamageQueryExtension, a, b, c)
+
+#define JXDamageCreate( a, b, c ) JFUNC3(XDamageCreate, a, b, c)
+
+#define JXDamageDestroy( a, b ) JFUNC2(XDamageDestroy, a, b)
+
+#define JXDamageSubtract( a, b, c, d ) JFUNC4(XDamageSubtract, a, b, c, d)
+
 #endif /* JXLIB_H */
@@ -21,6 +21,7 @@ static const int BLOCK_SIZE = 16;
 static const StringMappingType TOKEN_MAP[] = {
    { "Active",               TOK_ACTIVE               },
    { "Background",           TOK_BACKGROUND           },
+   { "BackgroundCacheSize",  TOK_BACKGROUNDCACHESIZE  },
    { "Button",               TOK_BUTTON               },
    { "ButtonClose",          TOK_BUTTONCLOSE          },
    { "ButtonCloseFocus",     TOK_BUTTONCLOSEFOCUS     },
@@ -49,6 +50,7 @@ static const StringMappingType TOKEN_MAP[] = {
    { "Foreground",           TOK_FOREGROUND           },
    { "Group",                TOK_GROUP                },
    { "Height",               TOK_HEIGHT               },
+   { "IconCacheSize",        TOK_ICONCACHESIZE        },
    { "IconPath",             TOK_ICONPATH             },
    { "Include",              TOK_INCLUDE              },
    { "JWM",                  TOK_JWM                  },
@@ -92,6 +94,7 @@ static const StringMappingType TOKEN_MAP[] = {
    { "Text",                 TOK_TEXT                 },
    { "Title",                TOK_TITLE                },
    { "TitleButtonOrder",     TOK_TITLEBUTTONORDER     },
+   { "TitleDelay",           TOK_TITLEDELAY           },
    { "Tray",                 TOK_TRAY                 },
    { "TrayButton",           TOK_TRAYBUTTON           },
    { "TrayButtonStyle",      TOK_TRAYBUTTONSTYLE      },
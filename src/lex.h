@@ -17,6 +17,7 @@ typedef enum {
 
    TOK_ACTIVE,
    TOK_BACKGROUND,
+   TOK_BACKGROUNDCACHESIZE,
    TOK_BUTTON,
    TOK_BUTTONCLOSE,
    TOK_BUTTONCLOSEFOCUS,
@@ -45,6 +46,7 @@ typedef enum {
    TOK_FOREGROUND,
    TOK_GROUP,
    TOK_HEIGHT,
+   TOK_ICONCACHESIZE,
    TOK_ICONPATH,
    TOK_INCLUDE,
    TOK_JWM,
@@ -88,6 +90,7 @@ typedef enum {
    TOK_TEXT,
    TOK_TITLE,
    TOK_TITLEBUTTONORDER,
+   TOK_TITLEDELAY,
    TOK_TRAY,
    TOK_TRAYBUTTON,
    TOK_TRAYBUTTONSTYLE,
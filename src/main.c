@@ -41,38 +41,12 @@
 #include "settings.h"
 #include "timing.h"
 #include "grab.h"
-
-#include <errno.h>
-
-Display *display = NULL;
-Window rootWindow;
-int rootWidth, rootHeight;
-int rootScreen;
-Colormap rootColormap;
-Visual *rootVisual;
-int rootDepth;
-GC rootGC;
-int colormapCount;
-Window supportingWindow;
-Atom managerSelection;
-
-char shouldExit = 0;
-char shouldRestart = 0;
-char isRestarting = 0;
-char initializing = 0;
-char shouldReload = 0;
-
-unsigned int currentDesktop = 0;
-unsigned int previousDesktop = 0;
-
-char *exitCommand = NULL;
-
-XContext clientContext;
-XContext frameContext;
-
-#ifdef USE_XRENDER
-char haveRender;
-#endif
+#include "decode.h"
+#include "upload.h"
+#include "gradient.h"
+#include "thumbnail.h"
+#include "drawpool.h"
+#include "reactor.h"
 
 static void Initialize(void);
 static void Startup(void);
@@ -85,18 +59,15 @@ static Bool SelectionReleased(Display *d, XEvent *e, XPointer arg);
 static void StartupConnection(void);
 static void ShutdownConnection(void);
 static void EventLoop(void);
-static void HandleExit(int sig);
-static void HandleChild(int sig);
 static void DoExit(int code);
 static void SendRestart(void);
 static void SendExit(void);
 static void SendReload(void);
+static void SendStats(void);
 static void SendJWMMessage(const char *message);
 
 static char *displayString = NULL;
 
-char *configPath = NULL;
-
 /** The main entry point. */
 #ifndef UNIT_TEST
 int main(int argc, char *argv[])
@@ -107,6 +78,7 @@ int main(int argc, char *argv[])
       COMMAND_RESTART,
       COMMAND_EXIT,
       COMMAND_RELOAD,
+      COMMAND_STATS,
       COMMAND_PARSE
    } action;
 
@@ -129,6 +101,8 @@ int main(int argc, char *argv[])
          action = COMMAND_EXIT;
       } else if(!strcmp(argv[x], "-reload")) {
          action = COMMAND_RELOAD;
+      } else if(!strcmp(argv[x], "-stats")) {
+         action = COMMAND_STATS;
       } else if(!strcmp(argv[x], "-display") && x + 1 < argc) {
          displayString = argv[++x];
       } else if(!strcmp(argv[x], "-f") && x + 1 < argc) {
@@ -157,6 +131,9 @@ int main(int argc, char *argv[])
    case COMMAND_RELOAD:
       SendReload();
       DoExit(0);
+   case COMMAND_STATS:
+      SendStats();
+      DoExit(0);
    default:
       break;
    }
@@ -315,7 +292,6 @@ void StartupConnection(void)
    int renderEvent;
    int renderError;
 #endif
-   struct sigaction sa;
    char name[32];
    Window win;
    XEvent event;
@@ -387,15 +363,8 @@ void StartupConnection(void)
       | PointerMotionMask | PointerMotionHintMask;
    JXChangeWindowAttributes(display, rootWindow, CWEventMask, &attr);
 
-   memset(&sa, 0, sizeof(sa));
-   sa.sa_flags = 0;
-   sa.sa_handler = HandleExit;
-   sigaction(SIGTERM, &sa, NULL);
-   sigaction(SIGINT, &sa, NULL);
-   sigaction(SIGHUP, &sa, NULL);
-
-   sa.sa_handler = HandleChild;
-   sigaction(SIGCHLD, &sa, NULL);
+   /* Signals are handled by the reactor. */
+   StartupReactor();
 
 #ifdef USE_XRENDER
    haveRender = JXRenderQueryExtension(display, &renderEvent, &renderError);
@@ -427,23 +396,10 @@ void CloseConnection(void)
 /** Close the X server connection. */
 void ShutdownConnection(void)
 {
+   ShutdownReactor();
    CloseConnection();
 }
 
-/** Signal handler. */
-void HandleExit(int sig)
-{
-   shouldExit = 1;
-}
-
-/** Signal handler for SIGCHLD. */
-void HandleChild(int sig)
-{
-   const int savedErrno = errno;
-   while(waitpid((pid_t)-1, NULL, WNOHANG) > 0);
-   errno = savedErrno;
-}
-
 /** Initialize data structures.
  * This is called before the X connection is opened.
  */
@@ -458,10 +414,13 @@ void Initialize(void)
    InitializeColors();
    InitializeCommands();
    InitializeCursors();
+   InitializeDecoder();
    InitializeDesktops();
    InitializeDialogs();
+   InitializeDrawPool();
    InitializeDock();
 //   InitializeFonts();
+   InitializeGradients();
    InitializeGroups();
    InitializeHints();
    InitializeIcons();
@@ -473,8 +432,11 @@ void Initialize(void)
    InitializeSettings();
    InitializeSwallow();
    InitializeTaskBar();
+   InitializeThumbnails();
+   InitializeTiming();
    InitializeTray();
    InitializeTrayButtons();
+   InitializeUpload();
    InitializeFonts();
 }
 
@@ -495,7 +457,12 @@ void Startup(void)
 
    StartupGroups();
    StartupColors();
+   StartupGradients();
+   StartupDrawPool();
    StartupFonts();
+   StartupDecoder();
+   StartupUpload();
+   StartupThumbnails();
    StartupIcons();
    StartupBackgrounds();
    StartupCursors();
@@ -504,6 +471,7 @@ void Startup(void)
    StartupRootMenu();
 
    StartupPager();
+   StartupTiming();
    StartupClock();
 //   StartupPager();
    StartupTaskBar();
@@ -567,12 +535,18 @@ void Shutdown(void)
    ShutdownTrayButtons();
    ShutdownTaskBar();
    ShutdownClock();
+   ShutdownTiming();
    ShutdownBorders();
    ShutdownClients();
+   ShutdownThumbnails();
    ShutdownBackgrounds();
    ShutdownIcons();
+   ShutdownDecoder();
+   ShutdownUpload();
    ShutdownCursors();
    ShutdownFonts();
+   ShutdownGradients();
+   ShutdownDrawPool();
    ShutdownColors();
    ShutdownGroups();
    ShutdownDesktops();
@@ -599,10 +573,13 @@ void Destroy(void)
    DestroyColors();
    DestroyCommands();
    DestroyCursors();
+   DestroyDecoder();
    DestroyDesktops();
    DestroyDialogs();
+   DestroyDrawPool();
    DestroyDock();
    DestroyFonts();
+   DestroyGradients();
    DestroyGroups();
    DestroyHints();
    DestroyIcons();
@@ -615,8 +592,11 @@ void Destroy(void)
    DestroySettings();
    DestroySwallow();
    DestroyTaskBar();
+   DestroyThumbnails();
+   DestroyTiming();
    DestroyTray();
    DestroyTrayButtons();
+   DestroyUpload();
 }
 
 /** Send _JWM_RESTART to the root window. */
@@ -637,6 +617,12 @@ void SendReload(void)
    SendJWMMessage(jwmReload);
 }
 
+/** Send _JWM_STATS to the root window. */
+void SendStats(void)
+{
+   SendJWMMessage(jwmStats);
+}
+
 /** Send a JWM message to the root window. */
 void SendJWMMessage(const char *message)
 {
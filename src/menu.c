@@ -25,6 +25,7 @@
 #include "hint.h"
 #include "misc.h"
 #include "popup.h"
+#include "drawpool.h"
 
 #define BASE_ICON_OFFSET   3
 #define MENU_BORDER_SIZE   1
@@ -62,6 +63,9 @@ static char IsMenuValid(const Menu *menu);
 
 int menuShown = 0;
 
+/** The innermost menu that is currently shown. */
+static Menu *shownMenu = NULL;
+
 /** Allocate an empty menu. */
 Menu *CreateMenu()
 {
@@ -294,16 +298,27 @@ char ShowSubmenu(Menu *menu, Menu *parent,
    MapMenu(menu, x, y, keyboard);
 
    menuShown += 1;
+   shownMenu = menu;
    status = MenuLoop(menu, runner);
+   shownMenu = parent;
    menuShown -= 1;
 
    JXDestroyWindow(display, menu->window);
-   JXFreePixmap(display, menu->pixmap);
+   ReleaseScratchPixmap(menu->pixmap);
 
    return status;
 
 }
 
+/** Redraw menus that are currently shown. */
+void RedrawMenus(void)
+{
+   Menu *mp;
+   for(mp = shownMenu; mp; mp = mp->parent) {
+      DrawMenu(mp);
+   }
+}
+
 /** Prepare a menu to be shown. */
 void PatchMenu(Menu *menu)
 {
@@ -573,8 +588,7 @@ void MapMenu(Menu *menu, int x, int y, char keyboard)
                                  CopyFromParent, attrMask, &attr);
    SetAtomAtom(menu->window, ATOM_NET_WM_WINDOW_TYPE,
                ATOM_NET_WM_WINDOW_TYPE_MENU);
-   menu->pixmap = JXCreatePixmap(display, menu->window,
-                                 menu->width, menu->height, rootDepth);
+   menu->pixmap = GetScratchPixmap(rootDepth, menu->width, menu->height);
 
    if(settings.menuOpacity < UINT_MAX) {
       SetCardinalAtom(menu->window, ATOM_NET_WM_WINDOW_OPACITY,
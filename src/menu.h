@@ -132,6 +132,11 @@ void InitializeMenu(Menu *menu);
 char ShowMenu(Menu *menu, RunMenuCommandType runner,
               int x, int y, char keyboard);
 
+/** Redraw menus that are currently shown.
+ * This is used when icons become available while a menu is open.
+ */
+void RedrawMenus(void);
+
 /** Destroy a menu structure.
  * @param menu The menu to destroy.
  */
@@ -70,6 +70,7 @@ static char CheckBottomValid(const RectangleType *client,
 
 static void SignalMove(const TimeType *now, int x, int y, Window w, void *data);
 static void UpdateDesktop(const TimeType *now);
+static void ScheduleDesktopSwitch(void);
 
 /** Callback for stopping moves. */
 void MoveController(int wasDestroyed)
@@ -114,7 +115,7 @@ char MoveClient(ClientNode *np, int startx, int starty)
       return 0;
    }
 
-   RegisterCallback(0, SignalMove, NULL);
+   RegisterCallback(CALLBACK_SCHEDULED, SignalMove, NULL);
    np->controller = MoveController;
    shouldStopMove = 0;
 
@@ -182,6 +183,7 @@ char MoveClient(ClientNode *np, int startx, int starty)
          } else if(event.xmotion.y_root >= sp->y + sp->height - 1) {
             atBottom = 1;
          }
+         ScheduleDesktopSwitch();
 
          flags = MAX_NONE;
          if(event.xmotion.state & Mod1Mask) {
@@ -257,7 +259,6 @@ char MoveClient(ClientNode *np, int startx, int starty)
 
          if(doMove) {
             if(settings.moveMode == MOVE_OUTLINE) {
-               ClearOutline();
                height = north + south;
                if(!(np->state.status & STAT_SHADED)) {
                   height += np->height;
@@ -323,7 +324,7 @@ char MoveClientKeyboard(ClientNode *np)
    oldx = np->x;
    oldy = np->y;
 
-   RegisterCallback(0, SignalMove, NULL);
+   RegisterCallback(CALLBACK_SCHEDULED, SignalMove, NULL);
    np->controller = MoveController;
    shouldStopMove = 0;
 
@@ -408,7 +409,6 @@ char MoveClientKeyboard(ClientNode *np)
       if(moved) {
 
          if(settings.moveMode == MOVE_OUTLINE) {
-            ClearOutline();
             DrawOutline(np->x - west, np->y - west,
                         np->width + west + east, height + north + west);
          } else {
@@ -832,6 +832,19 @@ char CheckBottomValid(const RectangleType *client,
 void SignalMove(const TimeType *now, int x, int y, Window w, void *data)
 {
    UpdateDesktop(now);
+   ScheduleDesktopSwitch();
+}
+
+/** Schedule a desktop switch while the mouse is at a screen edge. */
+void ScheduleDesktopSwitch(void)
+{
+   if(settings.desktopDelay > 0 && (atLeft | atTop | atRight | atBottom)) {
+      TimeType when = moveTime;
+      AddTime(&when, settings.desktopDelay);
+      ScheduleCallback(SignalMove, NULL, &when);
+   } else {
+      CancelCallback(SignalMove, NULL);
+   }
 }
 
 /** Switch to the specified desktop. */
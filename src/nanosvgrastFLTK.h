@@ -27,6 +27,12 @@
  * Added: nsvgRasterizeXY()
 */
 
+/* Modified 2025 by Scaramacai for use in ggwm to rasterize an image
+ * in horizontal bands (so bands can be rendered by separate threads).
+ *
+ * Added: nsvgRasterizeRowsXY(), nsvgUnpremultiplyAlpha()
+*/
+
 
 #ifndef NANOSVGRAST_H
 #define NANOSVGRAST_H
@@ -79,6 +85,21 @@ void nsvgRasterizeXY(NSVGrasterizer* r,
 				   float sx, float sy,
 				   unsigned char* dst, int w, int h, int stride);
 
+// Rasterizes rows y0 to y1-1 of an image, leaving the result with
+// premultiplied alpha. Other rows of dst are not touched, so separate
+// rasterizer contexts can render different rows of the same buffer
+// concurrently. Call nsvgUnpremultiplyAlpha once all rows are done.
+//   dst, w, h, stride - the complete destination image as above
+//   y0, y1 - the rows to render
+void nsvgRasterizeRowsXY(NSVGrasterizer* r,
+				   NSVGimage* image, float tx, float ty,
+				   float sx, float sy,
+				   unsigned char* dst, int w, int h, int stride,
+				   int y0, int y1);
+
+// Converts an image rendered by nsvgRasterizeRowsXY to non-premultiplied RGBA.
+void nsvgUnpremultiplyAlpha(unsigned char* dst, int w, int h, int stride);
+
 // Deletes rasterizer context.
 void nsvgDeleteRasterizer(NSVGrasterizer*);
 
@@ -163,6 +184,7 @@ struct NSVGrasterizer
 
 	unsigned char* bitmap;
 	int width, height, stride;
+	int starty;
 };
 
 NSVGrasterizer* nsvgCreateRasterizer(void)
@@ -1016,8 +1038,27 @@ static void nsvg__scanlineSolid(unsigned char* dst, int count, unsigned char* co
 
 		for (i = 0; i < count; i++) {
 			int r,g,b;
-			int a = nsvg__div255((int)cover[0] * ca);
-			int ia = 255 - a;
+			int a, ia;
+
+			// Uncovered pixels are unchanged and covered opaque
+			// pixels are replaced, which is the bulk of most shapes.
+			if (cover[0] == 0) {
+				cover++;
+				dst += 4;
+				continue;
+			}
+			if (cover[0] == 255 && ca == 255) {
+				dst[0] = (unsigned char)cr;
+				dst[1] = (unsigned char)cg;
+				dst[2] = (unsigned char)cb;
+				dst[3] = 255;
+				cover++;
+				dst += 4;
+				continue;
+			}
+
+			a = nsvg__div255((int)cover[0] * ca);
+			ia = 255 - a;
 			// Premultiply
 			r = nsvg__div255(cr * a);
 			g = nsvg__div255(cg * a);
@@ -1139,7 +1180,7 @@ static void nsvg__rasterizeSortedEdges(NSVGrasterizer *r, float tx, float ty, fl
 	int maxWeight = (255 / NSVG__SUBSAMPLES);  // weight per vertical scanline
 	int xmin, xmax;
 
-	for (y = 0; y < r->height; y++) {
+	for (y = r->starty; y < r->height; y++) {
 		memset(r->scanline, 0, r->width);
 		xmin = r->width;
 		xmax = 0;
@@ -1381,20 +1422,26 @@ static void dumpEdges(NSVGrasterizer* r, const char* name)
 }
 */
 
-void nsvgRasterizeXY(NSVGrasterizer* r,
+void nsvgRasterizeRowsXY(NSVGrasterizer* r,
 				   NSVGimage* image, float tx, float ty,
 				   float sx, float sy,
-				   unsigned char* dst, int w, int h, int stride)
+				   unsigned char* dst, int w, int h, int stride,
+				   int y0, int y1)
 {
 	NSVGshape *shape = NULL;
 	NSVGedge *e = NULL;
 	NSVGcachedPaint cache;
 	int i;
 
+	if (y0 < 0) y0 = 0;
+	if (y1 > h) y1 = h;
+	if (y0 >= y1) return;
+
 	r->bitmap = dst;
 	r->width = w;
-	r->height = h;
+	r->height = y1;
 	r->stride = stride;
+	r->starty = y0;
 
 	if (w > r->cscanline) {
 		r->cscanline = w;
@@ -1402,13 +1449,21 @@ void nsvgRasterizeXY(NSVGrasterizer* r,
 		if (r->scanline == NULL) return;
 	}
 
-	for (i = 0; i < h; i++)
+	for (i = y0; i < y1; i++)
 		memset(&dst[i*stride], 0, w*4);
 
 	for (shape = image->shapes; shape != NULL; shape = shape->next) {
+		float margin = 1.0f;
 		if (!(shape->flags & NSVG_FLAGS_VISIBLE))
 			continue;
 
+		// Skip shapes that are entirely outside of the rows.
+		if (shape->stroke.type != NSVG_PAINT_NONE)
+			margin += shape->strokeWidth * sy * (shape->miterLimit > 1.0f ? shape->miterLimit : 1.0f);
+		if (ty + shape->bounds[1] * sy - margin >= (float)y1 ||
+			ty + shape->bounds[3] * sy + margin <= (float)y0)
+			continue;
+
 		if (shape->fill.type != NSVG_PAINT_NONE) {
 			nsvg__resetPool(r);
 			r->freelist = NULL;
@@ -1463,12 +1518,25 @@ void nsvgRasterizeXY(NSVGrasterizer* r,
 		}
 	}
 
-	nsvg__unpremultiplyAlpha(dst, w, h, stride);
-
 	r->bitmap = NULL;
 	r->width = 0;
 	r->height = 0;
 	r->stride = 0;
+	r->starty = 0;
+}
+
+void nsvgUnpremultiplyAlpha(unsigned char* dst, int w, int h, int stride)
+{
+	nsvg__unpremultiplyAlpha(dst, w, h, stride);
+}
+
+void nsvgRasterizeXY(NSVGrasterizer* r,
+				   NSVGimage* image, float tx, float ty,
+				   float sx, float sy,
+				   unsigned char* dst, int w, int h, int stride)
+{
+	nsvgRasterizeRowsXY(r, image, tx, ty, sx, sy, dst, w, h, stride, 0, h);
+	nsvg__unpremultiplyAlpha(dst, w, h, stride);
 }
 
 void nsvgRasterize(NSVGrasterizer* r,
@@ -11,38 +11,208 @@
 #include "outline.h"
 #include "main.h"
 #include "grab.h"
+#include "color.h"
+#include "event.h"
+#include "timing.h"
+#include "misc.h"
 
+/** Width of the outline in pixels. */
+#define OUTLINE_WIDTH 2
+
+/** Minimum time between updates of the outline in milliseconds.
+ * This is roughly one frame of a 60 Hz display.
+ */
+#define OUTLINE_FRAME_MS 16
+
+static const char COMPOSITOR_SELECTION_NAME[] = "_NET_WM_CM_S%d";
+
+/** Position and size of an outline. */
+typedef struct OutlineRect {
+   int x, y;
+   int width, height;
+} OutlineRect;
+
+/** GC used to draw the outline with XOR on the root window. */
 static GC outlineGC = None;
-static int lastX, lastY;
-static int lastWidth, lastHeight;
+
+/** Outline windows used when a compositor is running. */
+static Window outlineWindows[4];
+static char useWindows = 0;
+
+static char active = 0;
+static char shown = 0;
+static char pending = 0;
+static OutlineRect lastRect;
+static OutlineRect nextRect;
+static TimeType lastUpdate;
+
+static void StartOutline(void);
+static char IsCompositorRunning(void);
+static void UpdateOutline(const TimeType *now);
+static void DrawRectangle(const OutlineRect *r);
+static void SignalOutline(const TimeType *now, int x, int y, Window w,
+                          void *data);
 
 /** Draw an outline. */
 void DrawOutline(int x, int y, int width, int height)
 {
-   XGCValues gcValues;
-   gcValues.function = GXinvert;
-   gcValues.subwindow_mode = IncludeInferiors;
-   gcValues.line_width = 2;
-   outlineGC = JXCreateGC(display, rootWindow,
-                          GCFunction | GCSubwindowMode | GCLineWidth,
-                          &gcValues);
-   GrabServer();
-   JXDrawRectangle(display, rootWindow, outlineGC, x, y, width, height);
-   lastX = x;
-   lastY = y;
-   lastWidth = width;
-   lastHeight = height;
+   TimeType now;
+
+   if(!active) {
+      StartOutline();
+   }
+
+   nextRect.x = x;
+   nextRect.y = y;
+   nextRect.width = width;
+   nextRect.height = height;
+   if(shown && x == lastRect.x && y == lastRect.y
+      && width == lastRect.width && height == lastRect.height) {
+      pending = 0;
+      CancelCallback(SignalOutline, NULL);
+      return;
+   }
+
+   /* Wait for the next frame if the outline was updated recently. */
+   GetCurrentTime(&now);
+   if(shown && GetTimeDifference(&lastUpdate, &now) < OUTLINE_FRAME_MS) {
+      if(!pending) {
+         TimeType when = lastUpdate;
+         AddTime(&when, OUTLINE_FRAME_MS);
+         ScheduleCallback(SignalOutline, NULL, &when);
+         pending = 1;
+      }
+      return;
+   }
+
+   UpdateOutline(&now);
 }
 
 /** Clear the last outline. */
 void ClearOutline(void)
 {
-   if(outlineGC != None) {
-      JXDrawRectangle(display, rootWindow, outlineGC,
-                      lastX, lastY, lastWidth, lastHeight);
+   int i;
+
+   if(!active) {
+      return;
+   }
+
+   if(useWindows) {
+      for(i = 0; i < 4; i++) {
+         JXDestroyWindow(display, outlineWindows[i]);
+      }
+   } else {
+      if(shown) {
+         DrawRectangle(&lastRect);
+      }
       UngrabServer();
       JXFreeGC(display, outlineGC);
       outlineGC = None;
    }
+   UnregisterCallback(SignalOutline, NULL);
+   active = 0;
+   shown = 0;
+   pending = 0;
 }
 
+/** Prepare to draw outlines.
+ * This is done once for each move or resize.
+ */
+void StartOutline(void)
+{
+   active = 1;
+   shown = 0;
+   pending = 0;
+   RegisterCallback(CALLBACK_SCHEDULED, SignalOutline, NULL);
+
+   /* XOR drawing on the root window is not visible when composited,
+    * so use windows instead. */
+   useWindows = IsCompositorRunning();
+   if(useWindows) {
+      XSetWindowAttributes attrs;
+      int i;
+      attrs.background_pixel = colors[COLOR_MENU_FG];
+      attrs.save_under = True;
+      attrs.override_redirect = True;
+      for(i = 0; i < 4; i++) {
+         outlineWindows[i] = JXCreateWindow(display, rootWindow,
+            0, 0, 1, 1, 0, rootDepth, InputOutput, rootVisual,
+            CWBackPixel | CWSaveUnder | CWOverrideRedirect, &attrs);
+      }
+   } else {
+      XGCValues gcValues;
+      gcValues.function = GXinvert;
+      gcValues.subwindow_mode = IncludeInferiors;
+      gcValues.line_width = OUTLINE_WIDTH;
+      outlineGC = JXCreateGC(display, rootWindow,
+                             GCFunction | GCSubwindowMode | GCLineWidth,
+                             &gcValues);
+
+      /* Keep other clients from drawing over the outline. */
+      GrabServer();
+   }
+}
+
+/** Determine if a compositing manager is running. */
+char IsCompositorRunning(void)
+{
+   static Atom selection = None;
+   if(selection == None) {
+      char name[32];
+      snprintf(name, sizeof(name), COMPOSITOR_SELECTION_NAME, rootScreen);
+      selection = JXInternAtom(display, name, False);
+   }
+   return JXGetSelectionOwner(display, selection) != None;
+}
+
+/** Move the outline to the requested position. */
+void UpdateOutline(const TimeType *now)
+{
+   const OutlineRect *r = &nextRect;
+
+   if(useWindows) {
+      const int width = Max(r->width, OUTLINE_WIDTH);
+      const int height = Max(r->height, OUTLINE_WIDTH);
+      JXMoveResizeWindow(display, outlineWindows[0],
+                         r->x, r->y, width, OUTLINE_WIDTH);
+      JXMoveResizeWindow(display, outlineWindows[1],
+                         r->x, r->y + height - OUTLINE_WIDTH,
+                         width, OUTLINE_WIDTH);
+      JXMoveResizeWindow(display, outlineWindows[2],
+                         r->x, r->y, OUTLINE_WIDTH, height);
+      JXMoveResizeWindow(display, outlineWindows[3],
+                         r->x + width - OUTLINE_WIDTH, r->y,
+                         OUTLINE_WIDTH, height);
+      if(!shown) {
+         int i;
+         for(i = 0; i < 4; i++) {
+            JXMapRaised(display, outlineWindows[i]);
+         }
+      }
+   } else {
+      if(shown) {
+         DrawRectangle(&lastRect);
+      }
+      DrawRectangle(r);
+   }
+
+   lastRect = *r;
+   lastUpdate = *now;
+   shown = 1;
+   pending = 0;
+}
+
+/** Draw a rectangle on the root window with XOR. */
+void DrawRectangle(const OutlineRect *r)
+{
+   JXDrawRectangle(display, rootWindow, outlineGC,
+                   r->x, r->y, r->width, r->height);
+}
+
+/** Draw an outline that was waiting for the next frame. */
+void SignalOutline(const TimeType *now, int x, int y, Window w, void *data)
+{
+   if(pending) {
+      UpdateOutline(now);
+   }
+}
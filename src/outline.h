@@ -11,6 +11,9 @@
 #define OUTLINE_H
 
 /** Draw an outline.
+ * The outline replaces the one drawn before, so it is not necessary
+ * to clear it first.  It is only redrawn when the geometry changes,
+ * at most once per frame; the latest geometry is drawn at the next frame.
  * @param x The x-coordinate.
  * @param y The y-coordinate.
  * @param width The width of the outline.
@@ -18,7 +21,9 @@
  */
 void DrawOutline(int x, int y, int width, int height);
 
-/** Clear an outline. */
+/** Clear the outline.
+ * This must be called when the move or resize ends.
+ */
 void ClearOutline(void);
 
 #endif /* OUTLINE_H */
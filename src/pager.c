@@ -21,6 +21,15 @@
 #include "popup.h"
 #include "font.h"
 #include "settings.h"
+#include "misc.h"
+#include "thumbnail.h"
+
+/** Cached state of a desktop on a pager. */
+typedef struct PagerDesktop {
+   unsigned long hash;     /**< Hash of the highlight and clients drawn. */
+   char *name;             /**< The label drawn (NULL for none). */
+   int nameWidth;          /**< The width of the label. */
+} PagerDesktop;
 
 /** Structure to represent a pager tray component. */
 typedef struct PagerType {
@@ -32,8 +41,11 @@ typedef struct PagerType {
    int scalex;             /**< Horizontal scale factor (fixed point). */
    int scaley;             /**< Vertical scale factor (fixed point). */
    char labeled;           /**< Set to label the pager. */
+   char thumbnails;        /**< Set to show window thumbnails. */
 
    Pixmap buffer;          /**< Buffer for rendering the pager. */
+   PagerDesktop *desktops; /**< What was drawn for each desktop. */
+   char redraw;            /**< Set to redraw all desktops. */
 
    TimeType mouseTime;     /**< Timestamp of last mouse movement. */
    int mousex, mousey;     /**< Coordinates of last mouse location. */
@@ -58,6 +70,8 @@ static void ProcessPagerButtonEvent(TrayComponentType *cp,
 static void ProcessPagerMotionEvent(TrayComponentType *cp,
                                     int x, int y, int mask);
 
+static void ProcessPagerLeaveEvent(TrayComponentType *cp);
+
 static void StartPagerMove(TrayComponentType *cp, int x, int y);
 
 static void StopPagerMove(ClientNode *np,
@@ -65,9 +79,12 @@ static void StopPagerMove(ClientNode *np,
 
 static void PagerMoveController(int wasDestroyed);
 
-static void DrawPager(const PagerType *pp);
+static char DrawPager(PagerType *pp, XRectangle *damage);
+
+static char GetPagerClient(const PagerType *pp, const ClientNode *np,
+                           int *desktop, XRectangle *rect, ColorType *fill);
 
-static void DrawPagerClient(const PagerType *pp, const ClientNode *np);
+static unsigned long HashPagerValue(unsigned long hash, unsigned long value);
 
 static void SignalPager(const TimeType *now, int x, int y, Window w,
                         void *data);
@@ -77,8 +94,18 @@ static void SignalPager(const TimeType *now, int x, int y, Window w,
 void ShutdownPager(void)
 {
    PagerType *pp;
+   unsigned x;
    for(pp = pagers; pp; pp = pp->next) {
       JXFreePixmap(display, pp->buffer);
+      if(pp->desktops) {
+         for(x = 0; x < settings.desktopCount; x++) {
+            if(pp->desktops[x].name) {
+               Release(pp->desktops[x].name);
+            }
+         }
+         Release(pp->desktops);
+         pp->desktops = NULL;
+      }
    }
 }
 
@@ -95,7 +122,7 @@ void DestroyPager(void)
 }
 
 /** Create a new pager tray component. */
-TrayComponentType *CreatePager(char labeled)
+TrayComponentType *CreatePager(char labeled, char thumbnails)
 {
 
    TrayComponentType *cp;
@@ -105,11 +132,14 @@ TrayComponentType *CreatePager(char labeled)
    pp->next = pagers;
    pagers = pp;
    pp->labeled = labeled;
+   pp->thumbnails = thumbnails;
    pp->mousex = -settings.doubleClickDelta;
    pp->mousey = -settings.doubleClickDelta;
    pp->mouseTime.seconds = 0;
    pp->mouseTime.ms = 0;
    pp->buffer = None;
+   pp->desktops = NULL;
+   pp->redraw = 1;
 
    cp = CreateTrayComponent();
    cp->object = pp;
@@ -118,8 +148,12 @@ TrayComponentType *CreatePager(char labeled)
    cp->SetSize = SetSize;
    cp->ProcessButtonPress = ProcessPagerButtonEvent;
    cp->ProcessMotionEvent = ProcessPagerMotionEvent;
+   cp->ProcessLeaveEvent = ProcessPagerLeaveEvent;
 
-   RegisterCallback(settings.popupDelay / 2, SignalPager, pp);
+   RegisterCallback(CALLBACK_SCHEDULED, SignalPager, pp);
+   if(thumbnails) {
+      RequestThumbnails();
+   }
 
    return cp;
 }
@@ -142,6 +176,10 @@ void Create(TrayComponentType *cp)
    cp->pixmap = JXCreatePixmap(display, rootWindow, cp->width,
                                cp->height, rootDepth);
    pp->buffer = cp->pixmap;
+   pp->desktops = Allocate(sizeof(PagerDesktop) * settings.desktopCount);
+   memset(pp->desktops, 0, sizeof(PagerDesktop) * settings.desktopCount);
+   pp->redraw = 1;
+   pp->thumbnails = pp->thumbnails && HaveThumbnails();
 
 }
 
@@ -177,17 +215,19 @@ void SetSize(TrayComponentType *cp, int width, int height)
       Assert(0);
    }
 
+   pp->scalex = ((pp->deskWidth - 2) << 16) / rootWidth;
+   pp->scaley = ((pp->deskHeight - 2) << 16) / rootHeight;
+
    if(pp->buffer != None) {
+      XRectangle damage;
       JXFreePixmap(display, pp->buffer);
       pp->buffer = JXCreatePixmap(display, rootWindow, cp->width,
                                   cp->height, rootDepth);
       cp->pixmap = pp->buffer;
-      DrawPager(pp);
+      pp->redraw = 1;
+      DrawPager(pp, &damage);
    }
 
-   pp->scalex = ((pp->deskWidth - 2) << 16) / rootWidth;
-   pp->scaley = ((pp->deskHeight - 2) << 16) / rootHeight;
-
 }
 
 /** Get the desktop for a pager given a set of coordinates. */
@@ -246,10 +286,22 @@ void ProcessPagerMotionEvent(TrayComponentType *cp, int x, int y, int mask)
 {
 
    PagerType *pp = (PagerType*)cp->object;
+   TimeType popupTime;
 
    pp->mousex = cp->screenx + x;
    pp->mousey = cp->screeny + y;
    GetCurrentTime(&pp->mouseTime);
+
+   /* Show a popup if the mouse stays here. */
+   popupTime = pp->mouseTime;
+   AddTime(&popupTime, settings.popupDelay);
+   ScheduleCallback(SignalPager, pp, &popupTime);
+}
+
+/** Process the mouse leaving the tray. */
+void ProcessPagerLeaveEvent(TrayComponentType *cp)
+{
+   CancelCallback(SignalPager, cp->object);
 }
 
 /** Start a pager move operation. */
@@ -497,76 +549,186 @@ void PagerMoveController(int wasDestroyed)
 
 }
 
-/** Draw a pager. */
-void DrawPager(const PagerType *pp)
+/** Draw a pager.
+ * Only desktops whose contents changed since the last draw are redrawn.
+ * @return 1 if anything was drawn, 0 otherwise.
+ */
+char DrawPager(PagerType *pp, XRectangle *damage)
 {
    ClientNode *np;
    Pixmap buffer;
-   int width, height;
+   XRectangle *cells;
+   unsigned long *hashes;
+   char *dirty;
    int deskWidth, deskHeight;
    unsigned int x;
-   const char *name;
-   int xc, yc;
-   int textWidth, textHeight;
-   int dx, dy;
+   unsigned count;
+   int desktop;
+   XRectangle rect;
+   ColorType fill;
+   int textHeight;
 
    buffer = pp->cp->pixmap;
-   width = pp->cp->width;
-   height = pp->cp->height;
    deskWidth = pp->deskWidth;
    deskHeight = pp->deskHeight;
 
-   /* Draw the background. */
-   JXSetForeground(display, rootGC, colors[COLOR_PAGER_BG]);
-   JXFillRectangle(display, buffer, rootGC, 0, 0, width, height);
+   /* Hash what each desktop should show. */
+   hashes = AllocateStack(sizeof(unsigned long) * settings.desktopCount);
+   for(x = 0; x < settings.desktopCount; x++) {
+      hashes[x] = HashPagerValue(2166136261UL, x == currentDesktop);
+   }
+   for(x = FIRST_LAYER; x <= LAST_LAYER; x++) {
+      for(np = nodeTail[x]; np; np = np->prev) {
+         if(GetPagerClient(pp, np, &desktop, &rect, &fill)) {
+            unsigned long hash = hashes[desktop];
+            hash = HashPagerValue(hash, rect.x);
+            hash = HashPagerValue(hash, rect.y);
+            hash = HashPagerValue(hash, rect.width);
+            hash = HashPagerValue(hash, rect.height);
+            if(pp->thumbnails) {
+               hash = HashPagerValue(hash, GetThumbnailSerial(np));
+            }
+            hashes[desktop] = HashPagerValue(hash, fill);
+         }
+      }
+   }
 
-   /* Highlight the current desktop. */
-   JXSetForeground(display, rootGC, colors[COLOR_PAGER_ACTIVE_BG]);
-   dx = currentDesktop % settings.desktopWidth;
-   dy = currentDesktop / settings.desktopWidth;
-   JXFillRectangle(display, buffer, rootGC,
-                   dx * (deskWidth + 1), dy * (deskHeight + 1),
-                   deskWidth, deskHeight);
+   /* Determine which desktops changed. */
+   cells = AllocateStack(sizeof(XRectangle) * settings.desktopCount);
+   dirty = AllocateStack(settings.desktopCount);
+   count = 0;
+   damage->width = 0;
+   damage->height = 0;
+   for(x = 0; x < settings.desktopCount; x++) {
+      PagerDesktop *dp = &pp->desktops[x];
+      const char *name = pp->labeled ? GetDesktopName(x) : NULL;
+      dirty[x] = pp->redraw || dp->hash != hashes[x];
+      if(!name != !dp->name || (name && strcmp(name, dp->name))) {
+         if(dp->name) {
+            Release(dp->name);
+         }
+         dp->name = name ? CopyString(name) : NULL;
+         dp->nameWidth = name ? GetStringWidth(FONT_PAGER, name) : 0;
+         dirty[x] = 1;
+      }
+      if(dirty[x]) {
+         dp->hash = hashes[x];
+         cells[count].x = (x % settings.desktopWidth) * (deskWidth + 1);
+         cells[count].y = (x / settings.desktopWidth) * (deskHeight + 1);
+         cells[count].width = deskWidth;
+         cells[count].height = deskHeight;
+         if(damage->width == 0) {
+            *damage = cells[count];
+         } else {
+            const int x2 = Max(damage->x + damage->width,
+                               cells[count].x + deskWidth);
+            const int y2 = Max(damage->y + damage->height,
+                               cells[count].y + deskHeight);
+            damage->x = Min(damage->x, cells[count].x);
+            damage->y = Min(damage->y, cells[count].y);
+            damage->width = x2 - damage->x;
+            damage->height = y2 - damage->y;
+         }
+         count += 1;
+      }
+   }
+   ReleaseStack(hashes);
+
+   if(count == 0) {
+      ReleaseStack(cells);
+      ReleaseStack(dirty);
+      return 0;
+   }
+
+   /* The background and dividers are only drawn on a full redraw. */
+   if(pp->redraw) {
+      const int width = pp->cp->width;
+      const int height = pp->cp->height;
+      JXSetForeground(display, rootGC, colors[COLOR_PAGER_BG]);
+      JXFillRectangle(display, buffer, rootGC, 0, 0, width, height);
+      JXSetForeground(display, rootGC, colors[COLOR_PAGER_OUTLINE]);
+      for(x = 1; x < settings.desktopHeight; x++) {
+         JXDrawLine(display, buffer, rootGC,
+                    0, (deskHeight + 1) * x - 1,
+                    width, (deskHeight + 1) * x - 1);
+      }
+      for(x = 1; x < settings.desktopWidth; x++) {
+         JXDrawLine(display, buffer, rootGC,
+                    (deskWidth + 1) * x - 1, 0,
+                    (deskWidth + 1) * x - 1, height);
+      }
+      damage->x = 0;
+      damage->y = 0;
+      damage->width = width;
+      damage->height = height;
+      pp->redraw = 0;
+   }
+
+   /* Draw only within the changed desktops. */
+   JXSetClipRectangles(display, rootGC, 0, 0, cells, count, Unsorted);
+
+   /* Clear the desktops, highlighting the current desktop. */
+   for(x = 0; x < count; x++) {
+      const int index = (cells[x].y / (deskHeight + 1)) * settings.desktopWidth
+                      + cells[x].x / (deskWidth + 1);
+      if(index == currentDesktop) {
+         JXSetForeground(display, rootGC, colors[COLOR_PAGER_ACTIVE_BG]);
+      } else {
+         JXSetForeground(display, rootGC, colors[COLOR_PAGER_BG]);
+      }
+      JXFillRectangle(display, buffer, rootGC, cells[x].x, cells[x].y,
+                      deskWidth, deskHeight);
+   }
 
    /* Draw the clients. */
+   if(pp->thumbnails) {
+      BeginThumbnails(buffer);
+   }
    for(x = FIRST_LAYER; x <= LAST_LAYER; x++) {
       for(np = nodeTail[x]; np; np = np->prev) {
-         DrawPagerClient(pp, np);
+         if(GetPagerClient(pp, np, &desktop, &rect, &fill)
+            && dirty[desktop]) {
+            JXSetForeground(display, rootGC, colors[COLOR_PAGER_OUTLINE]);
+            JXDrawRectangle(display, buffer, rootGC,
+                            rect.x, rect.y, rect.width, rect.height);
+            if(rect.width > 1 && rect.height > 1
+               && !(pp->thumbnails
+                  && DrawThumbnail(np, rect.x + 1, rect.y + 1,
+                                   rect.width - 1, rect.height - 1))) {
+               JXSetForeground(display, rootGC, colors[fill]);
+               JXFillRectangle(display, buffer, rootGC, rect.x + 1,
+                               rect.y + 1, rect.width - 1, rect.height - 1);
+            }
+         }
       }
    }
+   if(pp->thumbnails) {
+      EndThumbnails();
+   }
+
+   JXSetClipMask(display, rootGC, None);
 
    /* Draw the labels. */
-   if(pp->labeled) {
-      textHeight = GetStringHeight(FONT_PAGER);
-      if(textHeight < deskHeight) {
-         for(x = 0; x < settings.desktopCount; x++) {
-            dx = x % settings.desktopWidth;
-            dy = x / settings.desktopWidth;
-            name = GetDesktopName(x);
-            textWidth = GetStringWidth(FONT_PAGER, name);
-            if(textWidth < deskWidth) {
-               xc = dx * (deskWidth + 1) + (deskWidth - textWidth) / 2;
-               yc = dy * (deskHeight + 1) + (deskHeight - textHeight) / 2;
-               RenderString(buffer, FONT_PAGER,
-                            COLOR_PAGER_TEXT, xc, yc, deskWidth, name);
-            }
+   textHeight = GetStringHeight(FONT_PAGER);
+   if(pp->labeled && textHeight < deskHeight) {
+      for(x = 0; x < settings.desktopCount; x++) {
+         const PagerDesktop *dp = &pp->desktops[x];
+         if(dirty[x] && dp->name && dp->nameWidth < deskWidth) {
+            const int dx = x % settings.desktopWidth;
+            const int dy = x / settings.desktopWidth;
+            const int xc = dx * (deskWidth + 1)
+                         + (deskWidth - dp->nameWidth) / 2;
+            const int yc = dy * (deskHeight + 1)
+                         + (deskHeight - textHeight) / 2;
+            RenderString(buffer, FONT_PAGER, COLOR_PAGER_TEXT,
+                         xc, yc, deskWidth, dp->name);
          }
       }
    }
 
-   /* Draw the desktop dividers. */
-   JXSetForeground(display, rootGC, colors[COLOR_PAGER_OUTLINE]);
-   for(x = 1; x < settings.desktopHeight; x++) {
-      JXDrawLine(display, buffer, rootGC,
-                 0, (deskHeight + 1) * x - 1,
-                 width, (deskHeight + 1) * x - 1);
-   }
-   for(x = 1; x < settings.desktopWidth; x++) {
-      JXDrawLine(display, buffer, rootGC,
-                 (deskWidth + 1) * x - 1, 0,
-                 (deskWidth + 1) * x - 1, height);
-   }
-
+   ReleaseStack(cells);
+   ReleaseStack(dirty);
+   return 1;
 }
 
 /** Update the pager. */
@@ -574,6 +736,7 @@ void UpdatePager(void)
 {
 
    PagerType *pp;
+   XRectangle damage;
 
    if(JUNLIKELY(shouldExit)) {
       return;
@@ -581,11 +744,11 @@ void UpdatePager(void)
 
    for(pp = pagers; pp; pp = pp->next) {
 
-      /* Draw the pager. */
-      DrawPager(pp);
-
-      /* Tell the tray to redraw. */
-      UpdateSpecificTray(pp->cp->tray, pp->cp);
+      /* Draw the pager and tell the tray to redraw what changed. */
+      if(DrawPager(pp, &damage)) {
+         UpdateSpecificTrayArea(pp->cp->tray, pp->cp, damage.x, damage.y,
+                                damage.width, damage.height);
+      }
 
    }
 
@@ -612,8 +775,11 @@ void SignalPager(const TimeType *now, int x, int y, Window w, void *data)
    }
 }
 
-/** Draw a client on the pager. */
-void DrawPagerClient(const PagerType *pp, const ClientNode *np)
+/** Get the location of a client on the pager.
+ * @return 1 if the client is shown, 0 otherwise.
+ */
+char GetPagerClient(const PagerType *pp, const ClientNode *np,
+                    int *desktop, XRectangle *rect, ColorType *fill)
 {
 
    int x, y;
@@ -622,28 +788,31 @@ void DrawPagerClient(const PagerType *pp, const ClientNode *np)
 
    /* Don't draw the client if it isn't mapped. */
    if(!(np->state.status & STAT_MAPPED)) {
-      return;
+      return 0;
    }
    /* The user will probably expect to see windows providing background
     * images and/or desktop file icons as "unoccupied space", as if there
     * were no non-root window there really. */
    if((np->state.windowType == WINDOW_TYPE_DESKTOP) ||
       (np->state.layer == LAYER_DESKTOP)) {
-      return;
+      return 0;
    }
    /* Skip anything we're specifically told to skip too. */
    if(np->state.status & STAT_NOPAGER) {
-      return;
+      return 0;
    }
 
    /* Determine the desktop for the client. */
    if(np->state.status & STAT_STICKY) {
-      offx = currentDesktop % settings.desktopWidth;
-      offy = currentDesktop / settings.desktopWidth;
+      *desktop = currentDesktop;
    } else {
-      offx = np->state.desktop % settings.desktopWidth;
-      offy = np->state.desktop / settings.desktopWidth;
+      *desktop = np->state.desktop;
    }
+   if(*desktop >= settings.desktopCount) {
+      return 0;
+   }
+   offx = *desktop % settings.desktopWidth;
+   offy = *desktop / settings.desktopWidth;
    offx *= pp->deskWidth + 1;
    offy *= pp->deskHeight + 1;
 
@@ -671,33 +840,37 @@ void DrawPagerClient(const PagerType *pp, const ClientNode *np)
 
    /* Return if there's nothing to do. */
    if(width <= 0 || height <= 0) {
-      return;
+      return 0;
    }
 
    /* Move to the correct desktop on the pager. */
-   x += offx;
-   y += offy;
-
-   /* Draw the client outline. */
-   JXSetForeground(display, rootGC, colors[COLOR_PAGER_OUTLINE]);
-   JXDrawRectangle(display, pp->cp->pixmap, rootGC, x, y, width, height);
-
-   /* Fill the client if there's room. */
-   if(width > 1 && height > 1) {
-      ColorType fillColor;
-      if((np->state.status & STAT_ACTIVE)
-         && (np->state.desktop == currentDesktop
-         || (np->state.status & STAT_STICKY))) {
-         fillColor = COLOR_PAGER_ACTIVE_FG;
-      } else if(np->state.status & STAT_FLASH) {
-         fillColor = COLOR_PAGER_ACTIVE_FG;
-      } else {
-         fillColor = COLOR_PAGER_FG;
-      }
-      JXSetForeground(display, rootGC, colors[fillColor]);
-      JXFillRectangle(display, pp->cp->pixmap, rootGC, x + 1, y + 1,
-                      width - 1, height - 1);
+   rect->x = x + offx;
+   rect->y = y + offy;
+   rect->width = width;
+   rect->height = height;
+
+   /* Determine the fill color. */
+   if((np->state.status & STAT_ACTIVE)
+      && (np->state.desktop == currentDesktop
+      || (np->state.status & STAT_STICKY))) {
+      *fill = COLOR_PAGER_ACTIVE_FG;
+   } else if(np->state.status & STAT_FLASH) {
+      *fill = COLOR_PAGER_ACTIVE_FG;
+   } else {
+      *fill = COLOR_PAGER_FG;
    }
+   return 1;
 
 }
 
+/** Mix a value into a hash (FNV-1a). */
+unsigned long HashPagerValue(unsigned long hash, unsigned long value)
+{
+   unsigned i;
+   for(i = 0; i < sizeof(unsigned long); i++) {
+      hash ^= value & 0xFF;
+      hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+      value >>= 8;
+   }
+   return hash;
+}
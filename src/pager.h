@@ -21,9 +21,10 @@ void DestroyPager(void);
 
 /** Create a pager tray component.
  * @param labeled Set to label the pager.
+ * @param thumbnails Set to show window thumbnails if available.
  * @return A new pager tray component.
  */
-struct TrayComponentType *CreatePager(char labeled);
+struct TrayComponentType *CreatePager(char labeled, char thumbnails);
 
 /** Update pagers. */
 void UpdatePager(void);
@@ -156,6 +156,7 @@ static const char *ICON_ATTRIBUTE = "icon";
 static const char *TOOLTIP_ATTRIBUTE = "tooltip";
 static const char *CONFIRM_ATTRIBUTE = "confirm";
 static const char *LABELED_ATTRIBUTE = "labeled";
+static const char *THUMBNAILS_ATTRIBUTE = "thumbnails";
 static const char *ONROOT_ATTRIBUTE = "onroot";
 static const char *X_ATTRIBUTE = "x";
 static const char *Y_ATTRIBUTE = "y";
@@ -352,6 +353,9 @@ void Parse(const TokenNode *start, int depth)
             }
          } else {
             switch(tp->type) {
+            case TOK_BACKGROUNDCACHESIZE:
+               settings.backgroundCacheSize = ParseUnsigned(tp, tp->value);
+               break;
             case TOK_DESKTOPS:
                ParseDesktops(tp);
                break;
@@ -367,6 +371,9 @@ void Parse(const TokenNode *start, int depth)
             case TOK_GROUP:
                ParseGroup(tp);
                break;
+            case TOK_ICONCACHESIZE:
+               settings.iconCacheSize = ParseUnsigned(tp, tp->value);
+               break;
             case TOK_ICONPATH:
                AddIconPath(tp->value);
                break;
@@ -463,6 +470,9 @@ void Parse(const TokenNode *start, int depth)
             case TOK_TITLEBUTTONORDER:
                SetTitleButtonOrder(tp->value);
                break;
+            case TOK_TITLEDELAY:
+               settings.titleDelay = ParseUnsigned(tp, tp->value);
+               break;
             default:
                InvalidTag(tp, TOK_JWM);
                break;
@@ -1460,6 +1470,7 @@ void ParsePager(const TokenNode *tp, TrayType *tray)
    TrayComponentType *cp;
    const char *temp;
    int labeled;
+   int thumbnails;
 
    Assert(tp);
    Assert(tray);
@@ -1469,7 +1480,12 @@ void ParsePager(const TokenNode *tp, TrayType *tray)
    if(temp && !strcmp(temp, TRUE_VALUE)) {
       labeled = 1;
    }
-   cp = CreatePager(labeled);
+   thumbnails = 0;
+   temp = FindAttribute(tp->attributes, THUMBNAILS_ATTRIBUTE);
+   if(temp && !strcmp(temp, TRUE_VALUE)) {
+      thumbnails = 1;
+   }
+   cp = CreatePager(labeled, thumbnails);
    AddTrayComponent(tray, cp);
 
 }
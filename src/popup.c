@@ -19,6 +19,7 @@
 #include "settings.h"
 #include "event.h"
 #include "hint.h"
+#include "drawpool.h"
 
 typedef struct PopupType {
    int x, y;   /* The coordinates of the upper-left corner of the popup. */
@@ -35,6 +36,7 @@ typedef struct PopupType {
 static PopupType popup;
 
 static void MeasurePopupText();
+static void HidePopup(void);
 static void SignalPopup(const TimeType *now, int x, int y, Window w,
                         void *data);
 
@@ -43,22 +45,18 @@ void StartupPopup(void)
 {
    popup.text = NULL;
    popup.window = None;
-   RegisterCallback(100, SignalPopup, NULL);
 }
 
 /** Shutdown popups. */
 void ShutdownPopup(void)
 {
-   UnregisterCallback(SignalPopup, NULL);
    if(popup.text) {
       Release(popup.text);
       Release(popup.lines);
       popup.text = NULL;
    }
    if(popup.window != None) {
-      JXDestroyWindow(display, popup.window);
-      JXFreePixmap(display, popup.pmap);
-      popup.window = None;
+      HidePopup();
    }
 }
 
@@ -173,17 +171,18 @@ void ShowPopup(int x, int y, const char *text,
                   ATOM_NET_WM_WINDOW_TYPE_NOTIFICATION);
       JXMapRaised(display, popup.window);
 
+      /* Watch the mouse only while the popup is shown. */
+      RegisterCallback(100, SignalPopup, NULL);
+
    } else {
 
       JXMoveResizeWindow(display, popup.window, popup.x, popup.y,
                          popup.width, popup.height);
-      JXFreePixmap(display, popup.pmap);
+      ReleaseScratchPixmap(popup.pmap);
 
    }
 
-   popup.pmap = JXCreatePixmap(display, popup.window,
-                               popup.width, popup.height,
-                               rootDepth);
+   popup.pmap = GetScratchPixmap(rootDepth, popup.width, popup.height);
 
    JXSetForeground(display, rootGC, colors[COLOR_POPUP_BG]);
    JXFillRectangle(display, popup.pmap, rootGC, 0, 0,
@@ -209,13 +208,20 @@ void SignalPopup(const TimeType *now, int x, int y, Window w, void *data)
    if(popup.window != None) {
       if(popup.mw != w ||
          abs(popup.mx - x) > 0 || abs(popup.my - y) > 0) {
-         JXDestroyWindow(display, popup.window);
-         JXFreePixmap(display, popup.pmap);
-         popup.window = None;
+         HidePopup();
       }
    }
 }
 
+/** Destroy the popup window. */
+void HidePopup(void)
+{
+   UnregisterCallback(SignalPopup, NULL);
+   JXDestroyWindow(display, popup.window);
+   ReleaseScratchPixmap(popup.pmap);
+   popup.window = None;
+}
+
 /** Process an event on a popup window. */
 char ProcessPopupEvent(const XEvent *event)
 {
@@ -224,9 +230,7 @@ char ProcessPopupEvent(const XEvent *event)
          JXCopyArea(display, popup.pmap, popup.window, rootGC,
                     0, 0, popup.width, popup.height, 0, 0);
       } else if(event->type == MotionNotify) {
-         JXDestroyWindow(display, popup.window);
-         JXFreePixmap(display, popup.pmap);
-         popup.window = None;
+         HidePopup();
       }
       return 1;
    }
@@ -0,0 +1,409 @@
+/**
+ * @file prefetch.c
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Functions to read the hints of a new client at once.
+ *
+ * Reading the hints of a new client takes about twenty requests, and
+ * with Xlib each one waits for its reply.  With XCB, the requests are
+ * all sent first and the replies are collected afterwards, so adopting
+ * a window costs one round trip, which matters on remote displays.
+ * At startup, the requests for all existing windows are sent together.
+ *
+ */
+
+#include "ggwm.h"
+#include "prefetch.h"
+#include "hint.h"
+#include "main.h"
+#include "misc.h"
+
+#ifdef USE_XCB
+
+/** Maximum number of properties to read for a window. */
+#define MAX_PREFETCH 24
+
+/** A property read for each window. */
+typedef struct PropertySpec {
+   Atom property;
+   Atom type;
+   long length;
+} PropertySpec;
+
+/** Requests and replies for a window. */
+typedef struct PrefetchNode {
+   Window window;
+   xcb_get_window_attributes_cookie_t attrCookie;
+   xcb_get_geometry_cookie_t geomCookie;
+   xcb_get_property_cookie_t cookies[MAX_PREFETCH];
+   xcb_get_window_attributes_reply_t *attr;
+   xcb_get_geometry_reply_t *geom;
+   xcb_get_property_reply_t *replies[MAX_PREFETCH];
+} PrefetchNode;
+
+static PropertySpec specs[MAX_PREFETCH];
+static unsigned specCount = 0;
+
+static PrefetchNode *nodes = NULL;
+static unsigned nodeCount = 0;
+static unsigned nodeCapacity = 0;
+
+static void LoadSpecs(void);
+static void AddSpec(Atom property, Atom type, long length);
+static PrefetchNode *AddNode(Window w);
+static PrefetchNode *FindNode(Window w);
+static void RequestAttributes(xcb_connection_t *c, PrefetchNode *np);
+static void ReadAttributes(xcb_connection_t *c, PrefetchNode *np);
+static void RequestProperties(xcb_connection_t *c, PrefetchNode *np);
+static void ReadProperties(xcb_connection_t *c, PrefetchNode *np);
+static char IsManageable(const PrefetchNode *np);
+static int CopyReply(const xcb_get_property_reply_t *reply,
+                     Atom *realType, int *realFormat,
+                     unsigned long *count, unsigned long *extra,
+                     unsigned char **data);
+
+/** Read the attributes and hints of windows to be adopted at startup. */
+void PrefetchWindows(const Window *windows, unsigned count)
+{
+
+   xcb_connection_t *c;
+   unsigned first;
+   unsigned i;
+
+   LoadSpecs();
+   c = JXGetXCBConnection(display);
+   first = nodeCount;
+
+   /* Read the attributes of every window first so that properties
+    * are only read for windows that will be managed.  This costs
+    * two round trips no matter how many windows there are. */
+   for(i = 0; i < count; i++) {
+      if(!FindNode(windows[i])) {
+         RequestAttributes(c, AddNode(windows[i]));
+      }
+   }
+   for(i = first; i < nodeCount; i++) {
+      ReadAttributes(c, &nodes[i]);
+   }
+   for(i = first; i < nodeCount; i++) {
+      if(IsManageable(&nodes[i])) {
+         RequestProperties(c, &nodes[i]);
+      }
+   }
+   for(i = first; i < nodeCount; i++) {
+      if(IsManageable(&nodes[i])) {
+         ReadProperties(c, &nodes[i]);
+      }
+   }
+
+}
+
+/** Read the attributes and hints of a window being added. */
+char PrefetchWindow(Window w, XWindowAttributes *attr)
+{
+
+   PrefetchNode *np;
+
+   Assert(w != None);
+
+   /* Send everything before waiting for the first reply. */
+   np = FindNode(w);
+   if(!np) {
+      xcb_connection_t *c = JXGetXCBConnection(display);
+      LoadSpecs();
+      np = AddNode(w);
+      RequestAttributes(c, np);
+      RequestProperties(c, np);
+      ReadAttributes(c, np);
+      ReadProperties(c, np);
+   }
+
+   if(JUNLIKELY(!np->attr || !np->geom)) {
+      ReleasePrefetch(w);
+      return 0;
+   }
+
+   memset(attr, 0, sizeof(XWindowAttributes));
+   attr->x = np->geom->x;
+   attr->y = np->geom->y;
+   attr->width = np->geom->width;
+   attr->height = np->geom->height;
+   attr->border_width = np->geom->border_width;
+   attr->depth = np->geom->depth;
+   attr->root = np->geom->root;
+   attr->class = np->attr->_class;
+   attr->colormap = np->attr->colormap;
+   attr->map_state = np->attr->map_state;
+   attr->override_redirect = np->attr->override_redirect ? True : False;
+   return 1;
+
+}
+
+/** Release the replies read for a window. */
+void ReleasePrefetch(Window w)
+{
+
+   PrefetchNode *np;
+   unsigned i;
+
+   np = FindNode(w);
+   if(!np) {
+      return;
+   }
+
+   free(np->attr);
+   free(np->geom);
+   for(i = 0; i < specCount; i++) {
+      free(np->replies[i]);
+   }
+
+   /* Order does not matter, so fill the hole with the last node. */
+   nodeCount -= 1;
+   *np = nodes[nodeCount];
+   if(nodeCount == 0) {
+      Release(nodes);
+      nodes = NULL;
+      nodeCapacity = 0;
+   }
+
+}
+
+/** Read a window property. */
+int GetWindowProperty(Window w, Atom property, long offset, long length,
+                      Atom type, Atom *realType, int *realFormat,
+                      unsigned long *count, unsigned long *extra,
+                      unsigned char **data)
+{
+   const PrefetchNode *np = offset == 0 ? FindNode(w) : NULL;
+   unsigned i;
+   if(np) {
+      for(i = 0; i < specCount; i++) {
+         const PropertySpec *sp = &specs[i];
+         if(sp->property == property && sp->type == type
+            && sp->length == length && np->replies[i]) {
+            return CopyReply(np->replies[i], realType, realFormat,
+                             count, extra, data);
+         }
+      }
+   }
+   return JXGetWindowProperty(display, w, property, offset, length, False,
+                              type, realType, realFormat, count,
+                              extra, data);
+}
+
+/** Determine the properties to read for each window. */
+void LoadSpecs(void)
+{
+   specCount = 0;
+
+   /* !! Keep in sync: requests made while reading hints in hint.c */
+   AddSpec(atoms[ATOM_NET_WM_NAME], atoms[ATOM_UTF8_STRING], 1024);
+#ifdef USE_XUTF8
+   AddSpec(XA_WM_NAME, atoms[ATOM_COMPOUND_TEXT], 1024);
+#endif
+   AddSpec(XA_WM_NAME, XA_STRING, BUFSIZ);
+   AddSpec(XA_WM_CLASS, XA_STRING, BUFSIZ);
+   AddSpec(XA_WM_NORMAL_HINTS, XA_WM_SIZE_HINTS, 18);
+   AddSpec(atoms[ATOM_WM_COLORMAP_WINDOWS], XA_WINDOW, 1024);
+   AddSpec(XA_WM_CLIENT_MACHINE, AnyPropertyType, 1024);
+   AddSpec(XA_WM_TRANSIENT_FOR, XA_WINDOW, 1);
+   AddSpec(atoms[ATOM_WM_PROTOCOLS], XA_ATOM, 32);
+   AddSpec(XA_WM_HINTS, XA_WM_HINTS, 9);
+   AddSpec(atoms[ATOM_WM_STATE], atoms[ATOM_WM_STATE], 2);
+   AddSpec(atoms[ATOM_MOTIF_WM_HINTS], atoms[ATOM_MOTIF_WM_HINTS], 20);
+   AddSpec(atoms[ATOM_NET_WM_WINDOW_OPACITY], XA_CARDINAL, 1);
+   AddSpec(atoms[ATOM_NET_WM_DESKTOP], XA_CARDINAL, 1);
+   AddSpec(atoms[ATOM_NET_WM_STATE], XA_ATOM, 32);
+   AddSpec(atoms[ATOM_NET_WM_WINDOW_TYPE], XA_ATOM, 32);
+   AddSpec(atoms[ATOM_NET_WM_USER_TIME_WINDOW], XA_WINDOW, 1);
+   AddSpec(atoms[ATOM_NET_WM_USER_TIME], XA_CARDINAL, 1);
+}
+
+/** Add a property to read for each window. */
+void AddSpec(Atom property, Atom type, long length)
+{
+   PropertySpec *sp;
+   Assert(specCount < MAX_PREFETCH);
+   sp = &specs[specCount++];
+   sp->property = property;
+   sp->type = type;
+   sp->length = length;
+}
+
+/** Add a window to the cache. */
+PrefetchNode *AddNode(Window w)
+{
+   PrefetchNode *np;
+   unsigned i;
+   if(nodeCount == nodeCapacity) {
+      nodeCapacity = Max(nodeCapacity * 2, 8);
+      nodes = Reallocate(nodes, nodeCapacity * sizeof(PrefetchNode));
+   }
+   np = &nodes[nodeCount++];
+   np->window = w;
+   np->attr = NULL;
+   np->geom = NULL;
+   for(i = 0; i < MAX_PREFETCH; i++) {
+      np->replies[i] = NULL;
+   }
+   return np;
+}
+
+/** Find a window in the cache. */
+PrefetchNode *FindNode(Window w)
+{
+   unsigned i;
+   for(i = 0; i < nodeCount; i++) {
+      if(nodes[i].window == w) {
+         return &nodes[i];
+      }
+   }
+   return NULL;
+}
+
+/** Request the attributes and geometry of a window. */
+void RequestAttributes(xcb_connection_t *c, PrefetchNode *np)
+{
+   np->attrCookie = xcb_get_window_attributes(c, np->window);
+   np->geomCookie = xcb_get_geometry(c, np->window);
+}
+
+/** Collect the attributes and geometry of a window.
+ * Errors are returned here so they never reach the error handler.
+ */
+void ReadAttributes(xcb_connection_t *c, PrefetchNode *np)
+{
+   xcb_generic_error_t *error;
+   error = NULL;
+   np->attr = xcb_get_window_attributes_reply(c, np->attrCookie, &error);
+   free(error);
+   error = NULL;
+   np->geom = xcb_get_geometry_reply(c, np->geomCookie, &error);
+   free(error);
+}
+
+/** Request the hints of a window. */
+void RequestProperties(xcb_connection_t *c, PrefetchNode *np)
+{
+   unsigned i;
+   for(i = 0; i < specCount; i++) {
+      np->cookies[i] = xcb_get_property(c, 0, np->window, specs[i].property,
+                                        specs[i].type, 0, specs[i].length);
+   }
+}
+
+/** Collect the hints of a window. */
+void ReadProperties(xcb_connection_t *c, PrefetchNode *np)
+{
+   xcb_generic_error_t *error;
+   unsigned i;
+   for(i = 0; i < specCount; i++) {
+      error = NULL;
+      np->replies[i] = xcb_get_property_reply(c, np->cookies[i], &error);
+      free(error);
+   }
+}
+
+/** Determine if a window found at startup will be managed. */
+char IsManageable(const PrefetchNode *np)
+{
+   return np->attr && np->geom
+       && !np->attr->override_redirect
+       && np->attr->_class != XCB_WINDOW_CLASS_INPUT_ONLY
+       && np->attr->map_state == XCB_MAP_STATE_VIEWABLE;
+}
+
+/** Convert a property reply to the form returned by XGetWindowProperty.
+ * Like Xlib, 32-bit items are returned as longs and the data has a
+ * trailing NUL.  The data is allocated with malloc so that it can be
+ * released with JXFree.
+ */
+int CopyReply(const xcb_get_property_reply_t *reply,
+              Atom *realType, int *realFormat,
+              unsigned long *count, unsigned long *extra,
+              unsigned char **data)
+{
+
+   const unsigned long items = reply->value_len;
+   const void *value = xcb_get_property_value(reply);
+   unsigned char *buffer;
+   size_t size;
+   unsigned long i;
+
+   *data = NULL;
+   *realType = reply->type;
+   if(reply->type == None) {
+      *realFormat = 0;
+      *count = 0;
+      *extra = 0;
+      return Success;
+   }
+
+   switch(reply->format) {
+   case 8:
+      size = items;
+      break;
+   case 16:
+      size = items * sizeof(short);
+      break;
+   case 32:
+      size = items * sizeof(long);
+      break;
+   default:
+      return BadImplementation;
+   }
+
+   buffer = malloc(size + 1);
+   if(JUNLIKELY(!buffer)) {
+      return BadAlloc;
+   }
+   if(reply->format == 32) {
+      const int *in = value;
+      long *out = (long*)buffer;
+      for(i = 0; i < items; i++) {
+         out[i] = in[i];
+      }
+   } else {
+      memcpy(buffer, value, size);
+   }
+   buffer[size] = 0;
+
+   *realFormat = reply->format;
+   *count = items;
+   *extra = reply->bytes_after;
+   *data = buffer;
+   return Success;
+
+}
+
+#else /* USE_XCB */
+
+/** Read the attributes and hints of a window being added. */
+char PrefetchWindow(Window w, XWindowAttributes *attr)
+{
+   return JXGetWindowAttributes(display, w, attr) != 0;
+}
+
+/** Read the attributes and hints of windows to be adopted at startup. */
+void PrefetchWindows(const Window *windows, unsigned count)
+{
+}
+
+/** Release the replies read for a window. */
+void ReleasePrefetch(Window w)
+{
+}
+
+/** Read a window property. */
+int GetWindowProperty(Window w, Atom property, long offset, long length,
+                      Atom type, Atom *realType, int *realFormat,
+                      unsigned long *count, unsigned long *extra,
+                      unsigned char **data)
+{
+   return JXGetWindowProperty(display, w, property, offset, length, False,
+                              type, realType, realFormat, count,
+                              extra, data);
+}
+
+#endif /* USE_XCB */
@@ -0,0 +1,51 @@
+/**
+ * @file prefetch.h
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Functions to read the hints of a new client at once.
+ *
+ */
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+/** Read the attributes and hints of a window being added.
+ * With XCB, every request is sent before waiting for the first reply,
+ * so this costs a single round trip, or none if the window was read by
+ * PrefetchWindows.  The property replies are kept until ReleasePrefetch
+ * is called and are returned by GetWindowProperty.
+ * Without XCB, only the attributes are read.
+ * @param w The window.
+ * @param attr The attributes to fill in.  Only the geometry, class,
+ *        colormap, map state, and override redirect flag are
+ *        guaranteed to be set.
+ * @return 1 on success, 0 if the window does not exist.
+ */
+char PrefetchWindow(Window w, XWindowAttributes *attr);
+
+/** Read the attributes and hints of windows to be adopted at startup.
+ * With XCB, the attributes of every window are read in one round trip,
+ * then the hints of the viewable windows that can be managed are read
+ * in a second one.  PrefetchWindow then uses these replies.
+ * @param windows The windows.
+ * @param count The number of windows.
+ */
+void PrefetchWindows(const Window *windows, unsigned count);
+
+/** Release the replies read for a window.
+ * @param w The window.
+ */
+void ReleasePrefetch(Window w);
+
+/** Read a window property.
+ * This works like XGetWindowProperty, but uses the reply read by
+ * PrefetchWindow when the request matches.
+ * The data returned must be released with JXFree.
+ */
+int GetWindowProperty(Window w, Atom property, long offset, long length,
+                      Atom type, Atom *realType, int *realFormat,
+                      unsigned long *count, unsigned long *extra,
+                      unsigned char **data);
+
+#endif /* PREFETCH_H */
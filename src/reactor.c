@@ -0,0 +1,373 @@
+/**
+ * @file reactor.c
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Waiting for the X connection, descriptors, timers, and signals.
+ *
+ * Everything that can wake the window manager goes through one wait:
+ * the X connection, descriptors registered by other components (for
+ * example, the image decoder), the next timer deadline, and signals.
+ * On Linux this uses epoll with a timerfd for the deadline and a
+ * signalfd, so signals are handled in the main loop instead of in a
+ * signal handler.  Elsewhere poll is used with a self-pipe for signals.
+ *
+ */
+
+#include "ggwm.h"
+#include "reactor.h"
+#include "main.h"
+#include "root.h"
+#include "timing.h"
+#include "error.h"
+#include "misc.h"
+
+#include <fcntl.h>
+#include <errno.h>
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_TIMERFD_H) \
+   && defined(HAVE_SYS_SIGNALFD_H)
+#  define REACTOR_EPOLL
+#  include <sys/epoll.h>
+#  include <sys/timerfd.h>
+#  include <sys/signalfd.h>
+#else
+#  include <poll.h>
+#endif
+
+/** Maximum number of epoll events processed per wait. */
+#define MAX_EVENTS 16
+
+/** A watched descriptor. */
+typedef struct DescriptorNode {
+   int fd;
+   DescriptorCallback callback;
+   void *data;
+   struct DescriptorNode *next;
+} DescriptorNode;
+
+/** Signals handled by the window manager. */
+static const int SIGNALS[] = {
+   SIGCHLD, SIGHUP, SIGINT, SIGTERM, SIGUSR1, SIGUSR2
+};
+static const unsigned SIGNAL_COUNT = ARRAY_LENGTH(SIGNALS);
+
+static DescriptorNode *descriptors = NULL;
+static int connectionFd = -1;
+
+#ifdef REACTOR_EPOLL
+static int epollFd = -1;
+static int timerFd = -1;
+static int signalFd = -1;
+static sigset_t originalMask;
+static void AddEpollDescriptor(int fd);
+#else
+static int signalPipe[2] = { -1, -1 };
+static void CatchSignal(int sig);
+#endif
+
+static void ReadSignals(void);
+static void HandleSignal(int sig);
+static void RunDescriptor(int fd);
+
+/** Startup the reactor. */
+void StartupReactor(void)
+{
+#ifdef REACTOR_EPOLL
+   sigset_t mask;
+#else
+   struct sigaction sa;
+#endif
+   unsigned i;
+
+   connectionFd = ConnectionNumber(display);
+
+#ifdef REACTOR_EPOLL
+
+   /* Signals are read from the signalfd instead of being delivered. */
+   sigemptyset(&mask);
+   for(i = 0; i < SIGNAL_COUNT; i++) {
+      sigaddset(&mask, SIGNALS[i]);
+   }
+   sigprocmask(SIG_BLOCK, &mask, &originalMask);
+
+   epollFd = epoll_create1(EPOLL_CLOEXEC);
+   timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+   signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+   if(JUNLIKELY(epollFd < 0 || timerFd < 0 || signalFd < 0)) {
+      FatalError(_("could not create event descriptors: %s"),
+                 strerror(errno));
+   }
+   AddEpollDescriptor(connectionFd);
+   AddEpollDescriptor(timerFd);
+   AddEpollDescriptor(signalFd);
+
+#else
+
+   if(JUNLIKELY(pipe(signalPipe) < 0)) {
+      FatalError(_("could not create pipe: %s"), strerror(errno));
+   }
+   for(i = 0; i < 2; i++) {
+      fcntl(signalPipe[i], F_SETFL, O_NONBLOCK);
+      fcntl(signalPipe[i], F_SETFD, FD_CLOEXEC);
+   }
+
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_flags = 0;
+   sa.sa_handler = CatchSignal;
+   for(i = 0; i < SIGNAL_COUNT; i++) {
+      sigaction(SIGNALS[i], &sa, NULL);
+   }
+
+#endif
+}
+
+/** Shutdown the reactor. */
+void ShutdownReactor(void)
+{
+   Assert(!descriptors);
+
+#ifdef REACTOR_EPOLL
+   close(epollFd);
+   close(timerFd);
+   close(signalFd);
+   epollFd = -1;
+   timerFd = -1;
+   signalFd = -1;
+   sigprocmask(SIG_SETMASK, &originalMask, NULL);
+#else
+   ResetChildSignals();
+   close(signalPipe[0]);
+   close(signalPipe[1]);
+   signalPipe[0] = -1;
+   signalPipe[1] = -1;
+#endif
+}
+
+/** Watch a descriptor. */
+void RegisterDescriptor(int fd, DescriptorCallback callback, void *data)
+{
+   DescriptorNode *dp = Allocate(sizeof(DescriptorNode));
+   dp->fd = fd;
+   dp->callback = callback;
+   dp->data = data;
+   dp->next = descriptors;
+   descriptors = dp;
+#ifdef REACTOR_EPOLL
+   AddEpollDescriptor(fd);
+#endif
+}
+
+/** Stop watching a descriptor. */
+void UnregisterDescriptor(int fd)
+{
+   DescriptorNode **dp;
+   for(dp = &descriptors; *dp; dp = &(*dp)->next) {
+      if((*dp)->fd == fd) {
+         DescriptorNode *temp = *dp;
+         *dp = temp->next;
+         Release(temp);
+#ifdef REACTOR_EPOLL
+         epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+         return;
+      }
+   }
+   Assert(0);
+}
+
+#ifdef REACTOR_EPOLL
+
+/** Wait for the X connection to become readable. */
+char WaitForReactor(const TimeType *deadline)
+{
+   struct epoll_event events[MAX_EVENTS];
+   struct itimerspec spec;
+   char ready;
+   int count;
+   int i;
+
+   /* Arm the timer for the deadline (a zero value disarms it).
+    * Deadlines come from GetCurrentTime, so the timer uses the same
+    * monotonic clock. */
+   memset(&spec, 0, sizeof(spec));
+   if(deadline) {
+      spec.it_value.tv_sec = deadline->seconds;
+      spec.it_value.tv_nsec = deadline->ms * 1000000L + 1;
+   }
+   timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, NULL);
+
+   count = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+
+   ready = 0;
+   for(i = 0; i < count; i++) {
+      const int fd = events[i].data.fd;
+      if(fd == connectionFd) {
+         ready = 1;
+      } else if(fd == timerFd) {
+         unsigned long long expirations;
+         if(read(timerFd, &expirations, sizeof(expirations)) < 0) {
+            /* Disarmed before it was read. */
+         }
+      } else if(fd == signalFd) {
+         ReadSignals();
+      } else {
+         RunDescriptor(fd);
+      }
+   }
+   return ready;
+}
+
+/** Restore the default signal state. */
+void ResetChildSignals(void)
+{
+   sigprocmask(SIG_SETMASK, &originalMask, NULL);
+}
+
+/** Add a descriptor to the epoll set. */
+void AddEpollDescriptor(int fd)
+{
+   struct epoll_event event;
+   memset(&event, 0, sizeof(event));
+   event.events = EPOLLIN;
+   event.data.fd = fd;
+   if(JUNLIKELY(epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0)) {
+      Warning(_("could not watch descriptor %d: %s"), fd, strerror(errno));
+   }
+}
+
+/** Handle pending signals. */
+void ReadSignals(void)
+{
+   struct signalfd_siginfo info;
+   while(read(signalFd, &info, sizeof(info)) == sizeof(info)) {
+      HandleSignal(info.ssi_signo);
+   }
+}
+
+#else /* REACTOR_EPOLL */
+
+/** Wait for the X connection to become readable. */
+char WaitForReactor(const TimeType *deadline)
+{
+   struct pollfd *fds;
+   DescriptorNode *dp;
+   unsigned count;
+   unsigned i;
+   int timeout;
+   char ready;
+
+   count = 2;
+   for(dp = descriptors; dp; dp = dp->next) {
+      count += 1;
+   }
+   fds = AllocateStack(sizeof(struct pollfd) * count);
+   fds[0].fd = connectionFd;
+   fds[1].fd = signalPipe[0];
+   i = 2;
+   for(dp = descriptors; dp; dp = dp->next) {
+      fds[i].fd = dp->fd;
+      i += 1;
+   }
+   for(i = 0; i < count; i++) {
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+   }
+
+   timeout = -1;
+   if(deadline) {
+      TimeType now;
+      GetCurrentTime(&now);
+      if(now.seconds > deadline->seconds
+         || (now.seconds == deadline->seconds && now.ms >= deadline->ms)) {
+         timeout = 0;
+      } else {
+         timeout = GetTimeDifference(&now, deadline);
+      }
+   }
+
+   ready = 0;
+   if(poll(fds, count, timeout) > 0) {
+      ready = fds[0].revents != 0;
+      if(fds[1].revents) {
+         ReadSignals();
+      }
+      for(i = 2; i < count; i++) {
+         if(fds[i].revents) {
+            RunDescriptor(fds[i].fd);
+         }
+      }
+   }
+
+   ReleaseStack(fds);
+   return ready;
+}
+
+/** Restore the default signal state. */
+void ResetChildSignals(void)
+{
+   struct sigaction sa;
+   unsigned i;
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_handler = SIG_DFL;
+   for(i = 0; i < SIGNAL_COUNT; i++) {
+      sigaction(SIGNALS[i], &sa, NULL);
+   }
+}
+
+/** Signal handler: pass the signal to the event loop. */
+void CatchSignal(int sig)
+{
+   const int savedErrno = errno;
+   const unsigned char value = (unsigned char)sig;
+   if(write(signalPipe[1], &value, 1) < 0) {
+      /* The pipe is full, so the event loop will wake anyway. */
+   }
+   errno = savedErrno;
+}
+
+/** Handle pending signals. */
+void ReadSignals(void)
+{
+   unsigned char buffer[32];
+   int count;
+   int i;
+   while((count = read(signalPipe[0], buffer, sizeof(buffer))) > 0) {
+      for(i = 0; i < count; i++) {
+         HandleSignal(buffer[i]);
+      }
+   }
+}
+
+#endif /* REACTOR_EPOLL */
+
+/** Handle a signal from the event loop. */
+void HandleSignal(int sig)
+{
+   switch(sig) {
+   case SIGCHLD:
+      while(waitpid((pid_t)-1, NULL, WNOHANG) > 0);
+      break;
+   case SIGUSR1:
+      Restart();
+      break;
+   case SIGUSR2:
+      ReloadMenu();
+      break;
+   default:
+      shouldExit = 1;
+      break;
+   }
+}
+
+/** Run the callback for a readable descriptor. */
+void RunDescriptor(int fd)
+{
+   DescriptorNode *dp;
+   for(dp = descriptors; dp; dp = dp->next) {
+      if(dp->fd == fd) {
+         (dp->callback)(fd, dp->data);
+         return;
+      }
+   }
+}
@@ -0,0 +1,54 @@
+/**
+ * @file reactor.h
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Waiting for the X connection, descriptors, timers, and signals.
+ *
+ */
+
+#ifndef REACTOR_H
+#define REACTOR_H
+
+struct TimeType;
+
+/** Callback for a readable descriptor.
+ * @param fd The descriptor.
+ * @param data The data passed to RegisterDescriptor.
+ */
+typedef void (*DescriptorCallback)(int fd, void *data);
+
+/*@{*/
+#define InitializeReactor()   (void)(0)
+void StartupReactor(void);
+void ShutdownReactor(void);
+#define DestroyReactor()      (void)(0)
+/*@}*/
+
+/** Watch a descriptor.
+ * The callback runs from WaitForReactor when the descriptor is readable
+ * (or at end of file).
+ * @param fd The descriptor.
+ * @param callback The function to call.
+ * @param data Data to pass to the callback.
+ */
+void RegisterDescriptor(int fd, DescriptorCallback callback, void *data);
+
+/** Stop watching a descriptor.
+ * @param fd The descriptor passed to RegisterDescriptor.
+ */
+void UnregisterDescriptor(int fd);
+
+/** Wait for the X connection to become readable.
+ * Callbacks for other descriptors and signals run while waiting.
+ * @param deadline The time to stop waiting (NULL to wait indefinitely).
+ * @return 1 if the X connection is readable, 0 otherwise.
+ */
+char WaitForReactor(const struct TimeType *deadline);
+
+/** Restore the default signal state.
+ * This should be called in child processes before exec.
+ */
+void ResetChildSignals(void);
+
+#endif /* REACTOR_H */
@@ -14,6 +14,31 @@
 #include "main.h"
 #include "color.h"
 #include "misc.h"
+#include "upload.h"
+#include "drawpool.h"
+
+#ifdef USE_XRENDER
+
+/** Resampling weights for one axis.
+ * Destination pixel i is the weighted sum of count[i] source pixels
+ * starting at start[i].  The weights for each pixel sum to 65536.
+ */
+typedef struct ScaleAxis {
+   int *start;
+   int *count;
+   unsigned *weights;
+   int span;
+} ScaleAxis;
+
+static void CreateScaleAxis(ScaleAxis *axis, int src, int dst);
+static void DestroyScaleAxis(ScaleAxis *axis);
+static void GetSourceRow(const ImageNode *image, const XColor *fg,
+                         int y, unsigned char *row);
+static unsigned long *ScaleRenderImage(const ImageNode *image,
+                                       const XColor *fg,
+                                       int width, int height);
+
+#endif
 
 /** Draw a scaled icon. */
 void PutScaledRenderIcon(const IconNode *icon,
@@ -23,20 +48,15 @@ void PutScaledRenderIcon(const IconNode *icon,
 
 #ifdef USE_XRENDER
 
-   Picture source;
-
    Assert(icon);
    Assert(haveRender);
 
-   source = node->image;
-   if(source != None) {
+   /* The node is already at the requested size, so this is a plain
+    * 1:1 composite with no transform or filter. */
+   if(node->image != None) {
 
       XRenderPictureAttributes pa;
-      XTransform xf;
-      int xscale, yscale;
-      int nwidth, nheight;
       Picture dest;
-      Picture alpha = node->mask;
       XRenderPictFormat *fp = JXRenderFindVisualFormat(display, rootVisual);
       Assert(fp);
 
@@ -45,33 +65,11 @@ void PutScaledRenderIcon(const IconNode *icon,
 
       width = width == 0 ? node->width : width;
       height = height == 0 ? node->height : height;
-      if(icon->preserveAspect) {
-         const int ratio = (icon->width << 16) / icon->height;
-         nwidth = Min(width, (height * ratio) >> 16);
-         nheight = Min(height, (nwidth << 16) / ratio);
-         nwidth = (nheight * ratio) >> 16;
-         nwidth = Max(1, nwidth);
-         nheight = Max(1, nheight);
-         x += (width - nwidth) / 2;
-         y += (height - nheight) / 2;
-      } else {
-         nwidth = width;
-         nheight = height;
-      }
-      xscale = (node->width << 16) / nwidth;
-      yscale = (node->height << 16) / nheight;
+      x += (width - node->width) / 2;
+      y += (height - node->height) / 2;
 
-      memset(&xf, 0, sizeof(xf));
-      xf.matrix[0][0] = xscale;
-      xf.matrix[1][1] = yscale;
-      xf.matrix[2][2] = 65536;
-      XRenderSetPictureTransform(display, source, &xf);
-      XRenderSetPictureFilter(display, source, FilterBest, NULL, 0);
-      XRenderSetPictureTransform(display, alpha, &xf);
-      XRenderSetPictureFilter(display, alpha, FilterBest, NULL, 0);
-
-      JXRenderComposite(display, PictOpOver, source, alpha, dest,
-                        0, 0, 0, 0, x, y, width, height);
+      JXRenderComposite(display, PictOpOver, node->image, None, dest,
+                        0, 0, 0, 0, x, y, node->width, node->height);
 
       JXRenderFreePicture(display, dest);
 
@@ -82,7 +80,8 @@ void PutScaledRenderIcon(const IconNode *icon,
 }
 
 /** Create a scaled icon. */
-ScaledIconNode *CreateScaledRenderIcon(ImageNode *image, long fg)
+ScaledIconNode *CreateScaledRenderIcon(ImageNode *image, long fg,
+                                       int width, int height)
 {
 
    ScaledIconNode *result = NULL;
@@ -90,16 +89,9 @@ ScaledIconNode *CreateScaledRenderIcon(ImageNode *image, long fg)
 #ifdef USE_XRENDER
 
    XRenderPictFormat *fp;
-   XColor color;
-   GC maskGC;
    XImage *destImage;
-   XImage *destMask;
-   Pixmap pmap, mask;
-   const unsigned width = image->width;
-   const unsigned height = image->height;
-   unsigned perLine;
-   int x, y;
-   int maskLine;
+   Pixmap pmap;
+   GC gc;
 
    Assert(haveRender);
 
@@ -107,89 +99,206 @@ ScaledIconNode *CreateScaledRenderIcon(ImageNode *image, long fg)
    result->fg = fg;
    result->width = width;
    result->height = height;
+   result->mask = None;
+
+   destImage = CreateRenderImage(image, fg, width, height);
+
+   /* Render the image data to an ARGB pixmap. */
+   pmap = JXCreatePixmap(display, rootWindow, width, height, 32);
+   gc = GetPoolGC(pmap, 32);
+   UploadImage(pmap, gc, destImage);
+   ReleasePoolGC(gc);
+
+   /* Create the render picture. */
+   fp = JXRenderFindStandardFormat(display, PictStandardARGB32);
+   Assert(fp);
+   result->image = JXRenderCreatePicture(display, pmap, fp, 0, NULL);
+   JXFreePixmap(display, pmap);
+
+#endif
 
-   mask = JXCreatePixmap(display, rootWindow, width, height, 8);
-   maskGC = JXCreateGC(display, mask, 0, NULL);
-   pmap = JXCreatePixmap(display, rootWindow, width, height, rootDepth);
+   return result;
+
+}
+
+/** Convert an image to premultiplied ARGB data for a render picture. */
+XImage *CreateRenderImage(ImageNode *image, long fg, int width, int height)
+{
 
-   destImage = JXCreateImage(display, rootVisual, rootDepth,
-                             ZPixmap, 0, NULL, width, height, 8, 0);
-   destImage->data = Allocate(sizeof(unsigned long) * width * height);
+   XImage *destImage = NULL;
 
-   destMask = JXCreateImage(display, rootVisual, 8, ZPixmap,
-                            0, NULL, width, height, 8, 0);
-   destMask->data = Allocate(width * height);
+#ifdef USE_XRENDER
+
+   XColor color;
+   unsigned long *pixels;
+   int x, y;
 
    if(image->bitmap) {
-      perLine = (image->width >> 3) + ((image->width & 7) ? 1 : 0);
-   } else {
-      perLine = image->width;
+      color.pixel = fg;
+      JXQueryColor(display, rootColormap, &color);
    }
-   maskLine = 0;
+   pixels = ScaleRenderImage(image, &color, width, height);
+
+   destImage = CreateUploadImage(32, width, height);
    for(y = 0; y < height; y++) {
-      const int yindex = y * perLine;
+      const unsigned long *row = &pixels[y * width];
       for(x = 0; x < width; x++) {
-         if(image->bitmap) {
-
-            const int offset = yindex + (x >> 3);
-            const int mask = 1 << (x & 7);
-            unsigned long alpha = 0;
-            if(image->data[offset] & mask) {
-               alpha = 255;
-               XPutPixel(destImage, x, y, fg);
-            }
-            destMask->data[maskLine + x] = alpha;
+         XPutPixel(destImage, x, y, row[x]);
+      }
+   }
+   Release(pixels);
 
-         } else {
+#endif
 
-            const int index = 4 * (yindex + x);
-            const unsigned long alpha = image->data[index];
-            color.red = image->data[index + 1];
-            color.red |= color.red << 8;
-            color.green = image->data[index + 2];
-            color.green |= color.green << 8;
-            color.blue = image->data[index + 3];
-            color.blue |= color.blue << 8;
-
-            color.red = (color.red * alpha) >> 8;
-            color.green = (color.green * alpha) >> 8;
-            color.blue = (color.blue * alpha) >> 8;
-
-            GetColor(&color);
-            XPutPixel(destImage, x, y, color.pixel);
-            destMask->data[maskLine + x] = alpha;
-         }
+   return destImage;
+
+}
+
+#ifdef USE_XRENDER
+
+/** Compute area resampling weights from src pixels to dst pixels.
+ * Each source pixel covers dst units and each destination pixel
+ * covers src units, so the overlaps can be computed exactly.
+ */
+void CreateScaleAxis(ScaleAxis *axis, int src, int dst)
+{
+   int i;
+
+   axis->span = src / dst + 2;
+   axis->start = Allocate(sizeof(int) * dst);
+   axis->count = Allocate(sizeof(int) * dst);
+   axis->weights = Allocate(sizeof(unsigned) * dst * axis->span);
+
+   for(i = 0; i < dst; i++) {
+      const unsigned long lo = (unsigned long)i * src;
+      const unsigned long hi = lo + src;
+      const int first = lo / dst;
+      const int last = (hi - 1) / dst;
+      unsigned *weights = &axis->weights[i * axis->span];
+      unsigned total = 0;
+      int j;
+
+      axis->start[i] = first;
+      axis->count[i] = last - first + 1;
+      for(j = first; j < last; j++) {
+         const unsigned long end = (unsigned long)(j + 1) * dst;
+         const unsigned long begin = Max((unsigned long)j * dst, lo);
+         weights[j - first] = ((end - begin) << 16) / src;
+         total += weights[j - first];
       }
-      maskLine += destMask->bytes_per_line;
+      weights[last - first] = 65536 - total;
    }
+}
 
-   /* Render the image data to the image pixmap. */
-   JXPutImage(display, pmap, rootGC, destImage, 0, 0, 0, 0, width, height);
-   Release(destImage->data);
-   destImage->data = NULL;
-   JXDestroyImage(destImage);
-
-   /* Render the alpha data to the mask pixmap. */
-   JXPutImage(display, mask, maskGC, destMask, 0, 0, 0, 0, width, height);
-   Release(destMask->data);
-   destMask->data = NULL;
-   JXDestroyImage(destMask);
-   JXFreeGC(display, maskGC);
-
-   /* Create the alpha picture. */
-   fp = JXRenderFindStandardFormat(display, PictStandardA8);
-   Assert(fp);
-   result->mask = JXRenderCreatePicture(display, mask, fp, 0, NULL);
-   JXFreePixmap(display, mask);
+/** Release resampling weights. */
+void DestroyScaleAxis(ScaleAxis *axis)
+{
+   Release(axis->start);
+   Release(axis->count);
+   Release(axis->weights);
+}
 
-   /* Create the render picture. */
-   fp = JXRenderFindVisualFormat(display, rootVisual);
-   Assert(fp);
-   result->image = JXRenderCreatePicture(display, pmap, fp, 0, NULL);
-   JXFreePixmap(display, pmap);
+/** Get a row of the source image as premultiplied ARGB bytes. */
+void GetSourceRow(const ImageNode *image, const XColor *fg,
+                  int y, unsigned char *row)
+{
+   int x;
+   if(image->bitmap) {
+      const int perLine = (image->width >> 3) + ((image->width & 7) ? 1 : 0);
+      const unsigned char *src = &image->data[y * perLine];
+      for(x = 0; x < image->width; x++) {
+         if(src[x >> 3] & (1 << (x & 7))) {
+            row[0] = 255;
+            row[1] = fg->red >> 8;
+            row[2] = fg->green >> 8;
+            row[3] = fg->blue >> 8;
+         } else {
+            row[0] = row[1] = row[2] = row[3] = 0;
+         }
+         row += 4;
+      }
+   } else {
+      const unsigned char *src = &image->data[4 * y * image->width];
+      for(x = 0; x < image->width; x++) {
+         const unsigned alpha = src[0];
+         row[0] = alpha;
+         row[1] = (src[1] * alpha + 127) / 255;
+         row[2] = (src[2] * alpha + 127) / 255;
+         row[3] = (src[3] * alpha + 127) / 255;
+         row += 4;
+         src += 4;
+      }
+   }
+}
 
-#endif
+/** Resample an image to premultiplied ARGB pixels.
+ * This uses a separable area filter, which averages every source pixel
+ * covered by a destination pixel when downscaling.
+ */
+unsigned long *ScaleRenderImage(const ImageNode *image, const XColor *fg,
+                                int width, int height)
+{
+   ScaleAxis xaxis, yaxis;
+   unsigned char *row;
+   unsigned *temp;
+   unsigned long *result;
+   int x, y, c;
+
+   CreateScaleAxis(&xaxis, image->width, width);
+   CreateScaleAxis(&yaxis, image->height, height);
+
+   /* Horizontal pass, keeping 8 extra bits of precision. */
+   row = Allocate(4 * image->width);
+   temp = Allocate(sizeof(unsigned) * 4 * width * image->height);
+   for(y = 0; y < image->height; y++) {
+      unsigned *dest = &temp[4 * y * width];
+      GetSourceRow(image, fg, y, row);
+      for(x = 0; x < width; x++) {
+         const unsigned char *src = &row[4 * xaxis.start[x]];
+         const unsigned *weights = &xaxis.weights[x * xaxis.span];
+         unsigned sum[4] = { 0, 0, 0, 0 };
+         int i;
+         for(i = 0; i < xaxis.count[x]; i++) {
+            for(c = 0; c < 4; c++) {
+               sum[c] += weights[i] * src[c];
+            }
+            src += 4;
+         }
+         for(c = 0; c < 4; c++) {
+            dest[c] = sum[c] >> 8;
+         }
+         dest += 4;
+      }
+   }
+   Release(row);
 
-   return result;
+   /* Vertical pass. */
+   result = Allocate(sizeof(unsigned long) * width * height);
+   for(y = 0; y < height; y++) {
+      const unsigned *weights = &yaxis.weights[y * yaxis.span];
+      unsigned long *dest = &result[y * width];
+      for(x = 0; x < width; x++) {
+         const unsigned *src = &temp[4 * (yaxis.start[y] * width + x)];
+         unsigned sum[4] = { 0, 0, 0, 0 };
+         int i;
+         for(i = 0; i < yaxis.count[y]; i++) {
+            for(c = 0; c < 4; c++) {
+               sum[c] += weights[i] * src[c];
+            }
+            src += 4 * width;
+         }
+         for(c = 0; c < 4; c++) {
+            sum[c] = (sum[c] + (1 << 23)) >> 24;
+         }
+         dest[x] = ((unsigned long)sum[0] << 24) | (sum[1] << 16)
+                 | (sum[2] << 8) | sum[3];
+      }
+   }
+   Release(temp);
 
+   DestroyScaleAxis(&xaxis);
+   DestroyScaleAxis(&yaxis);
+   return result;
 }
+
+#endif /* USE_XRENDER */
@@ -15,6 +15,7 @@ struct ImageNode;
 struct ScaledIconNode;
 
 /** Put a scaled icon.
+ * The icon is centered in the specified area without further scaling.
  * @param image The image to display.
  * @param node The rendered image to display.
  * @param d The drawable on which to render the icon.
@@ -29,10 +30,26 @@ void PutScaledRenderIcon(const struct IconNode *image,
                          Drawable d, int x, int y, int width, int height);
 
 /** Create a scaled icon.
+ * The image is resampled on the client to an ARGB picture of the
+ * requested size, so drawing it requires no transform.
  * @param image The image.
  * @param fg The foreground color (for bitmaps).
+ * @param width The width of the scaled icon.
+ * @param height The height of the scaled icon.
  * @return The scaled icon.
  */
-struct ScaledIconNode *CreateScaledRenderIcon(struct ImageNode *image, long fg);
+struct ScaledIconNode *CreateScaledRenderIcon(struct ImageNode *image, long fg,
+                                              int width, int height);
+
+/** Convert an image to premultiplied ARGB data for a render picture.
+ * This is the client side part of CreateScaledRenderIcon.
+ * @param image The image.
+ * @param fg The foreground color (for bitmaps).
+ * @param width The width of the result.
+ * @param height The height of the result.
+ * @return A 32-bit image from CreateUploadImage (NULL without XRender).
+ */
+XImage *CreateRenderImage(struct ImageNode *image, long fg,
+                          int width, int height);
 
 #endif /* RENDER_H */
@@ -207,7 +207,6 @@ void ResizeClient(ClientNode *np, MouseContextType context,
             UpdateResizeWindow(np, gwidth, gheight);
 
             if(settings.resizeMode == RESIZE_OUTLINE) {
-               ClearOutline();
                if(np->state.status & STAT_SHADED) {
                   DrawOutline(np->x - west, np->y - north,
                      np->width + west + east, north + south);
@@ -390,7 +389,6 @@ void ResizeClientKeyboard(ClientNode *np, MouseContextType context)
          UpdateResizeWindow(np, gwidth, gheight);
 
          if(settings.resizeMode == RESIZE_OUTLINE) {
-            ClearOutline();
             if(np->state.status & STAT_SHADED) {
                DrawOutline(np->x - west, np->y - north,
                   np->width + west + east,
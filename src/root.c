@@ -19,6 +19,9 @@
 #include "parse.h"
 #include "settings.h"
 #include "desktop.h"
+#include "icon.h"
+#include "grab.h"
+#include "event.h"
 
 /** Number of root menus to support. */
 #define ROOT_MENU_COUNT 36
@@ -242,6 +245,31 @@ void ReloadMenu(void)
    }
 }
 
+/** Report cache usage and other statistics on stderr. */
+void ShowStatistics(void)
+{
+   unsigned entries;
+   unsigned long bytes;
+   unsigned long limit;
+   unsigned grabs;
+   unsigned long grabTime;
+   unsigned long grabLongest;
+   unsigned long wakeups;
+   unsigned long idleWakeups;
+
+   GetIconCacheUsage(&entries, &bytes, &limit);
+   fprintf(stderr, _("JWM: icon cache: %u scaled icons, %lu of %lu KiB\n"),
+           entries, bytes / 1024, limit / 1024);
+
+   GetGrabStatistics(&grabs, &grabTime, &grabLongest);
+   fprintf(stderr, _("JWM: server grabs: %u, %lu ms total, %lu ms longest\n"),
+           grabs, grabTime, grabLongest);
+
+   GetWakeupStatistics(&wakeups, &idleWakeups);
+   fprintf(stderr, _("JWM: wakeups: %lu, %lu without X events\n"),
+           wakeups, idleWakeups);
+}
+
 /** Root menu callback. */
 void RunRootCommand(MenuAction *action, unsigned button)
 {
@@ -67,5 +67,8 @@ void Exit(char confirm);
 /** Reload the menu. */
 void ReloadMenu(void);
 
+/** Report cache usage and other statistics on stderr. */
+void ShowStatistics(void);
+
 #endif /* ROOT_H */
 
@@ -323,6 +323,34 @@ int SFT_X_get_string_width(SFT_X * sft_x, const char * text_string)
 
 int SFT_X_draw_string32(Display * dpy, Drawable d, int x, int y, XRenderColor * fg,
                         SFT_X * sft_x, const char * text_string, int max_width)
+{
+	Pixmap fgpix = XCreatePixmap(dpy, d, 1, 1, 24);
+//	Pixmap fgpix = XCreatePixmap(dpy, d, 1, 1, 32);
+	XRenderPictureAttributes attr = { .repeat = True };
+	XRenderPictFormat *fmt = XRenderFindStandardFormat(dpy, PictStandardRGB24);
+//	fmt = XRenderFindStandardFormat(dpy, PictStandardARGB32);
+	Picture fgpic = XRenderCreatePicture(dpy, fgpix, fmt, CPRepeat, &attr);
+	int result;
+
+	XRenderFillRectangle(dpy, PictOpSrc, fgpic, fg, 0, 0, 1, 1);
+	result = SFT_X_draw_string32_pen(dpy, d, x, y, fgpic, sft_x, text_string, max_width);
+
+	XRenderFreePicture(dpy, fgpic);
+	XFreePixmap(dpy, fgpix);
+	return result;
+}
+
+/* ***************************************************
+ * SFT_X_draw_string32_pen
+ *
+ * Same as SFT_X_draw_string32, but the text is drawn with
+ * a repeating source picture (a "pen") owned by the caller,
+ * so the caller can keep one pen per color.
+ *
+ */
+
+int SFT_X_draw_string32_pen(Display * dpy, Drawable d, int x, int y, Picture pen,
+                            SFT_X * sft_x, const char * text_string, int max_width)
 {
 	XRectangle rect;
 	Region r;
@@ -333,13 +361,6 @@ int SFT_X_draw_string32(Display * dpy, Drawable d, int x, int y, XRenderColor *
 	int width = 0;
 	XRenderPictFormat *fmt = XRenderFindVisualFormat(dpy, DefaultVisual(dpy, screen));
 	Picture topic =XRenderCreatePicture (dpy, d, fmt, 0, NULL);
-	Pixmap fgpix = XCreatePixmap(dpy, d, 1, 1, 24);
-//	Pixmap fgpix = XCreatePixmap(dpy, d, 1, 1, 32);
-	XRenderPictureAttributes attr = { .repeat = True };
-	fmt = XRenderFindStandardFormat(dpy, PictStandardRGB24);
-//	fmt = XRenderFindStandardFormat(dpy, PictStandardARGB32);
-	Picture fgpic = XRenderCreatePicture(dpy, fgpix, fmt, CPRepeat, &attr);
-//	XRenderFillRectangle(dpy, PictOpSrc, fgpic, fg, 0, 0, 200, 200);
 
 	fmt = XRenderFindStandardFormat(dpy, PictStandardA8);
 	GlyphSet glyphset = XRenderCreateGlyphSet(dpy, fmt);
@@ -363,14 +384,11 @@ int SFT_X_draw_string32(Display * dpy, Drawable d, int x, int y, XRenderColor *
     //XRenderColor fg1 = { 0x5555, 0xa4a4, 0x1616, 0xFFFF } ;//, bg = { 0, 0, 0, 0xffff};
     //XRenderFillRectangle(dpy, PictOpOver, topic, &fg1, x  , (int) (y), rect.width  , (int) (sft_x->ascent+sft_x->descent));
     /* End debugging clip region: draw a rectangle around the region supposed to contain the string */
-	XRenderFillRectangle(dpy, PictOpSrc, fgpic, fg, 0, 0, rect.width, rect.height);
 	XRenderSetPictureClipRegion(dpy, topic,  r);
-	XRenderCompositeString32(dpy, PictOpOver, fgpic, topic, NULL, glyphset, 0, 0, x, y + sft_x->ascent, codepoints, n);
+	XRenderCompositeString32(dpy, PictOpOver, pen, topic, NULL, glyphset, 0, 0, x, y + sft_x->ascent, codepoints, n);
 
-	XRenderFreePicture(dpy, fgpic);
 	XRenderFreePicture(dpy, topic);
 	XRenderFreeGlyphSet (dpy, glyphset);
-	XFreePixmap(dpy, fgpix);
 	XDestroyRegion(r);
 	return 0;
 }
@@ -57,6 +57,9 @@ int SFT_X_get_string_width(SFT_X * sft_x, const char * text_string);
 int SFT_X_draw_string32(Display * dpy, Drawable d, int x, int y, XRenderColor * fg,
                         SFT_X * sft_x, const char * text_string, int max_width);
 
+int SFT_X_draw_string32_pen(Display * dpy, Drawable d, int x, int y, Picture pen,
+                            SFT_X * sft_x, const char * text_string, int max_width);
+
 void SFT_X_free(SFT_X * sft_x);
 
 /* These should be private and only be called if SFT_X_create_from_file is not used !!! */ 
@@ -45,6 +45,7 @@ void InitializeSettings(void)
    settings.resizeMode = RESIZE_OPAQUE;
    settings.popupDelay = 600;
    settings.desktopDelay = 1000;
+   settings.titleDelay = 250;
    settings.trayOpacity = UINT_MAX;
    settings.popupMask = POPUP_ALL;
    settings.activeClientOpacity = UINT_MAX;
@@ -63,6 +64,8 @@ void InitializeSettings(void)
    settings.groupTasks = 0;
    settings.listAllTasks = 0;
    settings.dockSpacing = 0;
+   settings.iconCacheSize = 0;
+   settings.backgroundCacheSize = 65536;
    settings.showClientName = 0;
    memcpy(settings.clientNameDelimiters, DEFAULT_CLIENT_NAME_DELIMITERS,
       sizeof(settings.clientNameDelimiters));
@@ -77,6 +80,7 @@ void StartupSettings(void)
 
    FixRange(&settings.borderWidth, 1, 128, 4);
    FixRange(&settings.titleHeight, 0, 256, 0);
+   FixRange(&settings.titleDelay, 0, 10000, 250);
 
    FixRange(&settings.doubleClickDelta, 0, 64, 2);
    FixRange(&settings.doubleClickSpeed, 1, 2000, 400);
@@ -90,6 +94,10 @@ void StartupSettings(void)
    }
 
    FixRange(&settings.dockSpacing, 0, 64, 0);
+   if(settings.iconCacheSize != 0) {
+      FixRange(&settings.iconCacheSize, 256, 1048576, 0);
+   }
+   FixRange(&settings.backgroundCacheSize, 1024, 4194304, 65536);
 }
 
 /** Update a string setting. */
@@ -105,8 +105,11 @@ typedef struct {
    unsigned desktopCount;
    unsigned menuOpacity;
    unsigned desktopDelay;
+   unsigned titleDelay;
    unsigned moveMask;
    unsigned dockSpacing;
+   unsigned iconCacheSize;
+   unsigned backgroundCacheSize;
    AlignmentType titleTextAlignment;
    SnapModeType snapMode;
    MoveModeType moveMode;
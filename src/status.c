@@ -15,6 +15,7 @@
 #include "client.h"
 #include "settings.h"
 #include "hint.h"
+#include "drawpool.h"
 
 static Window statusWindow;
 static Pixmap statusPixmap;
@@ -92,8 +93,8 @@ void CreateMoveResizeWindow(const ClientNode *np, StatusWindowType type)
       attrMask, &attrs);
    SetAtomAtom(statusWindow, ATOM_NET_WM_WINDOW_TYPE,
                ATOM_NET_WM_WINDOW_TYPE_NOTIFICATION);
-   statusPixmap = JXCreatePixmap(display, statusWindow,
-      statusWindowWidth, statusWindowHeight, rootDepth);
+   statusPixmap = GetScratchPixmap(rootDepth, statusWindowWidth,
+                                   statusWindowHeight);
 
    JXMapRaised(display, statusWindow);
 
@@ -155,7 +156,7 @@ void DestroyMoveResizeWindow(void)
       statusWindow = None;
    }
    if(statusPixmap != None) {
-      JXFreePixmap(display, statusPixmap);
+      ReleaseScratchPixmap(statusPixmap);
       statusPixmap = None;
    }
 }
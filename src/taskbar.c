@@ -27,6 +27,14 @@
 #include "misc.h"
 #include "desktop.h"
 
+/** What was last drawn for an item on a task bar. */
+typedef struct TaskSlot {
+   const IconNode *icon;      /**< The icon. */
+   unsigned long textHash;    /**< Hash of the label (0 for none). */
+   ButtonType type;           /**< Focus, minimized, and urgent state. */
+   int x, y;                  /**< Location on the task bar. */
+} TaskSlot;
+
 typedef struct TaskBarType {
 
    TrayComponentType *cp;
@@ -42,6 +50,13 @@ typedef struct TaskBarType {
 
    Pixmap buffer;
 
+   TaskSlot *slots;     /**< Items drawn on the buffer. */
+   unsigned slotCount;  /**< Number of items drawn. */
+   unsigned slotMax;    /**< Number of slots allocated. */
+   int slotWidth;       /**< Item width used for the slots. */
+   int slotHeight;      /**< Item height used for the slots. */
+   char redraw;         /**< Set to redraw the whole task bar. */
+
    TimeType mouseTime;
    int mousex, mousey;
 
@@ -63,12 +78,27 @@ static TaskBarType *bars;
 static TaskEntry *taskEntries;
 static TaskEntry *taskEntriesTail;
 
+/** Contents last written to a client list property on the root. */
+typedef struct ClientListType {
+   Window *windows;     /**< NULL if not yet written. */
+   unsigned int count;
+} ClientListType;
+
+static ClientListType clientList;
+static ClientListType stackingList;
+
 static unsigned TallyVisibleItems(void);
 static void ComputeItemSize(TaskBarType *tp);
 static char ShouldShowEntry(const TaskEntry *tp);
 static char ShouldFocusEntry(const TaskEntry *tp);
 static TaskEntry *GetEntry(TaskBarType *bar, int x, int y);
-static void Render(const TaskBarType *bp);
+static void Render(TaskBarType *bp);
+static void RenderEntry(TaskBarType *bp, const TaskEntry *tp,
+                        ButtonNode *button, unsigned index,
+                        XRectangle *damage);
+static void AddDamage(XRectangle *damage, int x, int y,
+                      int width, int height);
+static unsigned long HashString(const char *str);
 static void ShowClientList(TaskBarType *bar, TaskEntry *tp);
 static void RunTaskBarCommand(MenuAction *action, unsigned button);
 
@@ -82,8 +112,12 @@ static void FocusGroup(const TaskEntry *tp);
 static char IsGroupOnTop(const TaskEntry *entry);
 static void ProcessTaskMotionEvent(TrayComponentType *cp,
                                    int x, int y, int mask);
+static void ProcessTaskLeaveEvent(TrayComponentType *cp);
 static void SignalTaskbar(const TimeType *now, int x, int y, Window w,
                           void *data);
+static void WriteClientList(ClientListType *lp, AtomType atom,
+                            Window *windows, unsigned int count);
+static void ReleaseClientList(ClientListType *lp);
 
 /** Initialize task bar data. */
 void InitializeTaskBar(void)
@@ -91,6 +125,10 @@ void InitializeTaskBar(void)
    bars = NULL;
    taskEntries = NULL;
    taskEntriesTail = NULL;
+   clientList.windows = NULL;
+   clientList.count = 0;
+   stackingList.windows = NULL;
+   stackingList.count = 0;
 }
 
 /** Shutdown the task bar. */
@@ -109,9 +147,14 @@ void DestroyTaskBar(void)
    while(bars) {
       bp = bars->next;
       UnregisterCallback(SignalTaskbar, bars);
+      if(bars->slots) {
+         Release(bars->slots);
+      }
       Release(bars);
       bars = bp;
    }
+   ReleaseClientList(&clientList);
+   ReleaseClientList(&stackingList);
 }
 
 /** Create a new task bar tray component. */
@@ -135,6 +178,12 @@ TrayComponentType *CreateTaskBar()
    tp->mousey = -settings.doubleClickDelta;
    tp->mouseTime.seconds = 0;
    tp->mouseTime.ms = 0;
+   tp->slots = NULL;
+   tp->slotCount = 0;
+   tp->slotMax = 0;
+   tp->slotWidth = 0;
+   tp->slotHeight = 0;
+   tp->redraw = 1;
 
    cp = CreateTrayComponent();
    cp->object = tp;
@@ -145,8 +194,9 @@ TrayComponentType *CreateTaskBar()
    cp->Resize = Resize;
    cp->ProcessButtonPress = ProcessTaskButtonEvent;
    cp->ProcessMotionEvent = ProcessTaskMotionEvent;
+   cp->ProcessLeaveEvent = ProcessTaskLeaveEvent;
 
-   RegisterCallback(settings.popupDelay / 2, SignalTaskbar, tp);
+   RegisterCallback(CALLBACK_SCHEDULED, SignalTaskbar, tp);
 
    return cp;
 
@@ -174,6 +224,7 @@ void Create(TrayComponentType *cp)
    cp->pixmap = JXCreatePixmap(display, rootWindow, cp->width, cp->height,
                                rootDepth);
    tp->buffer = cp->pixmap;
+   tp->redraw = 1;
    ClearTrayDrawable(cp);
 }
 
@@ -187,6 +238,7 @@ void Resize(TrayComponentType *cp)
    cp->pixmap = JXCreatePixmap(display, rootWindow, cp->width, cp->height,
                                rootDepth);
    tp->buffer = cp->pixmap;
+   tp->redraw = 1;
    ClearTrayDrawable(cp);
 }
 
@@ -489,9 +541,21 @@ void FocusGroup(const TaskEntry *tp)
 void ProcessTaskMotionEvent(TrayComponentType *cp, int x, int y, int mask)
 {
    TaskBarType *bp = (TaskBarType*)cp->object;
+   TimeType popupTime;
    bp->mousex = cp->screenx + x;
    bp->mousey = cp->screeny + y;
    GetCurrentTime(&bp->mouseTime);
+
+   /* Show a popup if the mouse stays here. */
+   popupTime = bp->mouseTime;
+   AddTime(&popupTime, settings.popupDelay);
+   ScheduleCallback(SignalTaskbar, bp, &popupTime);
+}
+
+/** Process the mouse leaving the tray. */
+void ProcessTaskLeaveEvent(TrayComponentType *cp)
+{
+   CancelCallback(SignalTaskbar, cp->object);
 }
 
 /** Show the menu associated with a task list item. */
@@ -788,22 +852,39 @@ void SignalTaskbar(const TimeType *now, int x, int y, Window w, void *data)
 
 }
 
-/** Draw a specific task bar. */
-void Render(const TaskBarType *bp)
+/** Redraw all items on all task bars. */
+void InvalidateTaskBar(void)
+{
+   TaskBarType *bp;
+   for(bp = bars; bp; bp = bp->next) {
+      bp->redraw = 1;
+   }
+}
+
+/** Draw a specific task bar.
+ * Only items that look different from the last time they were drawn
+ * are redrawn, and the area that changed is copied to the tray.
+ */
+void Render(TaskBarType *bp)
 {
    TaskEntry *tp;
-   char *displayName;
    ButtonNode button;
-   int x, y;
+   XRectangle damage;
+   unsigned index;
 
    if(JUNLIKELY(shouldExit)) {
       return;
    }
 
-   ClearTrayDrawable(bp->cp);
-   if(!taskEntries) {
-      UpdateSpecificTray(bp->cp->tray, bp->cp);
-      return;
+   /* Items move if their size changes. */
+   if(bp->slotWidth != bp->itemWidth || bp->slotHeight != bp->itemHeight) {
+      bp->slotWidth = bp->itemWidth;
+      bp->slotHeight = bp->itemHeight;
+      bp->redraw = 1;
+   }
+   if(bp->redraw) {
+      ClearTrayDrawable(bp->cp);
+      bp->slotCount = 0;
    }
 
    ResetButton(&button, bp->cp->pixmap);
@@ -814,76 +895,158 @@ void Render(const TaskBarType *bp)
    button.labelPos = bp->labelPos;
    button.text = NULL;
 
-   x = 0;
-   y = 0;
+   damage.width = 0;
+   damage.height = 0;
+   index = 0;
    for(tp = taskEntries; tp; tp = tp->next) {
-
-      if(!ShouldShowEntry(tp)) {
-         continue;
+      if(ShouldShowEntry(tp)) {
+         RenderEntry(bp, tp, &button, index, &damage);
+         index += 1;
       }
+   }
 
-      /* Check for an active or urgent window and count clients. */
-      ClientEntry *cp;
-      unsigned clientCount = 0;
-      button.type = BUTTON_TASK;
-      for(cp = tp->clients; cp; cp = cp->next) {
-         if(ShouldFocus(cp->client, 0)) {
-            const char flash = (cp->client->state.status & STAT_FLASH) != 0;
-            const char active = (cp->client->state.status & STAT_ACTIVE)
-               && IsClientOnCurrentDesktop(cp->client);
-            const char minimized = (cp->client->state.status & STAT_MINIMIZED);
-            if(flash || active) {
-               if(button.type != BUTTON_TASK_ACTIVE) {
-                  button.type = BUTTON_TASK_ACTIVE;
-               } else if(minimized) {
-                  button.type = BUTTON_TASK_MINIMIZED;
-               } else {
-                  button.type = BUTTON_TASK;
-               }
+   /* Clear items that are no longer shown. */
+   while(bp->slotCount > index) {
+      const TaskSlot *sp;
+      bp->slotCount -= 1;
+      sp = &bp->slots[bp->slotCount];
+      ClearTrayArea(bp->cp, sp->x, sp->y, bp->itemWidth, bp->itemHeight);
+      AddDamage(&damage, sp->x, sp->y, bp->itemWidth, bp->itemHeight);
+   }
+
+   if(bp->redraw) {
+      bp->redraw = 0;
+      UpdateSpecificTray(bp->cp->tray, bp->cp);
+   } else if(damage.width > 0 && damage.height > 0) {
+      UpdateSpecificTrayArea(bp->cp->tray, bp->cp, damage.x, damage.y,
+                             damage.width, damage.height);
+   }
+
+}
+
+/** Draw an item on a task bar if it changed. */
+void RenderEntry(TaskBarType *bp, const TaskEntry *tp, ButtonNode *button,
+                 unsigned index, XRectangle *damage)
+{
+   ClientEntry *cp;
+   char *displayName;
+   TaskSlot slot;
+   TaskSlot *sp;
+   unsigned clientCount = 0;
+
+   /* Check for an active or urgent window and count clients. */
+   button->type = BUTTON_TASK;
+   for(cp = tp->clients; cp; cp = cp->next) {
+      if(ShouldFocus(cp->client, 0)) {
+         const char flash = (cp->client->state.status & STAT_FLASH) != 0;
+         const char active = (cp->client->state.status & STAT_ACTIVE)
+            && IsClientOnCurrentDesktop(cp->client);
+         const char minimized = (cp->client->state.status & STAT_MINIMIZED);
+         if(flash || active) {
+            if(button->type != BUTTON_TASK_ACTIVE) {
+               button->type = BUTTON_TASK_ACTIVE;
             } else if(minimized) {
-               button.type = BUTTON_TASK_MINIMIZED;
+               button->type = BUTTON_TASK_MINIMIZED;
+            } else {
+               button->type = BUTTON_TASK;
             }
-            clientCount += 1;
+         } else if(minimized) {
+            button->type = BUTTON_TASK_MINIMIZED;
          }
+         clientCount += 1;
       }
-      button.x = x;
-      button.y = y;
-      if(!tp->clients->client || !tp->clients->client->icon) {
-         button.icon = GetDefaultIcon();
-      } else {
-         button.icon = tp->clients->client->icon;
-      }
-      displayName = NULL;
-      if(bp->labeled) {
-         if(tp->clients->client->className && settings.groupTasks) {
-            if(clientCount != 1) {
-               const size_t len = strlen(tp->clients->client->className) + 16;
-               displayName = Allocate(len);
-               snprintf(displayName, len, "%s (%u)",
-                        tp->clients->client->className, clientCount);
-               button.text = displayName;
-            } else {
-               button.text = tp->clients->client->className;
-            }
+   }
+   if(bp->layout == LAYOUT_HORIZONTAL) {
+      button->x = index * bp->itemWidth;
+      button->y = 0;
+   } else {
+      button->x = 0;
+      button->y = index * bp->itemHeight;
+   }
+   if(!tp->clients->client || !tp->clients->client->icon) {
+      button->icon = GetDefaultIcon();
+   } else {
+      button->icon = tp->clients->client->icon;
+   }
+   displayName = NULL;
+   button->text = NULL;
+   if(bp->labeled) {
+      if(tp->clients->client->className && settings.groupTasks) {
+         if(clientCount != 1) {
+            const size_t len = strlen(tp->clients->client->className) + 16;
+            displayName = Allocate(len);
+            snprintf(displayName, len, "%s (%u)",
+                     tp->clients->client->className, clientCount);
+            button->text = displayName;
          } else {
-            button.text = tp->clients->client->name;
+            button->text = tp->clients->client->className;
          }
+      } else {
+         button->text = tp->clients->client->name;
       }
-      DrawButton(&button);
+   }
 
-      if(displayName) {
-         Release(displayName);
+   /* Compare with what was drawn last time. */
+   slot.icon = button->icon;
+   slot.textHash = HashString(button->text);
+   slot.type = button->type;
+   slot.x = button->x;
+   slot.y = button->y;
+   if(index >= bp->slotMax) {
+      bp->slotMax = Max(8, bp->slotMax * 2);
+      bp->slots = Reallocate(bp->slots, sizeof(TaskSlot) * bp->slotMax);
+   }
+   sp = &bp->slots[index];
+   if(index >= bp->slotCount || sp->icon != slot.icon
+      || sp->textHash != slot.textHash || sp->type != slot.type
+      || sp->x != slot.x || sp->y != slot.y) {
+      if(!bp->redraw) {
+         ClearTrayArea(bp->cp, button->x, button->y,
+                       button->width, button->height);
       }
+      DrawButton(button);
+      AddDamage(damage, button->x, button->y,
+                button->width, button->height);
+      *sp = slot;
+      bp->slotCount = Max(bp->slotCount, index + 1);
+   }
 
-      if(bp->layout == LAYOUT_HORIZONTAL) {
-         x += bp->itemWidth;
-      } else {
-         y += bp->itemHeight;
-      }
+   if(displayName) {
+      Release(displayName);
    }
+}
 
-   UpdateSpecificTray(bp->cp->tray, bp->cp);
+/** Add an area to the damaged rectangle. */
+void AddDamage(XRectangle *damage, int x, int y, int width, int height)
+{
+   if(damage->width > 0 && damage->height > 0) {
+      const int x2 = Max(damage->x + damage->width, x + width);
+      const int y2 = Max(damage->y + damage->height, y + height);
+      x = Min(damage->x, x);
+      y = Min(damage->y, y);
+      width = x2 - x;
+      height = y2 - y;
+   }
+   damage->x = x;
+   damage->y = y;
+   damage->width = width;
+   damage->height = height;
+}
 
+/** Hash a label (FNV-1a).  NULL hashes to 0. */
+unsigned long HashString(const char *str)
+{
+   unsigned long hash;
+   if(!str) {
+      return 0;
+   }
+   hash = 2166136261UL;
+   while(*str) {
+      hash ^= (unsigned char)*str;
+      hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+      str += 1;
+   }
+   return hash | 1;
 }
 
 /** Focus the next client in the task bar. */
@@ -1105,14 +1268,8 @@ void UpdateNetClientList(void)
    unsigned int count;
    int layer;
 
-   /* Determine how much we need to allocate. */
-   if(clientCount == 0) {
-      windows = NULL;
-   } else {
-      windows = AllocateStack(clientCount * sizeof(Window));
-   }
-
    /* Set _NET_CLIENT_LIST */
+   windows = Allocate((clientCount + 1) * sizeof(Window));
    count = 0;
    for(tp = taskEntries; tp; tp = tp->next) {
       ClientEntry *cp;
@@ -1122,11 +1279,10 @@ void UpdateNetClientList(void)
       }
    }
    Assert(count <= clientCount);
-   JXChangeProperty(display, rootWindow, atoms[ATOM_NET_CLIENT_LIST],
-                    XA_WINDOW, 32, PropModeReplace,
-                    (unsigned char*)windows, count);
+   WriteClientList(&clientList, ATOM_NET_CLIENT_LIST, windows, count);
 
    /* Set _NET_CLIENT_LIST_STACKING */
+   windows = Allocate((clientCount + 1) * sizeof(Window));
    count = 0;
    for(layer = FIRST_LAYER; layer <= LAST_LAYER; layer++) {
       for(client = nodes[layer]; client; client = client->next) {
@@ -1134,12 +1290,44 @@ void UpdateNetClientList(void)
          count += 1;
       }
    }
-   JXChangeProperty(display, rootWindow, atoms[ATOM_NET_CLIENT_LIST_STACKING],
-                    XA_WINDOW, 32, PropModeReplace,
-                    (unsigned char*)windows, count);
+   WriteClientList(&stackingList, ATOM_NET_CLIENT_LIST_STACKING,
+                   windows, count);
 
-   if(windows != NULL) {
-      ReleaseStack(windows);
+}
+
+/** Write a client list property if it changed.
+ * Every write causes a PropertyNotify for each pager and panel, so
+ * nothing is written if the list is unchanged and new windows at the
+ * end are appended.  Anything else rewrites the whole property.
+ * This takes ownership of windows.
+ */
+void WriteClientList(ClientListType *lp, AtomType atom,
+                     Window *windows, unsigned int count)
+{
+   const size_t oldSize = lp->count * sizeof(Window);
+   if(lp->windows && count >= lp->count
+      && !memcmp(lp->windows, windows, oldSize)) {
+      if(count > lp->count) {
+         JXChangeProperty(display, rootWindow, atoms[atom], XA_WINDOW, 32,
+                          PropModeAppend,
+                          (unsigned char*)&windows[lp->count],
+                          count - lp->count);
+      }
+   } else {
+      JXChangeProperty(display, rootWindow, atoms[atom], XA_WINDOW, 32,
+                       PropModeReplace, (unsigned char*)windows, count);
+   }
+   ReleaseClientList(lp);
+   lp->windows = windows;
+   lp->count = count;
+}
+
+/** Forget the contents of a client list property. */
+void ReleaseClientList(ClientListType *lp)
+{
+   if(lp->windows) {
+      Release(lp->windows);
+      lp->windows = NULL;
    }
-   
+   lp->count = 0;
 }
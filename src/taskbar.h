@@ -36,6 +36,11 @@ void RemoveClientFromTaskBar(struct ClientNode *np);
 /** Update all task bars. */
 void UpdateTaskBar(void);
 
+/** Redraw every item on the next task bar update.
+ * This is needed when the icon of a client is replaced.
+ */
+void InvalidateTaskBar(void);
+
 /** Focus the client in the task bar.
  * @param n The window position in the taskbar.
  */
@@ -71,7 +76,9 @@ void SetTaskBarLabeled(struct TrayComponentType *cp, char value);
  */
 void SetTaskBarLabelPosition(struct TrayComponentType *cp, const char *value);
 
-/** Update the _NET_CLIENT_LIST property. */
+/** Update the _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING properties.
+ * The properties are only written if their contents changed.
+ */
 void UpdateNetClientList(void);
 
 #endif /* TASKBAR_H */
@@ -0,0 +1,441 @@
+/**
+ * @file thumbnail.c
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Window thumbnails for the pager.
+ *
+ * Client windows are redirected with the Composite extension so their
+ * contents can be read with XCompositeNameWindowPixmap.  Each client
+ * keeps a thumbnail picture at the size it is shown on the pager, which
+ * is scaled down on the server with an XRender transform.  Thumbnails
+ * are refreshed only after a Damage event, at most once per
+ * THUMBNAIL_INTERVAL for each window and at most THUMBNAIL_BUDGET times
+ * for each pager redraw.
+ *
+ * "make check-thumbnails" runs check-thumbnails.sh, which maps a
+ * window under Xvfb (which provides Composite, Damage, and RENDER) and
+ * checks that the pager shows its contents, and that starting Xvfb
+ * with "-extension Composite" gives the plain rectangles.
+ *
+ */
+
+#include "ggwm.h"
+#include "thumbnail.h"
+#include "client.h"
+#include "main.h"
+#include "event.h"
+#include "timing.h"
+
+#ifdef USE_COMPOSITE
+
+/** Minimum time between refreshes of a thumbnail in milliseconds. */
+#define THUMBNAIL_INTERVAL 500
+
+/** Maximum number of thumbnails refreshed per pager redraw. */
+#define THUMBNAIL_BUDGET   4
+
+/** Thumbnail of a client window. */
+typedef struct ThumbnailNode {
+   ClientNode *client;
+   Damage damage;
+   XRenderPictFormat *format;    /**< Format of the client window. */
+   Pixmap pixmap;                /**< The scaled thumbnail. */
+   Picture picture;
+   int width, height;            /**< Size of the thumbnail. */
+   int windowWidth;              /**< Width of the window when damaged. */
+   int windowHeight;             /**< Height of the window when damaged. */
+   TimeType lastUpdate;          /**< Time of the last refresh. */
+   unsigned serial;              /**< Changes when a redraw is needed. */
+   char stale;                   /**< Set if the window changed. */
+   char valid;                   /**< Set if the thumbnail has contents. */
+   struct ThumbnailNode *next;
+} ThumbnailNode;
+
+static ThumbnailNode *thumbnails;
+static char requested;
+static char available;
+static int damageEventBase;
+static Picture target;
+static unsigned budget;
+static char retryPending;    /**< Set if SignalThumbnails is scheduled. */
+
+static ThumbnailNode *GetThumbnail(ClientNode *np);
+static void DestroyThumbnail(ThumbnailNode *tp);
+static char RefreshThumbnail(ThumbnailNode *tp, int width, int height);
+static void SignalThumbnails(const TimeType *now, int x, int y, Window w,
+                             void *data);
+
+/** Initialize thumbnail data. */
+void InitializeThumbnails(void)
+{
+   thumbnails = NULL;
+   requested = 0;
+   available = 0;
+}
+
+/** Startup thumbnails. */
+void StartupThumbnails(void)
+{
+   int major, minor;
+   int errorBase;
+
+   available = 0;
+   if(!requested || !haveRender) {
+      return;
+   }
+
+   if(!JXCompositeQueryExtension(display, &major, &errorBase)) {
+      Debug("Composite extension disabled");
+      return;
+   }
+   major = 0;
+   minor = 2;
+   JXCompositeQueryVersion(display, &major, &minor);
+   if(major == 0 && minor < 2) {
+      Debug("Composite 0.2 is required for thumbnails");
+      return;
+   }
+   if(!JXDamageQueryExtension(display, &damageEventBase, &errorBase)) {
+      Debug("Damage extension disabled");
+      return;
+   }
+
+   available = 1;
+   retryPending = 0;
+   RegisterCallback(CALLBACK_SCHEDULED, SignalThumbnails, NULL);
+   Debug("pager thumbnails enabled");
+}
+
+/** Shutdown thumbnails. */
+void ShutdownThumbnails(void)
+{
+   while(thumbnails) {
+      DestroyThumbnail(thumbnails);
+   }
+   if(available) {
+      UnregisterCallback(SignalThumbnails, NULL);
+      available = 0;
+   }
+}
+
+/** Request thumbnail support. */
+void RequestThumbnails(void)
+{
+   requested = 1;
+}
+
+/** Determine if thumbnails are available. */
+char HaveThumbnails(void)
+{
+   return available;
+}
+
+/** Start drawing thumbnails. */
+void BeginThumbnails(Drawable d)
+{
+   if(available) {
+      XRenderPictFormat *fp = JXRenderFindVisualFormat(display, rootVisual);
+      target = JXRenderCreatePicture(display, d, fp, 0, NULL);
+      budget = THUMBNAIL_BUDGET;
+   }
+}
+
+/** Finish drawing thumbnails. */
+void EndThumbnails(void)
+{
+   if(available) {
+      JXRenderFreePicture(display, target);
+      target = None;
+   }
+}
+
+/** Draw the thumbnail of a client. */
+char DrawThumbnail(ClientNode *np, int x, int y, int width, int height)
+{
+   ThumbnailNode *tp;
+
+   if(!available || target == None || width <= 0 || height <= 0) {
+      return 0;
+   }
+
+   tp = GetThumbnail(np);
+   if(!tp || !RefreshThumbnail(tp, width, height)) {
+      return 0;
+   }
+
+   JXRenderComposite(display, PictOpSrc, tp->picture, None, target,
+                     0, 0, 0, 0, x, y, width, height);
+   return 1;
+}
+
+/** Get a number that changes when the thumbnail should be redrawn. */
+unsigned GetThumbnailSerial(const ClientNode *np)
+{
+   ThumbnailNode *tp;
+   for(tp = thumbnails; tp; tp = tp->next) {
+      if(tp->client == np) {
+         return tp->serial;
+      }
+   }
+   return 0;
+}
+
+/** Release the thumbnail of a client. */
+void RemoveThumbnail(ClientNode *np)
+{
+   ThumbnailNode *tp;
+   for(tp = thumbnails; tp; tp = tp->next) {
+      if(tp->client == np) {
+         DestroyThumbnail(tp);
+         return;
+      }
+   }
+}
+
+/** Process a Damage event. */
+char HandleThumbnailEvent(const XEvent *event)
+{
+   const XDamageNotifyEvent *de;
+   ThumbnailNode *tp;
+
+   if(!available || event->type != damageEventBase + XDamageNotify) {
+      return 0;
+   }
+
+   /* Damage is reported once until the thumbnail is refreshed.
+    * A resize damages the whole window, so the event also gives the
+    * size of the window for the next refresh. */
+   de = (const XDamageNotifyEvent*)event;
+   for(tp = thumbnails; tp; tp = tp->next) {
+      if(tp->damage == de->damage) {
+         tp->windowWidth = de->geometry.width;
+         tp->windowHeight = de->geometry.height;
+         tp->stale = 1;
+         tp->serial += 1;
+         RequirePagerUpdate();
+         break;
+      }
+   }
+   return 1;
+}
+
+/** Get the thumbnail for a client, creating it if needed. */
+ThumbnailNode *GetThumbnail(ClientNode *np)
+{
+   XRenderPictFormat *format;
+   ThumbnailNode *tp;
+
+   for(tp = thumbnails; tp; tp = tp->next) {
+      if(tp->client == np) {
+         return tp;
+      }
+   }
+
+   format = JXRenderFindVisualFormat(display, np->visual);
+   if(!format) {
+      return NULL;
+   }
+
+   tp = Allocate(sizeof(ThumbnailNode));
+   tp->client = np;
+   tp->format = format;
+   tp->pixmap = None;
+   tp->picture = None;
+   tp->width = 0;
+   tp->height = 0;
+   tp->windowWidth = np->width;
+   tp->windowHeight = np->height;
+   tp->lastUpdate.seconds = 0;
+   tp->lastUpdate.ms = 0;
+   tp->serial = 0;
+   tp->stale = 1;
+   tp->valid = 0;
+   tp->next = thumbnails;
+   thumbnails = tp;
+
+   JXCompositeRedirectWindow(display, np->window, CompositeRedirectAutomatic);
+   tp->damage = JXDamageCreate(display, np->window, XDamageReportNonEmpty);
+   return tp;
+}
+
+/** Release a thumbnail and stop redirecting its window. */
+void DestroyThumbnail(ThumbnailNode *tp)
+{
+   ThumbnailNode **pp;
+
+   for(pp = &thumbnails; *pp; pp = &(*pp)->next) {
+      if(*pp == tp) {
+         *pp = tp->next;
+         break;
+      }
+   }
+
+   /* These fail harmlessly if the window was already destroyed. */
+   JXDamageDestroy(display, tp->damage);
+   JXCompositeUnredirectWindow(display, tp->client->window,
+                               CompositeRedirectAutomatic);
+   if(tp->picture != None) {
+      JXRenderFreePicture(display, tp->picture);
+      JXFreePixmap(display, tp->pixmap);
+   }
+   Release(tp);
+}
+
+/** Refresh a thumbnail if needed and allowed.
+ * @return 1 if the thumbnail has contents, 0 otherwise.
+ */
+char RefreshThumbnail(ThumbnailNode *tp, int width, int height)
+{
+   const ClientNode *np = tp->client;
+   XRenderPictFormat *fp;
+   XTransform transform;
+   TimeType now;
+   Pixmap pixmap;
+   Picture source;
+
+   /* Reallocate the thumbnail if the size on the pager changed. */
+   if(tp->width != width || tp->height != height) {
+      if(tp->picture != None) {
+         JXRenderFreePicture(display, tp->picture);
+         JXFreePixmap(display, tp->pixmap);
+      }
+      tp->pixmap = JXCreatePixmap(display, rootWindow, width, height,
+                                  rootDepth);
+      fp = JXRenderFindVisualFormat(display, rootVisual);
+      tp->picture = JXRenderCreatePicture(display, tp->pixmap, fp, 0, NULL);
+      tp->width = width;
+      tp->height = height;
+      tp->valid = 0;
+      tp->stale = 1;
+   }
+   if(!tp->stale) {
+      return tp->valid;
+   }
+
+   /* Only viewable windows have contents. */
+   if(!(np->state.status & STAT_MAPPED)
+      || (np->state.status & (STAT_HIDDEN | STAT_MINIMIZED | STAT_SHADED))) {
+      return tp->valid;
+   }
+
+   /* Limit how often a window is refreshed and how many are refreshed
+    * per redraw; retried by SignalThumbnails. */
+   GetCurrentTime(&now);
+   if(budget == 0 || (tp->valid
+      && GetTimeDifference(&now, &tp->lastUpdate) < THUMBNAIL_INTERVAL)) {
+      if(!retryPending) {
+         AddTime(&now, THUMBNAIL_INTERVAL);
+         ScheduleCallback(SignalThumbnails, NULL, &now);
+         retryPending = 1;
+      }
+      return tp->valid;
+   }
+   budget -= 1;
+
+   JXDamageSubtract(display, tp->damage, None, None);
+   pixmap = JXCompositeNameWindowPixmap(display, np->window);
+   source = JXRenderCreatePicture(display, pixmap, tp->format, 0, NULL);
+
+   /* Scale the window to the thumbnail size. */
+   memset(&transform, 0, sizeof(transform));
+   transform.matrix[0][0] = XDoubleToFixed((double)tp->windowWidth / width);
+   transform.matrix[1][1]
+      = XDoubleToFixed((double)tp->windowHeight / height);
+   transform.matrix[2][2] = XDoubleToFixed(1.0);
+   JXRenderSetPictureTransform(display, source, &transform);
+   JXRenderSetPictureFilter(display, source, FilterGood, NULL, 0);
+
+   JXRenderComposite(display, PictOpSrc, source, None, tp->picture,
+                     0, 0, 0, 0, 0, 0, width, height);
+
+   JXRenderFreePicture(display, source);
+   JXFreePixmap(display, pixmap);
+
+   tp->lastUpdate = now;
+   tp->stale = 0;
+   tp->valid = 1;
+   return 1;
+}
+
+/** Request a pager redraw for thumbnails that were rate limited. */
+void SignalThumbnails(const TimeType *now, int x, int y, Window w,
+                      void *data)
+{
+   ThumbnailNode *tp;
+   char pending = 0;
+   retryPending = 0;
+   for(tp = thumbnails; tp; tp = tp->next) {
+      if(tp->stale && (!tp->valid
+         || GetTimeDifference(now, &tp->lastUpdate) >= THUMBNAIL_INTERVAL)) {
+         tp->serial += 1;
+         pending = 1;
+      }
+   }
+   if(pending) {
+      RequirePagerUpdate();
+   }
+}
+
+#else /* USE_COMPOSITE */
+
+/** Initialize thumbnail data. */
+void InitializeThumbnails(void)
+{
+}
+
+/** Startup thumbnails. */
+void StartupThumbnails(void)
+{
+}
+
+/** Shutdown thumbnails. */
+void ShutdownThumbnails(void)
+{
+}
+
+/** Request thumbnail support. */
+void RequestThumbnails(void)
+{
+}
+
+/** Determine if thumbnails are available. */
+char HaveThumbnails(void)
+{
+   return 0;
+}
+
+/** Start drawing thumbnails. */
+void BeginThumbnails(Drawable d)
+{
+}
+
+/** Draw the thumbnail of a client. */
+char DrawThumbnail(ClientNode *np, int x, int y, int width, int height)
+{
+   return 0;
+}
+
+/** Finish drawing thumbnails. */
+void EndThumbnails(void)
+{
+}
+
+/** Get a number that changes when the thumbnail should be redrawn. */
+unsigned GetThumbnailSerial(const ClientNode *np)
+{
+   return 0;
+}
+
+/** Release the thumbnail of a client. */
+void RemoveThumbnail(ClientNode *np)
+{
+}
+
+/** Process a Damage event. */
+char HandleThumbnailEvent(const XEvent *event)
+{
+   return 0;
+}
+
+#endif /* USE_COMPOSITE */
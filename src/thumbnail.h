@@ -0,0 +1,74 @@
+/**
+ * @file thumbnail.h
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Window thumbnails for the pager.
+ *
+ */
+
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+struct ClientNode;
+
+/*@{*/
+void InitializeThumbnails(void);
+void StartupThumbnails(void);
+void ShutdownThumbnails(void);
+#define DestroyThumbnails()   (void)(0)
+/*@}*/
+
+/** Request thumbnail support.
+ * This is called while parsing the configuration for each pager that
+ * shows thumbnails.  Nothing is redirected unless this is called.
+ */
+void RequestThumbnails(void);
+
+/** Determine if thumbnails are available.
+ * @return 1 if thumbnails were requested and the Composite, Damage,
+ *         and XRender extensions are present, 0 otherwise.
+ */
+char HaveThumbnails(void);
+
+/** Start drawing thumbnails.
+ * This also resets the number of thumbnails that may be refreshed.
+ * @param d The drawable to draw on (with the root depth).
+ */
+void BeginThumbnails(Drawable d);
+
+/** Draw the thumbnail of a client.
+ * The thumbnail is refreshed if the window changed, subject to a
+ * per-window rate limit and a limit per BeginThumbnails call.
+ * @param np The client.
+ * @param x The x-coordinate.
+ * @param y The y-coordinate.
+ * @param width The width of the thumbnail.
+ * @param height The height of the thumbnail.
+ * @return 1 if drawn, 0 if no thumbnail is available.
+ */
+char DrawThumbnail(struct ClientNode *np, int x, int y,
+                   int width, int height);
+
+/** Finish drawing thumbnails. */
+void EndThumbnails(void);
+
+/** Get a number that changes when the thumbnail of a client should be
+ * redrawn.
+ * @param np The client.
+ * @return The thumbnail serial number.
+ */
+unsigned GetThumbnailSerial(const struct ClientNode *np);
+
+/** Release the thumbnail of a client.
+ * @param np The client.
+ */
+void RemoveThumbnail(struct ClientNode *np);
+
+/** Process a Damage event.
+ * @param event The event.
+ * @return 1 if the event was handled, 0 otherwise.
+ */
+char HandleThumbnailEvent(const XEvent *event);
+
+#endif /* THUMBNAIL_H */
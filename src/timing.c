@@ -9,11 +9,58 @@
 
 #include "ggwm.h"
 #include "timing.h"
+#include "misc.h"
+
+#ifdef HAVE_LANGINFO_H
+#  include <langinfo.h>
+#endif
 
 static const unsigned long MAX_TIME_SECONDS = 60;
 
-/** Get the current time in milliseconds since midnight 1970-01-01 UTC. */
+/** Maximum number of seconds to cache the rules of a time zone. */
+#define ZONE_CACHE_SECONDS (24 * 60 * 60)
+
+/** Cached rules of a time zone. */
+typedef struct ZoneNode {
+   char *name;             /**< The zone in tzset() format. */
+   long offset;            /**< Seconds east of UTC. */
+   int isdst;              /**< Set if daylight saving time is in effect. */
+   char abbrev[16];        /**< Value for %Z. */
+   char numeric[8];        /**< Value for %z. */
+   time_t start, end;      /**< The rules are valid for start <= t < end. */
+   struct ZoneNode *next;
+} ZoneNode;
+
+static ZoneNode *zones = NULL;
+static char saveTZ[256];
+static char newTZ[256];
+static char haveSavedTZ;
+
+static ZoneNode *GetZone(const char *zone, time_t t);
+static void LoadZone(ZoneNode *zp, time_t t);
+static long GetZoneOffset(time_t t, int *isdst);
+static char *ExpandZoneFormat(const char *format, const ZoneNode *zp,
+                              time_t t);
+static void AppendFormat(char **result, size_t *len, size_t *max,
+                         const char *str, size_t count, char escape);
+static void SetTimeZone(const char *zone);
+static void RestoreTimeZone(void);
+
+/** Get the current time from a monotonic clock in milliseconds. */
 void GetCurrentTime(TimeType *t)
+{
+#ifdef CLOCK_MONOTONIC
+   struct timespec val;
+   clock_gettime(CLOCK_MONOTONIC, &val);
+   t->seconds = val.tv_sec;
+   t->ms = val.tv_nsec / 1000000;
+#else
+   GetWallTime(t);
+#endif
+}
+
+/** Get the current time in milliseconds since midnight 1970-01-01 UTC. */
+void GetWallTime(TimeType *t)
 {
    struct timeval val;
    gettimeofday(&val, NULL);
@@ -53,40 +100,297 @@ unsigned long GetTimeDifference(const TimeType *t1, const TimeType *t2)
 
 }
 
-/** Get the current time. */
-const char *GetTimeString(const char *format, const char *zone)
+/** Add milliseconds to a time. */
+void AddTime(TimeType *t, int ms)
+{
+   t->ms += ms;
+   t->seconds += t->ms / 1000;
+   t->ms %= 1000;
+}
+
+/** Get a time string. */
+const char *GetTimeString(const char *format, const char *zone,
+                          const TimeType *now)
 {
-   static char saveTZ[256];
-   static char newTZ[256];
    static char str[80];
-   time_t t;
+   const time_t t = (time_t)now->seconds;
+   struct tm tm;
 
-   time(&t);
    if(zone) {
-      const char *oldTZ = getenv("TZ");
-      if(oldTZ) {
-         snprintf(saveTZ, sizeof(saveTZ), "TZ=%s", oldTZ);
-#ifndef HAVE_UNSETENV
+      ZoneNode *zp = GetZone(zone, t);
+      char *expanded = ExpandZoneFormat(format, zp, t);
+      if(expanded) {
+         const time_t local = t + zp->offset;
+         gmtime_r(&local, &tm);
+         tm.tm_isdst = zp->isdst;
+         strftime(str, sizeof(str), expanded, &tm);
+         Release(expanded);
       } else {
-         strcpy(saveTZ, "TZ=");
+         SetTimeZone(zone);
+         strftime(str, sizeof(str), format, localtime_r(&t, &tm));
+         RestoreTimeZone();
+      }
+   } else {
+      strftime(str, sizeof(str), format, localtime_r(&t, &tm));
+   }
+
+   return str;
+}
+
+/** Get the number of seconds between updates of a time format. */
+int GetTimeGranularity(const char *format)
+{
+   const char *p;
+   for(p = format; *p; p++) {
+      if(*p != '%') {
+         continue;
+      }
+      p += 1;
+      while(*p == 'E' || *p == 'O' || *p == '_' || *p == '-'
+            || *p == '0' || *p == '^' || *p == '#') {
+         p += 1;
+      }
+      if(*p == 0) {
+         break;
+      }
+      if(strchr("STrsXc+", *p)) {
+         return 1;
+      }
+   }
+   return 60;
+}
+
+/** Release cached time zones. */
+void ShutdownTiming(void)
+{
+   while(zones) {
+      ZoneNode *next = zones->next;
+      Release(zones->name);
+      Release(zones);
+      zones = next;
+   }
+}
+
+/** Get the cached rules for a time zone, loading them if needed. */
+ZoneNode *GetZone(const char *zone, time_t t)
+{
+   ZoneNode *zp;
+   for(zp = zones; zp; zp = zp->next) {
+      if(!strcmp(zp->name, zone)) {
+         break;
+      }
+   }
+   if(!zp) {
+      zp = Allocate(sizeof(ZoneNode));
+      zp->name = CopyString(zone);
+      zp->start = 1;
+      zp->end = 0;
+      zp->next = zones;
+      zones = zp;
+   }
+   if(t < zp->start || t >= zp->end) {
+      LoadZone(zp, t);
+   }
+   return zp;
+}
+
+/** Load the rules of a time zone valid at a time.
+ * The rules are cached until the next transition (found by bisection)
+ * or for ZONE_CACHE_SECONDS, so the zone data is read about once a day.
+ */
+void LoadZone(ZoneNode *zp, time_t t)
+{
+   struct tm tm;
+   time_t low, high;
+   int isdst;
+
+   SetTimeZone(zp->name);
+
+   zp->offset = GetZoneOffset(t, &isdst);
+   zp->isdst = isdst;
+   localtime_r(&t, &tm);
+   strftime(zp->abbrev, sizeof(zp->abbrev), "%Z", &tm);
+   strftime(zp->numeric, sizeof(zp->numeric), "%z", &tm);
+
+   low = t;
+   high = t + ZONE_CACHE_SECONDS;
+   if(GetZoneOffset(high, &isdst) != zp->offset || isdst != zp->isdst) {
+      while(high - low > 1) {
+         const time_t middle = low + (high - low) / 2;
+         if(GetZoneOffset(middle, &isdst) == zp->offset
+            && isdst == zp->isdst) {
+            low = middle;
+         } else {
+            high = middle;
+         }
+      }
+   }
+   zp->start = t;
+   zp->end = high;
+
+   RestoreTimeZone();
+}
+
+/** Get the offset from UTC in seconds for the current TZ at a time. */
+long GetZoneOffset(time_t t, int *isdst)
+{
+   struct tm local, utc;
+   long days;
+
+   localtime_r(&t, &local);
+   gmtime_r(&t, &utc);
+   *isdst = local.tm_isdst > 0;
+
+   /* The dates differ by at most one day. */
+   days = local.tm_yday - utc.tm_yday;
+   if(local.tm_year != utc.tm_year) {
+      days = local.tm_year > utc.tm_year ? 1 : -1;
+   }
+   return ((days * 24 + local.tm_hour - utc.tm_hour) * 60
+           + local.tm_min - utc.tm_min) * 60
+           + local.tm_sec - utc.tm_sec;
+}
+
+/** Replace conversions that depend on the time zone.
+ * %Z, %z, and %s are replaced with their values and %c is expanded
+ * using the locale so that the rest can be formatted from UTC.
+ * @return The new format or NULL if it cannot be expanded.
+ */
+char *ExpandZoneFormat(const char *format, const ZoneNode *zp, time_t t)
+{
+   char number[32];
+   const char *resume;
+   const char *p;
+   char *result;
+   size_t len, max;
+
+   max = strlen(format) + 1;
+   result = Allocate(max);
+   len = 0;
+   resume = NULL;
+   p = format;
+   for(;;) {
+
+      const char *conv;
+      const char *insert;
+
+      if(*p == 0) {
+         if(!resume) {
+            break;
+         }
+         /* End of an expanded %c. */
+         p = resume;
+         resume = NULL;
+         continue;
+      }
+      if(*p != '%') {
+         AppendFormat(&result, &len, &max, p, 1, 0);
+         p += 1;
+         continue;
+      }
+
+      /* Skip flags, width, and modifiers. */
+      conv = p + 1;
+      while(*conv && strchr("_-0^#123456789EO", *conv)) {
+         conv += 1;
+      }
+      if(*conv == 0) {
+         AppendFormat(&result, &len, &max, p, conv - p, 0);
+         p = conv;
+         continue;
+      }
+
+      switch(*conv) {
+      case 'Z':
+         insert = zp->abbrev;
+         break;
+      case 'z':
+         insert = zp->numeric;
+         break;
+      case 's':
+         snprintf(number, sizeof(number), "%ld", (long)t);
+         insert = number;
+         break;
+#ifdef HAVE_LANGINFO_H
+      case 'c':
+         if(resume) {
+            Release(result);
+            return NULL;
+         }
+         resume = conv + 1;
+         p = nl_langinfo(D_T_FMT);
+         continue;
+#else
+      case 'c':
+         Release(result);
+         return NULL;
 #endif
+      default:
+         insert = NULL;
+         break;
       }
-      snprintf(newTZ, sizeof(newTZ), "TZ=%s", zone);
-      putenv(newTZ);
-      tzset();
-      strftime(str, sizeof(str), format, localtime(&t));
-#ifdef HAVE_UNSETENV
-      if(oldTZ) {
-         putenv(saveTZ);
+
+      if(insert) {
+         AppendFormat(&result, &len, &max, insert, strlen(insert), 1);
       } else {
-         unsetenv("TZ");
+         AppendFormat(&result, &len, &max, p, conv + 1 - p, 0);
       }
+      p = conv + 1;
+
+   }
+
+   result[len] = 0;
+   return result;
+}
+
+/** Append to a format, optionally escaping '%'. */
+void AppendFormat(char **result, size_t *len, size_t *max,
+                  const char *str, size_t count, char escape)
+{
+   size_t i;
+   for(i = 0; i < count; i++) {
+      if(*len + 3 > *max) {
+         *max = *max * 2 + 3;
+         *result = Reallocate(*result, *max);
+      }
+      if(escape && str[i] == '%') {
+         (*result)[(*len)++] = '%';
+      }
+      (*result)[(*len)++] = str[i];
+   }
+}
+
+/** Use a time zone until RestoreTimeZone is called. */
+void SetTimeZone(const char *zone)
+{
+   const char *oldTZ = getenv("TZ");
+   if(oldTZ) {
+      snprintf(saveTZ, sizeof(saveTZ), "TZ=%s", oldTZ);
+      haveSavedTZ = 1;
+   } else {
+#ifdef HAVE_UNSETENV
+      haveSavedTZ = 0;
 #else
-      putenv(saveTZ);
+      strcpy(saveTZ, "TZ=");
+      haveSavedTZ = 1;
 #endif
-   } else {
-      strftime(str, sizeof(str), format, localtime(&t));
    }
+   snprintf(newTZ, sizeof(newTZ), "TZ=%s", zone);
+   putenv(newTZ);
+   tzset();
+}
 
-   return str;
+/** Restore the time zone replaced by SetTimeZone. */
+void RestoreTimeZone(void)
+{
+#ifdef HAVE_UNSETENV
+   if(haveSavedTZ) {
+      putenv(saveTZ);
+   } else {
+      unsetenv("TZ");
+   }
+#else
+   putenv(saveTZ);
+#endif
+   tzset();
 }
@@ -13,7 +13,10 @@
 /** Initializer for TimeType to indicate that it is not set. */
 #define ZERO_TIME { 0, 0 }
 
-/** Structure to represent time since January 1, 1970 GMT. */
+/** Structure to represent a time.
+ * Times from GetCurrentTime are from a monotonic clock; times from
+ * GetWallTime are since January 1, 1970 GMT.
+ */
 typedef struct TimeType {
 
    unsigned long seconds;  /**< Seconds. */
@@ -21,11 +24,18 @@ typedef struct TimeType {
 
 } TimeType;
 
-/** Get the current time.
+/** Get the current time for timers and intervals.
+ * This uses a monotonic clock where available, so it is not affected
+ * when the system time is set and it is not the time of day.
  * @param t The TimeType to fill.
  */
 void GetCurrentTime(TimeType *t);
 
+/** Get the time of day.
+ * @param t The TimeType to fill with the time since January 1, 1970 GMT.
+ */
+void GetWallTime(TimeType *t);
+
 /** Get the difference between two times.
  * Note that the times must be normalized.
  * @param t1 The first time.
@@ -34,14 +44,37 @@ void GetCurrentTime(TimeType *t);
  */
 unsigned long GetTimeDifference(const TimeType *t1, const TimeType *t2);
 
+/** Add milliseconds to a time.
+ * @param t The time to update.
+ * @param ms The number of milliseconds to add (not negative).
+ */
+void AddTime(TimeType *t, int ms);
+
+/*@{*/
+#define InitializeTiming() (void)(0)
+#define StartupTiming()    (void)(0)
+void ShutdownTiming(void);
+#define DestroyTiming()    (void)(0)
+/*@}*/
+
 /** Get a time string.
  * Note that the string returned is a static value and should not be
  * deleted. Therefore, this function is not thread safe.
+ * The rules for each time zone are cached, so the zone data is not
+ * read again until the next transition (or a day later).
  * @param format The format to use for the string.
  * @param zone The timezone in tzset() format to use (defaults to local)
+ * @param now The time to format.
  * @return The time string.
  */
-const char *GetTimeString(const char *format, const char *zone);
+const char *GetTimeString(const char *format, const char *zone,
+                          const TimeType *now);
+
+/** Get the number of seconds between changes of a time format.
+ * @param format The format.
+ * @return 1 if the format shows seconds, 60 otherwise.
+ */
+int GetTimeGranularity(const char *format);
 
 #endif /* TIMING_H */
 
@@ -33,6 +33,8 @@ static unsigned int trayCount;
 
 static void HandleTrayExpose(TrayType *tp, const XExposeEvent *event);
 static void HandleTrayEnterNotify(TrayType *tp, const XCrossingEvent *event);
+static void HandleTrayLeaveNotify(TrayType *tp, const XCrossingEvent *event);
+static void ScheduleAutoHide(TrayType *tp);
 
 static TrayComponentType *GetTrayComponent(TrayType *tp, int x, int y);
 static void HandleTrayButtonPress(TrayType *tp, const XButtonEvent *event);
@@ -92,6 +94,7 @@ void StartupTray(void)
          | KeyPressMask
          | KeyReleaseMask
          | EnterWindowMask
+         | LeaveWindowMask
          | PointerMotionMask;
 
       attrMask |= CWBackPixel;
@@ -164,6 +167,9 @@ void StartupTray(void)
 
       /* Show the tray. */
       JXMapWindow(display, tp->window);
+      if(tp->autoHide != THIDE_OFF) {
+         ScheduleAutoHide(tp);
+      }
 
       trayCount += 1;
 
@@ -232,7 +238,6 @@ TrayType *CreateTray(void)
    tp->valign = TALIGN_FIXED;
    tp->halign = TALIGN_FIXED;
 
-   GetCurrentTime(&tp->showTime);
    tp->autoHide = THIDE_OFF;
    tp->autoHideDelay = 0;
    tp->hidden = 0;
@@ -278,6 +283,7 @@ TrayComponentType *CreateTrayComponent(void)
    cp->ProcessButtonPress = NULL;
    cp->ProcessButtonRelease = NULL;
    cp->ProcessMotionEvent = NULL;
+   cp->ProcessLeaveEvent = NULL;
    cp->Redraw = NULL;
 
    cp->next = NULL;
@@ -550,8 +556,8 @@ void ShowTray(TrayType *tp)
    if(tp->hidden) {
 
       tp->hidden = 0;
-      GetCurrentTime(&tp->showTime);
       JXMoveWindow(display, tp->window, tp->x, tp->y);
+      ScheduleAutoHide(tp);
 
       JXQueryPointer(display, rootWindow, &win1, &win2,
                      &mousex, &mousey, &winx, &winy, &mask);
@@ -654,6 +660,9 @@ char ProcessTrayEvent(const XEvent *event)
          case EnterNotify:
             HandleTrayEnterNotify(tp, &event->xcrossing);
             return 1;
+         case LeaveNotify:
+            HandleTrayLeaveNotify(tp, &event->xcrossing);
+            return 1;
          case ButtonPress:
             HandleTrayButtonPress(tp, &event->xbutton);
             return 1;
@@ -672,22 +681,38 @@ char ProcessTrayEvent(const XEvent *event)
    return 0;
 }
 
-/** Signal the tray (needed for autohide). */
+/** Signal the tray (needed for autohide).
+ * This runs once the autohide delay has passed after the mouse left the
+ * tray.  Entering the tray cancels it.
+ */
 void SignalTray(const TimeType *now, int x, int y, Window w, void *data)
 {
    TrayType *tp = (TrayType*)data;
    Assert(tp->autoHide != THIDE_OFF);
-   if(tp->hidden || menuShown) {
+   if(tp->hidden) {
+      return;
+   }
+
+   /* Wait for the menu to close before hiding. */
+   if(menuShown) {
+      ScheduleAutoHide(tp);
       return;
    }
 
    if(x < tp->x || x >= tp->x + tp->width
       || y < tp->y || y >= tp->y + tp->height) {
-      if(GetTimeDifference(now, &tp->showTime) >= tp->autoHideDelay) {
-         HideTray(tp);
-      }
-   } else {
-      tp->showTime = *now;
+      HideTray(tp);
+   }
+}
+
+/** Hide a tray after the autohide delay. */
+void ScheduleAutoHide(TrayType *tp)
+{
+   TimeType when;
+   if(tp->autoHide != THIDE_OFF) {
+      GetCurrentTime(&when);
+      AddTime(&when, tp->autoHideDelay);
+      ScheduleCallback(SignalTray, tp, &when);
    }
 }
 
@@ -701,6 +726,27 @@ void HandleTrayExpose(TrayType *tp, const XExposeEvent *event)
 void HandleTrayEnterNotify(TrayType *tp, const XCrossingEvent *event)
 {
    ShowTray(tp);
+   if(tp->autoHide != THIDE_OFF) {
+      CancelCallback(SignalTray, tp);
+   }
+}
+
+/** Handle a tray leave notify (for autohide and popups). */
+void HandleTrayLeaveNotify(TrayType *tp, const XCrossingEvent *event)
+{
+   TrayComponentType *cp;
+
+   /* Moving onto a swallowed or docked window stays in the tray. */
+   if(event->detail == NotifyInferior) {
+      return;
+   }
+
+   ScheduleAutoHide(tp);
+   for(cp = tp->components; cp; cp = cp->next) {
+      if(cp->ProcessLeaveEvent) {
+         (cp->ProcessLeaveEvent)(cp);
+      }
+   }
 }
 
 /** Get the tray component under the given coordinates. */
@@ -832,6 +878,7 @@ void RaiseTrays(void)
       ShowTray(tp);
       JXRaiseWindow(display, tp->window);
    }
+   InvalidateStackOrder();
 }
 
 /** Lower tray windows. */
@@ -858,6 +905,20 @@ void UpdateSpecificTray(const TrayType *tp, const TrayComponentType *cp)
    }
 }
 
+/** Update part of a component on a tray. */
+void UpdateSpecificTrayArea(const TrayType *tp, const TrayComponentType *cp,
+                            int x, int y, int width, int height)
+{
+   if(JUNLIKELY(shouldExit)) {
+      return;
+   }
+
+   if(cp->pixmap != None) {
+      JXCopyArea(display, cp->pixmap, tp->window, rootGC, x, y,
+                 width, height, cp->x + x, cp->y + y);
+   }
+}
+
 /** Layout tray components on a tray. */
 void LayoutTray(TrayType *tp, int *variableSize, int *variableRemainder)
 {
@@ -1007,6 +1068,20 @@ void ClearTrayDrawable(const TrayComponentType *cp)
    }
 }
 
+/** Draw the tray background on part of a drawable. */
+void ClearTrayArea(const TrayComponentType *cp,
+                   int x, int y, int width, int height)
+{
+   XRectangle rect;
+   rect.x = x;
+   rect.y = y;
+   rect.width = width;
+   rect.height = height;
+   JXSetClipRectangles(display, rootGC, 0, 0, &rect, 1, Unsorted);
+   ClearTrayDrawable(cp);
+   JXSetClipMask(display, rootGC, None);
+}
+
 /** Get a linked list of trays. */
 TrayType *GetTrays(void)
 {
@@ -1032,7 +1107,7 @@ void SetAutoHideTray(TrayType *tp,
    tp->autoHideDelay = timeout_ms;
 
    if(autohide != THIDE_OFF) {
-      RegisterCallback(timeout_ms, SignalTray, tp);
+      RegisterCallback(CALLBACK_SCHEDULED, SignalTray, tp);
    }
 }
 
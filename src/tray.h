@@ -112,6 +112,9 @@ typedef struct TrayComponentType {
    void (*ProcessMotionEvent)(struct TrayComponentType *cp,
                               int x, int y, int mask);
 
+   /** Callback for the mouse leaving the tray. */
+   void (*ProcessLeaveEvent)(struct TrayComponentType *cp);
+
    /** Callback to redraw the component contents.
     * This is only needed for components that use actions.
     */
@@ -143,7 +146,6 @@ typedef struct TrayType {
    TrayAlignmentType valign;  /**< Vertical alignment. */
    TrayAlignmentType halign;  /**< Horizontal alignment. */
 
-   TimeType showTime;
    TrayAutoHideType  autoHide;
    unsigned autoHideDelay;
    char hidden;     /**< 1 if hidden (due to autohide), 0 otherwise. */
@@ -214,6 +216,17 @@ void LowerTrays(void);
  */
 void UpdateSpecificTray(const TrayType *tp, const TrayComponentType *cp);
 
+/** Update part of a component on a tray.
+ * @param tp The tray containing the component.
+ * @param cp The component that needs updating.
+ * @param x The x-coordinate relative to the component.
+ * @param y The y-coordinate relative to the component.
+ * @param width The width of the area.
+ * @param height The height of the area.
+ */
+void UpdateSpecificTrayArea(const TrayType *tp, const TrayComponentType *cp,
+                            int x, int y, int width, int height);
+
 /** Resize a tray.
  * @param tp The tray to resize containing the new requested size information.
  */
@@ -222,6 +235,16 @@ void ResizeTray(TrayType *tp);
 /** Draw the tray background on a drawable. */
 void ClearTrayDrawable(const TrayComponentType *cp);
 
+/** Draw the tray background on part of a component.
+ * @param cp The component.
+ * @param x The x-coordinate relative to the component.
+ * @param y The y-coordinate relative to the component.
+ * @param width The width of the area.
+ * @param height The height of the area.
+ */
+void ClearTrayArea(const TrayComponentType *cp,
+                   int x, int y, int width, int height);
+
 /** Get a linked list of trays.
  * @return The trays.
  */
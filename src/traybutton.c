@@ -60,6 +60,7 @@ static void ProcessButtonRelease(TrayComponentType *cp,
                                  int x, int y, int button);
 static void ProcessMotionEvent(TrayComponentType *cp,
                                int x, int y, int mask);
+static void ProcessLeaveEvent(TrayComponentType *cp);
 static void SignalTrayButton(const TimeType *now,
                              int x, int y, Window w, void *data);
 
@@ -94,6 +95,18 @@ void StartupTrayButtons(void)
    }
 }
 
+/** Redraw tray buttons that show an icon. */
+void UpdateTrayButtons(void)
+{
+   TrayButtonType *bp;
+   for(bp = buttons; bp; bp = bp->next) {
+      if(bp->icon && bp->cp->pixmap != None) {
+         Draw(bp->cp);
+         UpdateSpecificTray(bp->cp->tray, bp->cp);
+      }
+   }
+}
+
 /** Release tray button data. */
 void DestroyTrayButtons(void)
 {
@@ -162,9 +175,10 @@ TrayComponentType *CreateTrayButton(const char *iconName,
    cp->ProcessButtonRelease = ProcessButtonRelease;
    if(popup || label) {
       cp->ProcessMotionEvent = ProcessMotionEvent;
+      cp->ProcessLeaveEvent = ProcessLeaveEvent;
    }
 
-   RegisterCallback(settings.popupDelay / 2, SignalTrayButton, bp);
+   RegisterCallback(CALLBACK_SCHEDULED, SignalTrayButton, bp);
 
    return cp;
 
@@ -320,9 +334,21 @@ void ProcessButtonRelease(TrayComponentType *cp, int x, int y, int button)
 void ProcessMotionEvent(TrayComponentType *cp, int x, int y, int mask)
 {
    TrayButtonType *bp = (TrayButtonType*)cp->object;
+   TimeType popupTime;
    bp->mousex = cp->screenx + x;
    bp->mousey = cp->screeny + y;
    GetCurrentTime(&bp->mouseTime);
+
+   /* Show a popup if the mouse stays here. */
+   popupTime = bp->mouseTime;
+   AddTime(&popupTime, settings.popupDelay);
+   ScheduleCallback(SignalTrayButton, bp, &popupTime);
+}
+
+/** Process the mouse leaving the tray. */
+void ProcessLeaveEvent(TrayComponentType *cp)
+{
+   CancelCallback(SignalTrayButton, cp->object);
 }
 
 /** Signal (needed for popups). */
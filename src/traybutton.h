@@ -20,6 +20,11 @@ void StartupTrayButtons(void);
 void DestroyTrayButtons(void);
 /*@}*/
 
+/** Redraw tray buttons that show an icon.
+ * This is used when icons become available after startup.
+ */
+void UpdateTrayButtons(void);
+
 /** Create a tray button component.
  * @param iconName The name of the icon to use for the button.
  * @param label The label to use for the button.
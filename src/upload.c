@@ -0,0 +1,291 @@
+/**
+ * @file upload.c
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Functions to upload images to the X server.
+ *
+ * Small images are sent with XPutImage.  Larger images (wallpapers,
+ * big icons) are placed in a shared memory segment and sent with
+ * XShmPutImage, which avoids copying every pixel through the X socket.
+ * Segments are kept in a small pool and reused.
+ *
+ */
+
+#include "ggwm.h"
+#include "upload.h"
+#include "main.h"
+#include "error.h"
+
+#ifdef USE_SHM
+
+/** Images smaller than this (in bytes) are not worth a shared segment. */
+#define SHM_MIN_SIZE    (64 * 1024)
+
+/** Maximum number of shared segments to keep. */
+#define SHM_MAX_SEGMENTS 2
+
+/** A shared memory segment. */
+typedef struct ShmSegment {
+   XShmSegmentInfo info;
+   size_t size;
+   XImage *image;    /**< Image using this segment (NULL if free). */
+   char busy;        /**< Set until the server has read the segment. */
+} ShmSegment;
+
+static ShmSegment segments[SHM_MAX_SEGMENTS];
+static char haveShm = 0;
+static char shmFailed;
+
+static ShmSegment *GetSegment(size_t size);
+static ShmSegment *FindSegment(const XImage *image);
+static char CreateSegment(ShmSegment *sp, size_t size);
+static void DestroySegment(ShmSegment *sp);
+static int HandleShmError(Display *d, XErrorEvent *e);
+
+/** Startup image uploads. */
+void StartupUpload(void)
+{
+   const char *name;
+   unsigned i;
+
+   for(i = 0; i < SHM_MAX_SEGMENTS; i++) {
+      segments[i].size = 0;
+      segments[i].image = NULL;
+      segments[i].busy = 0;
+   }
+
+   /* Shared memory only works if the server is on this machine. */
+   haveShm = 0;
+   name = DisplayString(display);
+   if(name[0] != ':' && strncmp(name, "unix:", 5)) {
+      Debug("MIT-SHM disabled for remote display");
+      return;
+   }
+   if(JXShmQueryExtension(display)) {
+      haveShm = 1;
+      Debug("MIT-SHM extension enabled");
+   } else {
+      Debug("MIT-SHM extension disabled");
+   }
+}
+
+/** Shutdown image uploads. */
+void ShutdownUpload(void)
+{
+   unsigned i;
+   for(i = 0; i < SHM_MAX_SEGMENTS; i++) {
+      if(segments[i].size > 0) {
+         DestroySegment(&segments[i]);
+      }
+   }
+}
+
+/** Create an image to be uploaded to the X server. */
+XImage *CreateUploadImage(unsigned depth, unsigned width, unsigned height)
+{
+   XImage *image;
+
+   if(haveShm) {
+      image = JXShmCreateImage(display, rootVisual, depth, ZPixmap, NULL,
+                               NULL, width, height);
+      if(image) {
+         const size_t size = image->bytes_per_line * image->height;
+         ShmSegment *sp = NULL;
+         if(size >= SHM_MIN_SIZE) {
+            sp = GetSegment(size);
+         }
+         if(sp) {
+            sp->image = image;
+            image->data = sp->info.shmaddr;
+            image->obdata = (char*)&sp->info;
+            return image;
+         }
+         JXDestroyImage(image);
+      }
+   }
+
+   image = JXCreateImage(display, rootVisual, depth, ZPixmap, 0, NULL,
+                         width, height, 8, 0);
+   image->data = Allocate(image->bytes_per_line * image->height);
+   return image;
+}
+
+/** Upload an image to a drawable and release it. */
+void UploadImage(Drawable d, GC gc, XImage *image)
+{
+   ShmSegment *sp = FindSegment(image);
+   if(sp) {
+      JXShmPutImage(display, d, gc, image, 0, 0, 0, 0,
+                    image->width, image->height, False);
+      sp->busy = 1;
+   } else {
+      JXPutImage(display, d, gc, image, 0, 0, 0, 0,
+                 image->width, image->height);
+   }
+   DestroyUploadImage(image);
+}
+
+/** Release an image without uploading it. */
+void DestroyUploadImage(XImage *image)
+{
+   ShmSegment *sp = FindSegment(image);
+   if(sp) {
+      sp->image = NULL;
+   } else {
+      Release(image->data);
+   }
+   image->data = NULL;
+   JXDestroyImage(image);
+}
+
+/** Get a free segment of at least the specified size. */
+ShmSegment *GetSegment(size_t size)
+{
+   ShmSegment *best = NULL;
+   unsigned i;
+
+   /* Use the smallest free segment that is large enough.
+    * Otherwise, replace a free segment with a larger one. */
+   for(i = 0; i < SHM_MAX_SEGMENTS; i++) {
+      ShmSegment *sp = &segments[i];
+      if(!sp->image && sp->size >= size) {
+         if(!best || sp->size < best->size) {
+            best = sp;
+         }
+      }
+   }
+   for(i = 0; !best && i < SHM_MAX_SEGMENTS; i++) {
+      if(!segments[i].image) {
+         best = &segments[i];
+      }
+   }
+   if(!best) {
+      return NULL;
+   }
+
+   /* Wait for the server to finish with the segment before reuse. */
+   if(best->busy) {
+      JXSync(display, False);
+      for(i = 0; i < SHM_MAX_SEGMENTS; i++) {
+         segments[i].busy = 0;
+      }
+   }
+
+   if(best->size < size) {
+      if(best->size > 0) {
+         DestroySegment(best);
+      }
+      if(!CreateSegment(best, size)) {
+         return NULL;
+      }
+   }
+   return best;
+}
+
+/** Find the segment used by an image. */
+ShmSegment *FindSegment(const XImage *image)
+{
+   unsigned i;
+   for(i = 0; i < SHM_MAX_SEGMENTS; i++) {
+      if(segments[i].image == image) {
+         return &segments[i];
+      }
+   }
+   return NULL;
+}
+
+/** Create and attach a shared memory segment. */
+char CreateSegment(ShmSegment *sp, size_t size)
+{
+   sp->info.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+   if(sp->info.shmid < 0) {
+      Debug("shmget failed for %u bytes", (unsigned)size);
+      return 0;
+   }
+   sp->info.shmaddr = shmat(sp->info.shmid, NULL, 0);
+   if(sp->info.shmaddr == (char*)-1) {
+      shmctl(sp->info.shmid, IPC_RMID, NULL);
+      return 0;
+   }
+   sp->info.readOnly = True;
+
+   /* Attaching fails if the server cannot access our memory. */
+   JXSync(display, False);
+   shmFailed = 0;
+   JXSetErrorHandler(HandleShmError);
+   JXShmAttach(display, &sp->info);
+   JXSync(display, False);
+   JXSetErrorHandler(ErrorHandler);
+
+   /* The segment is released once both sides have detached. */
+   shmctl(sp->info.shmid, IPC_RMID, NULL);
+
+   if(JUNLIKELY(shmFailed)) {
+      Warning(_("MIT-SHM is not usable, using XPutImage"));
+      shmdt(sp->info.shmaddr);
+      haveShm = 0;
+      return 0;
+   }
+
+   sp->size = size;
+   sp->busy = 0;
+   return 1;
+}
+
+/** Detach and release a shared memory segment. */
+void DestroySegment(ShmSegment *sp)
+{
+   JXShmDetach(display, &sp->info);
+   JXSync(display, False);
+   shmdt(sp->info.shmaddr);
+   sp->size = 0;
+   sp->busy = 0;
+}
+
+/** Error handler used while attaching a segment. */
+int HandleShmError(Display *d, XErrorEvent *e)
+{
+   shmFailed = 1;
+   return 0;
+}
+
+#else /* USE_SHM */
+
+/** Startup image uploads. */
+void StartupUpload(void)
+{
+}
+
+/** Shutdown image uploads. */
+void ShutdownUpload(void)
+{
+}
+
+/** Create an image to be uploaded to the X server. */
+XImage *CreateUploadImage(unsigned depth, unsigned width, unsigned height)
+{
+   XImage *image;
+   image = JXCreateImage(display, rootVisual, depth, ZPixmap, 0, NULL,
+                         width, height, 8, 0);
+   image->data = Allocate(image->bytes_per_line * image->height);
+   return image;
+}
+
+/** Upload an image to a drawable and release it. */
+void UploadImage(Drawable d, GC gc, XImage *image)
+{
+   JXPutImage(display, d, gc, image, 0, 0, 0, 0,
+              image->width, image->height);
+   DestroyUploadImage(image);
+}
+
+/** Release an image without uploading it. */
+void DestroyUploadImage(XImage *image)
+{
+   Release(image->data);
+   image->data = NULL;
+   JXDestroyImage(image);
+}
+
+#endif /* USE_SHM */
@@ -0,0 +1,42 @@
+/**
+ * @file upload.h
+ * @author Scaramacai
+ * @date 2025
+ *
+ * @brief Functions to upload images to the X server.
+ *
+ */
+
+#ifndef UPLOAD_H
+#define UPLOAD_H
+
+/*@{*/
+#define InitializeUpload()    (void)(0)
+void StartupUpload(void);
+void ShutdownUpload(void);
+#define DestroyUpload()       (void)(0)
+/*@}*/
+
+/** Create an image to be uploaded to the X server.
+ * Large images are placed in shared memory if MIT-SHM is available.
+ * The image must be released with UploadImage or DestroyUploadImage.
+ * @param depth The depth of the image.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @return A new ZPixmap image using the root visual.
+ */
+XImage *CreateUploadImage(unsigned depth, unsigned width, unsigned height);
+
+/** Upload an image to a drawable and release it.
+ * @param d The drawable.
+ * @param gc The graphics context to use.
+ * @param image The image created by CreateUploadImage.
+ */
+void UploadImage(Drawable d, GC gc, XImage *image);
+
+/** Release an image without uploading it.
+ * @param image The image created by CreateUploadImage.
+ */
+void DestroyUploadImage(XImage *image);
+
+#endif /* UPLOAD_H */